@@ -11,6 +11,13 @@
 #include <codecvt>  // 添加 codecvt 头文件
 #include <chrono> // 添加计时头文件
 #include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <tuple>
+#include <new>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // 重复信息的结构体
 struct RepeatInfo {
@@ -40,21 +47,6 @@ std::string get_reverse_complement(const std::string& sequence) {
     return result;
 }
 
-// 构建相似度矩阵
-std::vector<std::vector<int>> build_similarity_matrix(const std::string& reference, const std::string& query) {
-    int n = reference.length();
-    int m = query.length();
-    std::vector<std::vector<int>> matrix(n, std::vector<int>(m, 0));
-    
-    for (int i = 0; i < n; ++i) {
-        for (int j = 0; j < m; ++j) {
-            matrix[i][j] = (reference[i] == query[j]) ? 1 : -1;
-        }
-    }
-    
-    return matrix;
-}
-
 // 线程安全地添加重复信息
 class ThreadSafeRepeatList {
 public:
@@ -344,174 +336,743 @@ std::vector<RepeatInfo> filter_nested_repeats(const std::vector<RepeatInfo>& rep
     return filtered_repeats;
 }
 
-// 使用动态规划寻找矩阵中的路径
-std::vector<std::vector<std::tuple<int, int, int>>> find_paths_dp(
-    const std::vector<std::vector<int>>& similarity_matrix,
+// 对角线上的匹配段，以及查询中紧随其后的串联重复次数
+// 反向互补段：reference[ref_start, ref_start+length) 是 query[query_start, query_start+length) 的反向互补
+struct PathSegment {
+    int ref_start;
+    int query_start;
+    int length;
+    int repeat_count;
+    bool is_reverse;
+};
+
+// DP分块边长：一块的两行游程缓冲和边界都能放进L1
+const int DP_TILE = 256;
+
+// 反对角线游程的标记位：游程从右侧块延伸进来，本块只知道它在块内的部分
+const int DP_HEADLESS = 1 << 30;
+const int DP_LENGTH_MASK = DP_HEADLESS - 1;
+
+// 波前同步：每一条反对角线上的块全部完成后才进入下一条
+class WaveBarrier {
+public:
+    explicit WaveBarrier(int count) : count_(count), waiting_(0), generation_(0) {}
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        int generation = generation_;
+        if (++waiting_ == count_) {
+            waiting_ = 0;
+            ++generation_;
+            cv_.notify_all();
+        } else {
+            cv_.wait(lock, [&] { return generation != generation_; });
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int count_;
+    int waiting_;
+    int generation_;
+};
+
+// 使用动态规划寻找矩阵中的路径。
+// dp[i][j]只依赖dp[i-1][j-1]，按DP_TILE×DP_TILE分块后，同一条反对角线上的块互不依赖，
+// 由各线程按波前并行计算。单元是否匹配直接比较两条序列得到，不再读取n×m的相似度矩阵；
+// 块内只保留两行对角线游程长度，块间只传递边界行和边界列，游程一结束就记录为路径段。
+// 内存为O(n+m)，与输入规模的乘积无关。
+// 同一遍扫描里还计算反向互补游程：rc[i][j] = (reference[i] == comp(query[j])) ? rc[i-1][j+1]+1 : 0，
+// 沿反对角线延伸，与正向共用已载入的查询块。它的前驱在右侧块，波前中尚未计算，
+// 所以跨过块右边界的游程被切成片段，扫描结束后按反对角线拼接。
+std::vector<PathSegment> find_paths_dp(
     const std::string& reference,
     const std::string& query,
-    int min_match_length = 10) {
+    int min_match_length = 10,
+    int num_threads = 1) {
     
-    int n = similarity_matrix.size();
-    int m = similarity_matrix[0].size();
+    int n = reference.length();
+    int m = query.length();
+    std::vector<PathSegment> runs;
+    if (n == 0 || m == 0) {
+        return runs;
+    }
     
-    // DP表 - dp[i][j] = {score, length, prev_i, prev_j}
-    std::vector<std::vector<std::tuple<int, int, int, int>>> dp(
-        n, std::vector<std::tuple<int, int, int, int>>(m, {0, 0, -1, -1}));
+    int tile_rows = (n + DP_TILE - 1) / DP_TILE;
+    int tile_cols = (m + DP_TILE - 1) / DP_TILE;
+    int num_waves = tile_rows + tile_cols - 1;
+    num_threads = std::max(1, std::min(num_threads, std::min(tile_rows, tile_cols)));
     
-    // 初始化第一个位置
-    for (int i = 0; i < n; ++i) {
-        for (int j = 0; j < m; ++j) {
-            if (similarity_matrix[i][j] == 1) {
-                dp[i][j] = {1, 1, -1, -1};  // 没有前驱节点
-            } else {
-                dp[i][j] = {-1, 0, -1, -1};
-            }
-        }
-    }
+    // bottom[tj]：上方块最后一行的游程长度，下标0为其左侧一列（即本块的左上角单元）
+    // right[ti]：左侧块最后一列的游程长度
+    // 一波之内每个块行、块列只有一个块，它先读后写，不需要加锁
+    std::vector<std::vector<int>> bottom(tile_cols, std::vector<int>(DP_TILE + 1, 0));
+    std::vector<std::vector<int>> right(tile_rows, std::vector<int>(DP_TILE, 0));
     
-    // 填充DP表 - 对角线方向的匹配
-    for (int i = 1; i < n; ++i) {
-        for (int j = 1; j < m; ++j) {
-            if (similarity_matrix[i][j] == 1) {
-                auto [prev_score, prev_length, _, __] = dp[i-1][j-1];
-                if (prev_score > 0) {  // 如果前一个位置有正得分，延续匹配
-                    dp[i][j] = {prev_score + 1, prev_length + 1, i-1, j-1};
-                }
-            }
+    // 反向互补只需要上方块最后一行：bottom_rc[tj][c] 为其在 j0+c 列的反对角线游程长度
+    std::vector<std::vector<int>> bottom_rc(tile_cols, std::vector<int>(DP_TILE + 1, 0));
+    
+    // 查询的互补（不反转），反对角线的匹配判断就和正向一样是逐字节比较
+    std::string query_comp(query.size(), 'N');
+    for (int j = 0; j < m; ++j) {
+        switch (query[j]) {
+            case 'A': query_comp[j] = 'T'; break;
+            case 'T': query_comp[j] = 'A'; break;
+            case 'G': query_comp[j] = 'C'; break;
+            case 'C': query_comp[j] = 'G'; break;
+            default: break;
         }
     }
     
-    // 找出所有有效的匹配路径（长度 >= min_match_length）
-    std::vector<std::vector<std::tuple<int, int, int>>> all_paths;
+    std::vector<PathSegment> fragments;
+    std::mutex runs_mutex;
+    WaveBarrier barrier(num_threads);
     
-    for (int i = 0; i < n; ++i) {
-        for (int j = 0; j < m; ++j) {
-            auto [score, length, prev_i, prev_j] = dp[i][j];
-            if (length >= min_match_length) {
-                // 回溯构建路径
-                std::vector<std::tuple<int, int, int>> path;
-                int curr_i = i;
-                int curr_j = j;
+    auto worker = [&](int thread_id) {
+        std::vector<PathSegment> local_runs;
+        std::vector<PathSegment> local_fragments;
+        // prev[c]为上一行在 j0+c-1 列的游程长度，cur同理
+        std::vector<int> prev(DP_TILE + 1), cur(DP_TILE + 1);
+        // prev_rc[c]为上一行在 j0+c 列的反对角线游程长度，prev_rc[cols]（右侧块）视为0
+        std::vector<int> prev_rc(DP_TILE + 1), cur_rc(DP_TILE + 1);
+        
+        // 反对角线游程在 (i, j) 结束；起点在右侧块或终点之后仍有匹配的，留作片段待拼接
+        auto emit_rc = [&](int i, int j, int value, bool open_tail) {
+            int length = value & DP_LENGTH_MASK;
+            PathSegment segment{i - length + 1, j, length, 0, true};
+            if ((value & DP_HEADLESS) || open_tail) {
+                local_fragments.push_back(segment);
+            } else if (length >= min_match_length) {
+                local_runs.push_back(segment);
+            }
+        };
+        
+        for (int wave = 0; wave < num_waves; ++wave) {
+            int ti_begin = std::max(0, wave - tile_cols + 1);
+            int ti_end = std::min(wave, tile_rows - 1);
+            
+            for (int ti = ti_begin + thread_id; ti <= ti_end; ti += num_threads) {
+                int tj = wave - ti;
+                int i0 = ti * DP_TILE, j0 = tj * DP_TILE;
+                int rows = std::min(DP_TILE, n - i0);
+                int cols = std::min(DP_TILE, m - j0);
+                std::vector<int>& top = bottom[tj];
+                std::vector<int>& left = right[ti];
                 
-                while (curr_i >= 0 && curr_j >= 0) {
-                    auto [curr_score, curr_length, prev_i, prev_j] = dp[curr_i][curr_j];
-                    if (curr_score <= 0) break;
-                    
-                    path.emplace_back(curr_i, curr_j, 1);  // 1表示匹配方向
-                    
-                    if (prev_i < 0 || prev_j < 0) break;
-                    curr_i = prev_i;
-                    curr_j = prev_j;
-                }
+                std::vector<int>& top_rc = bottom_rc[tj];
                 
-                // 路径是反向的，需要翻转
-                std::reverse(path.begin(), path.end());
+                std::copy(top.begin(), top.begin() + cols + 1, prev.begin());
+                std::copy(top_rc.begin(), top_rc.begin() + cols, prev_rc.begin());
+                int corner = 0;
+                // 上一行的最大游程长度；块的第一行来自上方块，未知
+                int prev_max = min_match_length;
+                int prev_rc_max = min_match_length;
                 
-                // 只有长度达到要求时才保存
-                if (path.size() >= min_match_length) {
-                    // 检查是否有重复
-                    int start_i = std::get<0>(path.front());
-                    int start_j = std::get<1>(path.front());
-                    int end_i = std::get<0>(path.back());
-                    int end_j = std::get<1>(path.back());
-                    int match_length = path.size();
+                const char* query_tile = query.data() + j0;
+                const char* comp_tile = query_comp.data() + j0;
+                for (int r = 0; r < rows; ++r) {
+                    int i = i0 + r;
+                    char base = reference[i];
                     
-                    // 检查正向重复
-                    std::vector<std::tuple<int, int, int>> repeat_paths;
-                    int curr_j = end_j + 1;
+                    // 沿行向量化：匹配则延长对角线游程，否则归零，顺带求本行最大值
+                    int cur_max = 0;
+                    for (int c = 0; c < cols; ++c) {
+                        cur[c + 1] = (query_tile[c] == base) ? prev[c] + 1 : 0;
+                        cur_max = std::max(cur_max, cur[c + 1]);
+                    }
                     
-                    // 循环检查是否有连续重复
-                    while (curr_j + match_length <= m) {
-                        bool is_repeat = true;
-                        std::vector<std::tuple<int, int, int>> temp_path;
-                        
-                        // 检查这段是否与原匹配段相同
-                        for (int k = 0; k < match_length; ++k) {
-                            if (curr_j + k >= m || query[start_j + k] != query[curr_j + k]) {
-                                is_repeat = false;
-                                break;
+                    // 反向互补在同一行、同一查询块上沿反对角线延长
+                    int cur_rc_max = 0;
+                    prev_rc[cols] = 0;
+                    for (int c = 0; c < cols; ++c) {
+                        cur_rc[c] = (comp_tile[c] == base) ? prev_rc[c + 1] + 1 : 0;
+                        cur_rc_max = std::max(cur_rc_max, cur_rc[c]);
+                    }
+                    
+                    // 最右一列的前驱在右侧块中，若它也匹配，游程的起点就不在本块
+                    if (cur_rc[cols - 1] && i > 0 && j0 + cols < m && reference[i - 1] == query_comp[j0 + cols]) {
+                        cur_rc[cols - 1] |= DP_HEADLESS;
+                        cur_rc_max = DP_HEADLESS;
+                    }
+                    
+                    // 反对角线游程在失配单元处结束，端点是其右上方的单元（最右一列的前驱归右侧块处理）。
+                    // 起点未知的片段带有标记位，总是不小于min_match_length；
+                    // 上一行没有够长的游程时整行都不必检查
+                    if (prev_rc_max >= min_match_length) {
+                        for (int c = 0; c + 1 < cols; ++c) {
+                            if (cur_rc[c] == 0 && prev_rc[c + 1] >= min_match_length) {
+                                emit_rc(i - 1, j0 + c + 1, prev_rc[c + 1], false);
                             }
-                            temp_path.emplace_back(start_i + k, curr_j + k, -1);  // -1表示重复
                         }
-                        
-                        if (is_repeat) {
-                            repeat_paths.insert(repeat_paths.end(), temp_path.begin(), temp_path.end());
-                            curr_j += match_length;
-                        } else {
-                            break;
+                    }
+                    
+                    // 在矩阵最后一行结束；最左一列的后继在左侧块中，本块按序列直接判断
+                    if (i == n - 1) {
+                        for (int c = 0; c < cols; ++c) {
+                            if (cur_rc[c] != 0) {
+                                emit_rc(i, j0 + c, cur_rc[c], false);
+                            }
                         }
+                    } else if (cur_rc[0] != 0) {
+                        emit_rc(i, j0, cur_rc[0], j0 > 0 && reference[i + 1] == query_comp[j0 - 1]);
                     }
+                    std::swap(prev_rc, cur_rc);
+                    prev_rc_max = cur_rc_max;
                     
-                    // 添加重复路径
-                    if (!repeat_paths.empty()) {
-                        std::vector<std::tuple<int, int, int>> combined_path = path;
-                        combined_path.insert(combined_path.end(), repeat_paths.begin(), repeat_paths.end());
-                        all_paths.push_back(combined_path);
+                    // 游程在失配单元处结束，端点是其左上方的单元
+                    if (prev_max >= min_match_length) {
+                        for (int c = 0; c < cols; ++c) {
+                            if (cur[c + 1] == 0 && prev[c] >= min_match_length) {
+                                local_runs.push_back({i - prev[c], j0 + c - prev[c], prev[c], 0, false});
+                            }
+                        }
                     }
                     
-                    // 检查反向互补重复逻辑也可以类似添加
+                    // 游程也在矩阵的最后一行或最后一列结束
+                    if (i == n - 1) {
+                        for (int c = 0; c < cols; ++c) {
+                            if (cur[c + 1] >= min_match_length) {
+                                local_runs.push_back({i - cur[c + 1] + 1, j0 + c - cur[c + 1] + 1, cur[c + 1], 0, false});
+                            }
+                        }
+                    } else if (j0 + cols == m && cur[cols] >= min_match_length) {
+                        local_runs.push_back({i - cur[cols] + 1, m - cur[cols], cur[cols], 0, false});
+                    }
+                    
+                    // 左侧一列交给下一行，本块最后一列交给右侧的块
+                    corner = left[r];
+                    cur[0] = corner;
+                    left[r] = cur[cols];
+                    std::swap(prev, cur);
+                    prev_max = std::max(cur_max, corner);
                 }
+                
+                // 本块最后一行交给下方的块
+                top[0] = corner;
+                std::copy(prev.begin() + 1, prev.begin() + cols + 1, top.begin() + 1);
+                std::copy(prev_rc.begin(), prev_rc.begin() + cols, top_rc.begin());
+            }
+            
+            barrier.wait();
+        }
+        
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        runs.insert(runs.end(), local_runs.begin(), local_runs.end());
+        fragments.insert(fragments.end(), local_fragments.begin(), local_fragments.end());
+    };
+    
+    std::vector<std::future<void>> futures;
+    for (int t = 0; t < num_threads; ++t) {
+        futures.push_back(std::async(std::launch::async, worker, t));
+    }
+    for (auto& future : futures) {
+        future.get();
+    }
+    
+    // 拼接跨块的反对角线片段：同一反对角线（i+j相同）上首尾相接的片段属于同一游程
+    auto anti_diagonal = [](const PathSegment& s) { return s.ref_start + s.length - 1 + s.query_start; };
+    std::sort(fragments.begin(), fragments.end(), [&](const PathSegment& a, const PathSegment& b) {
+        return std::make_pair(anti_diagonal(a), a.ref_start) < std::make_pair(anti_diagonal(b), b.ref_start);
+    });
+    for (size_t f = 0; f < fragments.size();) {
+        PathSegment run = fragments[f++];
+        while (f < fragments.size() && anti_diagonal(fragments[f]) == anti_diagonal(run) &&
+               fragments[f].ref_start == run.ref_start + run.length) {
+            run.length += fragments[f].length;
+            run.query_start = fragments[f].query_start;
+            ++f;
+        }
+        if (run.length >= min_match_length) {
+            runs.push_back(run);
+        }
+    }
+    
+    // 游程的每个长度不小于min_match_length的前缀都是一条路径，
+    // 检查查询中紧随其后是否有连续重复。反向互补游程的参考前缀对应查询区间的末尾部分。
+    std::vector<PathSegment> paths;
+    for (const auto& run : runs) {
+        for (int length = min_match_length; length <= run.length; ++length) {
+            int query_start = run.is_reverse ? run.query_start + run.length - length : run.query_start;
+            int consecutive_count = 0;
+            int curr_j = query_start + length;
+            while (curr_j + length <= m && query.compare(curr_j, length, query, query_start, length) == 0) {
+                consecutive_count++;
+                curr_j += length;
+            }
+            if (consecutive_count > 0) {
+                paths.push_back({run.ref_start, query_start, length, consecutive_count, run.is_reverse});
             }
         }
     }
     
-    return all_paths;
+    std::sort(paths.begin(), paths.end(), [](const PathSegment& a, const PathSegment& b) {
+        return std::tie(a.ref_start, a.query_start, a.length, a.is_reverse) <
+               std::tie(b.ref_start, b.query_start, b.length, b.is_reverse);
+    });
+    
+    return paths;
 }
 
 // 使用动态规划方法优化查找重复
-std::vector<RepeatInfo> find_repeats_dp(const std::string& reference, const std::string& query) {
-    // 构建相似度矩阵
-    auto matrix = build_similarity_matrix(reference, query);
-    
-    // 使用DP查找路径
-    auto paths = find_paths_dp(matrix, reference, query);
+std::vector<RepeatInfo> find_repeats_dp(const std::string& reference, const std::string& query, int num_threads = 1) {
+    // 使用波前并行DP查找路径，直接在序列上计算，不构建相似度矩阵
+    auto paths = find_paths_dp(reference, query, 10, num_threads);
     
     // 从路径中提取重复信息
     std::vector<RepeatInfo> repeats;
     
     for (const auto& path : paths) {
-        // 将路径分为匹配段和重复段
-        std::vector<std::tuple<int, int>> match_segment;
-        std::vector<std::tuple<int, int>> repeat_segment;
+        RepeatInfo info;
+        info.position = path.ref_start;
+        info.length = path.length;
+        info.count = path.repeat_count;
+        info.is_reverse = path.is_reverse;
+        info.orig_seq = reference.substr(path.ref_start, path.length);
         
-        for (const auto& [i, j, dir] : path) {
-            if (dir == 1) {
-                match_segment.push_back({i, j});
-            } else if (dir == -1) {
-                repeat_segment.push_back({i, j});
-            }
+        // 添加重复实例
+        for (int i = 0; i < path.repeat_count; ++i) {
+            size_t idx = path.query_start + path.length * (i + 1);
+            info.repeat_examples.push_back(query.substr(idx, path.length));
         }
         
-        if (!match_segment.empty()) {
-            // 获取匹配段信息
-            int start_i = std::get<0>(match_segment.front());
-            int start_j = std::get<1>(match_segment.front());
-            int end_i = std::get<0>(match_segment.back());
-            int end_j = std::get<1>(match_segment.back());
-            int segment_length = end_i - start_i + 1;
-            
-            // 计算重复次数
-            int repeat_count = repeat_segment.size() / segment_length;
-            
-            if (repeat_count > 0) {
-                RepeatInfo info;
-                info.position = start_i;
-                info.length = segment_length;
-                info.count = repeat_count;
-                info.is_reverse = false;
-                info.orig_seq = reference.substr(start_i, segment_length);
-                
-                // 添加重复实例
-                for (int i = 0; i < repeat_count; ++i) {
-                    size_t idx = start_j + segment_length * (i + 1);
-                    info.repeat_examples.push_back(query.substr(idx, segment_length));
+        repeats.push_back(info);
+    }
+    
+    return repeats;
+}
+
+// ---------------- 条带化SIMD局部比对 (Farrar) ----------------
+// 打分参数：BLASTN风格的 +2/-3，仿射空位罚分 5/2
+const int SW_MATCH = 2;
+const int SW_MISMATCH = -3;
+const int SW_GAP_OPEN = 5;     // 打开空位的代价（含第一次延伸）
+const int SW_GAP_EXTEND = 2;
+const int SW_MIN_ALIGN = 20;   // 报告阈值 = 该长度全匹配的得分
+
+// 碱基编码，非标准碱基编为4，与任何碱基都不匹配
+inline uint8_t sw_base_code(char base) {
+    switch (base) {
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': return 3;
+        default: return 4;
+    }
+}
+
+inline int sw_score(uint8_t a, uint8_t b) {
+    return (a == b && a < 4) ? SW_MATCH : SW_MISMATCH;
+}
+
+// 局部比对结果，坐标均为闭区间
+struct LocalAlignment {
+    int ref_begin;
+    int ref_end;
+    int query_begin;
+    int query_end;
+    int score;
+};
+
+#if defined(__SSE2__)
+// 8位通道：每个向量16个单元，得分超过 255 - bias 时饱和，需要用16位重算
+struct SwLanes8 {
+    static const int count = 16;
+    static const int limit = 255;
+    static __m128i set1(int v) { return _mm_set1_epi8(static_cast<char>(v)); }
+    static __m128i adds(__m128i a, __m128i b) { return _mm_adds_epu8(a, b); }
+    static __m128i subs(__m128i a, __m128i b) { return _mm_subs_epu8(a, b); }
+    static __m128i max(__m128i a, __m128i b) { return _mm_max_epu8(a, b); }
+    static __m128i cmpeq(__m128i a, __m128i b) { return _mm_cmpeq_epi8(a, b); }
+    static __m128i shift(__m128i a) { return _mm_slli_si128(a, 1); }
+    static int hmax(__m128i a) {
+        alignas(16) uint8_t lanes[16];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), a);
+        return *std::max_element(lanes, lanes + 16);
+    }
+};
+
+// 16位通道：窗口长度有限，得分远小于 32767，可以直接用有符号 max
+struct SwLanes16 {
+    static const int count = 8;
+    static const int limit = 32767;
+    static __m128i set1(int v) { return _mm_set1_epi16(static_cast<short>(v)); }
+    static __m128i adds(__m128i a, __m128i b) { return _mm_adds_epu16(a, b); }
+    static __m128i subs(__m128i a, __m128i b) { return _mm_subs_epu16(a, b); }
+    static __m128i max(__m128i a, __m128i b) { return _mm_max_epi16(a, b); }
+    static __m128i cmpeq(__m128i a, __m128i b) { return _mm_cmpeq_epi16(a, b); }
+    static __m128i shift(__m128i a) { return _mm_slli_si128(a, 2); }
+    static int hmax(__m128i a) {
+        alignas(16) uint16_t lanes[8];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), a);
+        return *std::max_element(lanes, lanes + 8);
+    }
+};
+
+// Farrar条带化Smith-Waterman：参考窗口作为条带化的查询谱，查询序列逐列扫描。
+// 只保留两列H和一列E，内存与窗口长度成正比；输出每一列的最高得分。
+template <typename Lanes>
+class StripedAligner {
+public:
+    explicit StripedAligner(const std::vector<uint8_t>& window)
+        : seg_len_((static_cast<int>(window.size()) + Lanes::count - 1) / Lanes::count),
+          bias_(-SW_MISMATCH) {
+        // 谱和各列向量放在同一块16字节对齐的内存里；std::vector<__m128i>会丢掉类型的对齐属性
+        buffer_ = static_cast<__m128i*>(_mm_malloc(sizeof(__m128i) * 9 * seg_len_, sizeof(__m128i)));
+        if (!buffer_) {
+            throw std::bad_alloc();
+        }
+        profile_ = buffer_;
+        mask_ = profile_ + 5 * seg_len_;
+        h_store_ = mask_ + seg_len_;
+        h_load_ = h_store_ + seg_len_;
+        e_ = h_load_ + seg_len_;
+        int length = window.size();
+        for (int seg = 0; seg < seg_len_; ++seg) {
+            alignas(16) uint16_t values[16];
+            for (int lane = 0; lane < Lanes::count; ++lane) {
+                values[lane] = lane * seg_len_ + seg < length ? 0xFFFF : 0;
+            }
+            mask_[seg] = pack(values);
+        }
+        for (int code = 0; code < 5; ++code) {
+            for (int seg = 0; seg < seg_len_; ++seg) {
+                alignas(16) uint16_t values[16];
+                for (int lane = 0; lane < Lanes::count; ++lane) {
+                    int idx = lane * seg_len_ + seg;
+                    // 填充单元的空位值仍会向后传播，列最大值通过mask_排除它们
+                    values[lane] = idx < length ? sw_score(window[idx], code) + bias_ : 0;
                 }
-                
-                repeats.push_back(info);
+                profile_[code * seg_len_ + seg] = pack(values);
             }
         }
     }
-    
+
+    ~StripedAligner() { _mm_free(buffer_); }
+
+    StripedAligner(const StripedAligner&) = delete;
+    StripedAligner& operator=(const StripedAligner&) = delete;
+
+    // 扫描查询序列，col_max[j]为第j列的最高得分；发生饱和时返回false
+    bool sweep(const uint8_t* query, int m, uint16_t* col_max) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i gap_open = Lanes::set1(SW_GAP_OPEN);
+        const __m128i gap_extend = Lanes::set1(SW_GAP_EXTEND);
+        const __m128i bias = Lanes::set1(bias_);
+        const int saturation = Lanes::limit - bias_;
+
+        std::fill(h_store_, h_store_ + seg_len_, zero);
+        std::fill(e_, e_ + seg_len_, zero);
+
+        for (int j = 0; j < m; ++j) {
+            const __m128i* profile = &profile_[query[j] * seg_len_];
+            __m128i f = zero;
+            __m128i col = zero;
+            __m128i h = Lanes::shift(h_store_[seg_len_ - 1]);
+            std::swap(h_load_, h_store_);
+
+            for (int i = 0; i < seg_len_; ++i) {
+                h = Lanes::subs(Lanes::adds(h, profile[i]), bias);
+                __m128i e = e_[i];
+                h = Lanes::max(h, e);
+                h = Lanes::max(h, f);
+                col = Lanes::max(col, _mm_and_si128(h, mask_[i]));
+                h_store_[i] = h;
+
+                h = Lanes::subs(h, gap_open);
+                e_[i] = Lanes::max(Lanes::subs(e, gap_extend), h);
+                f = Lanes::max(Lanes::subs(f, gap_extend), h);
+                h = h_load_[i];
+            }
+
+            // 惰性F循环：只在纵向空位还能改进H时继续传播
+            f = Lanes::shift(f);
+            int i = 0;
+            while (_mm_movemask_epi8(Lanes::cmpeq(
+                       Lanes::subs(f, Lanes::subs(h_store_[i], gap_open)), zero)) != 0xFFFF) {
+                h = Lanes::max(h_store_[i], f);
+                col = Lanes::max(col, _mm_and_si128(h, mask_[i]));
+                h_store_[i] = h;
+                e_[i] = Lanes::max(e_[i], Lanes::subs(h, gap_open));
+                f = Lanes::subs(f, gap_extend);
+                if (++i >= seg_len_) {
+                    i = 0;
+                    f = Lanes::shift(f);
+                }
+            }
+
+            int best = Lanes::hmax(col);
+            if (best >= saturation) {
+                return false;
+            }
+            col_max[j] = static_cast<uint16_t>(best);
+        }
+        return true;
+    }
+
+private:
+    static __m128i pack(const uint16_t* values) {
+        if (Lanes::count == 16) {
+            alignas(16) uint8_t bytes[16];
+            for (int k = 0; k < 16; ++k) bytes[k] = static_cast<uint8_t>(values[k]);
+            return _mm_load_si128(reinterpret_cast<const __m128i*>(bytes));
+        }
+        return _mm_load_si128(reinterpret_cast<const __m128i*>(values));
+    }
+
+    int seg_len_;
+    int bias_;
+    __m128i* buffer_;
+    __m128i* profile_;
+    __m128i* mask_;
+    __m128i* h_store_;
+    __m128i* h_load_;
+    __m128i* e_;
+};
+#endif
+
+// 标量Gotoh扫描，与条带化版本结果相同；用于没有SSE2的平台
+void sw_sweep_scalar(const std::vector<uint8_t>& window, const uint8_t* query, int m, uint16_t* col_max) {
+    int n = window.size();
+    std::vector<int> h(n + 1, 0), e(n + 1, 0);
+    for (int j = 0; j < m; ++j) {
+        int diag = 0, f = 0, best = 0;
+        for (int i = 1; i <= n; ++i) {
+            int up = h[i];
+            e[i] = std::max(e[i] - SW_GAP_EXTEND, up - SW_GAP_OPEN);
+            int cell = std::max({0, diag + sw_score(window[i - 1], query[j]), e[i], f});
+            f = std::max(f - SW_GAP_EXTEND, cell - SW_GAP_OPEN);
+            diag = up;
+            h[i] = cell;
+            best = std::max(best, cell);
+        }
+        col_max[j] = static_cast<uint16_t>(best);
+    }
+}
+
+// 先用8位通道扫描，饱和时退回16位通道
+void sw_sweep(const std::vector<uint8_t>& window, const uint8_t* query, int m, uint16_t* col_max) {
+#if defined(__SSE2__)
+    StripedAligner<SwLanes8> narrow(window);
+    if (narrow.sweep(query, m, col_max)) {
+        return;
+    }
+    StripedAligner<SwLanes16> wide(window);
+    wide.sweep(query, m, col_max);
+#else
+    sw_sweep_scalar(window, query, m, col_max);
+#endif
+}
+
+// 在命中点附近的查询区间内做完整的仿射DP并回溯。
+// 比对在查询上的长度不会超过窗口长度的两倍，所以区间 [query_end-2W+1, query_end] 足够。
+bool sw_traceback(const std::vector<uint8_t>& window, const uint8_t* query, int query_end,
+                  LocalAlignment& result) {
+    const int n = window.size();
+    const int q0 = std::max(0, query_end - 2 * n + 1);
+    const int w = query_end - q0 + 1;
+
+    // 每个单元记录三种来源：H来自(0空/1对角/2 E/3 F)，E和F是否由打开空位而来
+    enum { FROM_ZERO = 0, FROM_DIAG = 1, FROM_E = 2, FROM_F = 3, E_OPEN = 4, F_OPEN = 8 };
+    std::vector<uint8_t> trace(static_cast<size_t>(n + 1) * (w + 1), 0);
+    std::vector<int> h(w + 1, 0), e(w + 1, 0);
+
+    int best = 0, best_i = -1;
+    for (int i = 1; i <= n; ++i) {
+        int diag = 0, left = 0, f = 0;
+        h[0] = 0;
+        for (int j = 1; j <= w; ++j) {
+            uint8_t& t = trace[static_cast<size_t>(i) * (w + 1) + j];
+            int up = h[j];
+            int cell_e = e[j] - SW_GAP_EXTEND;
+            if (up - SW_GAP_OPEN >= cell_e) { cell_e = up - SW_GAP_OPEN; t |= E_OPEN; }
+            int cell_f = f - SW_GAP_EXTEND;
+            if (left - SW_GAP_OPEN >= cell_f) { cell_f = left - SW_GAP_OPEN; t |= F_OPEN; }
+
+            int cell = 0;
+            int from = FROM_ZERO;
+            int d = diag + sw_score(window[i - 1], query[q0 + j - 1]);
+            if (d > cell) { cell = d; from = FROM_DIAG; }
+            if (cell_e > cell) { cell = cell_e; from = FROM_E; }
+            if (cell_f > cell) { cell = cell_f; from = FROM_F; }
+            t |= from;
+
+            diag = up;
+            h[j] = cell;
+            e[j] = cell_e;
+            f = cell_f;
+            left = cell;
+        }
+        if (h[w] > best) {
+            best = h[w];
+            best_i = i;
+        }
+    }
+    if (best_i < 0) {
+        return false;
+    }
+
+    // 回溯：state 0=H，1=E（沿参考方向的空位），2=F（沿查询方向的空位）
+    int i = best_i, j = w, state = 0;
+    while (i > 0 && j > 0) {
+        uint8_t t = trace[static_cast<size_t>(i) * (w + 1) + j];
+        if (state == 0) {
+            int from = t & 3;
+            if (from == FROM_ZERO) break;
+            if (from == FROM_DIAG) {
+                result.ref_begin = i - 1;
+                result.query_begin = q0 + j - 1;
+                --i; --j;
+            } else {
+                state = (from == FROM_E) ? 1 : 2;
+            }
+        } else if (state == 1) {
+            if (t & E_OPEN) state = 0;
+            --i;
+        } else {
+            if (t & F_OPEN) state = 0;
+            --j;
+        }
+    }
+
+    result.ref_end = best_i - 1;
+    result.query_end = query_end;
+    result.score = best;
+    return true;
+}
+
+// 基于条带化Smith-Waterman的带空位重复查找。
+// 参考序列按长度2*max_length、步长max_length切分窗口，每个窗口正反两条链各扫描一次查询序列，
+// 对每列最高得分做非极大值抑制后在命中区附近回溯得到比对坐标。
+std::vector<RepeatInfo> find_repeats_sw(const std::string& reference, const std::string& query, int num_threads) {
+    int n = reference.length();
+    int m = query.length();
+    std::vector<RepeatInfo> repeats;
+    if (n == 0 || m == 0) {
+        return repeats;
+    }
+
+    int max_length = std::max(SW_MIN_ALIGN, std::min(n / 10, 120));
+    int min_length = std::max(SW_MIN_ALIGN, std::max(5, n / 1000));
+    int min_score = SW_MATCH * min_length;
+    int step = max_length;
+    int window_length = 2 * max_length;
+
+    std::vector<uint8_t> query_codes(m);
+    for (int j = 0; j < m; ++j) {
+        query_codes[j] = sw_base_code(query[j]);
+    }
+
+    std::vector<int> window_starts;
+    for (int start = 0; ; start += step) {
+        window_starts.push_back(start);
+        if (start + window_length >= n) break;
+    }
+
+    std::cout << "Smith-Waterman 比对: " << window_starts.size() << " 个窗口, 窗口长度 "
+              << window_length << ", 得分阈值 " << min_score << std::endl;
+
+    // 命中以全局坐标保存，LocalAlignment的ref坐标换算为参考序列上的正向坐标
+    std::vector<std::pair<LocalAlignment, bool>> hits;
+    std::mutex hits_mutex;
+    std::vector<std::future<void>> futures;
+    for (int t = 0; t < num_threads; ++t) {
+        futures.push_back(std::async(std::launch::async, [&, t]() {
+            std::vector<std::pair<LocalAlignment, bool>> local_hits;
+            std::vector<uint16_t> col_max(m);
+            for (size_t w = t; w < window_starts.size(); w += num_threads) {
+                int r0 = window_starts[w];
+                int length = std::min(window_length, n - r0);
+
+                for (int strand = 0; strand < 2; ++strand) {
+                    bool is_reverse = strand == 1;
+                    std::string segment = reference.substr(r0, length);
+                    std::string oriented = is_reverse ? get_reverse_complement(segment) : segment;
+                    std::vector<uint8_t> window(length);
+                    for (int i = 0; i < length; ++i) {
+                        window[i] = sw_base_code(oriented[i]);
+                    }
+
+                    sw_sweep(window, query_codes.data(), m, col_max.data());
+
+                    for (int j = 0; j < m; ++j) {
+                        int score = col_max[j];
+                        if (score < min_score) continue;
+
+                        // 只在 [j-W, j+W] 内取最高点（并列时取最左）作为命中
+                        bool peak = true;
+                        for (int k = std::max(0, j - length); k < j && peak; ++k) {
+                            peak = col_max[k] < score;
+                        }
+                        for (int k = j + 1; k <= std::min(m - 1, j + length) && peak; ++k) {
+                            peak = col_max[k] <= score;
+                        }
+                        if (!peak) continue;
+
+                        LocalAlignment aln;
+                        if (!sw_traceback(window, query_codes.data(), j, aln)) continue;
+
+                        // 触及窗口内部边界的比对会在相邻窗口中完整出现
+                        int span = aln.ref_end - aln.ref_begin + 1;
+                        bool clipped = (aln.ref_begin == 0 && r0 > 0) ||
+                                       (aln.ref_end == length - 1 && r0 + length < n);
+                        if (clipped && span < step) continue;
+
+                        int ref_begin = is_reverse ? r0 + length - 1 - aln.ref_end : r0 + aln.ref_begin;
+                        aln.ref_begin = ref_begin;
+                        aln.ref_end = ref_begin + span - 1;
+                        local_hits.push_back({aln, is_reverse});
+                    }
+                }
+            }
+            std::lock_guard<std::mutex> lock(hits_mutex);
+            hits.insert(hits.end(), local_hits.begin(), local_hits.end());
+        }));
+    }
+
+    for (auto& future : futures) {
+        future.get();
+    }
+
+    // 相邻窗口重叠，同一比对会被报告多次，或在窗口边界处被截短；丢弃在两条序列上都被另一命中包含的命中。
+    // 按链和参考起点排序后扫描：包含者总排在被包含者之前，只需检查参考终点还没越过当前起点的已保留命中
+    std::sort(hits.begin(), hits.end(), [](const std::pair<LocalAlignment, bool>& a,
+                                           const std::pair<LocalAlignment, bool>& b) {
+        const LocalAlignment& x = a.first;
+        const LocalAlignment& y = b.first;
+        return std::make_tuple(a.second, x.ref_begin, -x.ref_end, x.query_begin, -x.query_end) <
+               std::make_tuple(b.second, y.ref_begin, -y.ref_end, y.query_begin, -y.query_end);
+    });
+    std::vector<LocalAlignment> active;
+    for (size_t h = 0; h < hits.size(); ++h) {
+        const LocalAlignment& a = hits[h].first;
+        if (h > 0 && hits[h - 1].second != hits[h].second) {
+            active.clear();
+        }
+        active.erase(std::remove_if(active.begin(), active.end(), [&](const LocalAlignment& b) {
+            return b.ref_end < a.ref_begin;
+        }), active.end());
+        bool contained = false;
+        for (const LocalAlignment& b : active) {
+            if (a.ref_end <= b.ref_end && a.query_begin >= b.query_begin && a.query_end <= b.query_end) {
+                contained = true;
+                break;
+            }
+        }
+        if (contained) continue;
+        active.push_back(a);
+
+        RepeatInfo info;
+        info.position = a.ref_begin;
+        info.length = a.ref_end - a.ref_begin + 1;
+        info.count = 1;
+        info.is_reverse = hits[h].second;
+        info.orig_seq = reference.substr(a.ref_begin, info.length);
+        info.repeat_examples.push_back(query.substr(a.query_begin, a.query_end - a.query_begin + 1));
+        repeats.push_back(info);
+    }
+
+    std::cout << "Smith-Waterman 比对找到 " << repeats.size() << " 个带空位重复" << std::endl;
     return repeats;
 }
 
@@ -556,12 +1117,16 @@ int main() {
     // 计算执行时间
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
     
-    // 使用动态规划方法查找重复
-    std::vector<RepeatInfo> dp_repeats = find_repeats_dp(reference, query);
-    
-    // 合并两种方法的结果
+    // 使用动态规划方法查找重复；滚动行DP只需O(n+m)内存，任意长度都可运行
+    std::vector<RepeatInfo> dp_repeats = find_repeats_dp(reference, query, num_threads);
     repeats.insert(repeats.end(), dp_repeats.begin(), dp_repeats.end());
     
+    // 带空位的局部比对，线性内存，任意长度都可运行
+    std::vector<RepeatInfo> sw_repeats = find_repeats_sw(reference, query, num_threads);
+    
+    // 合并各方法的结果
+    repeats.insert(repeats.end(), sw_repeats.begin(), sw_repeats.end());
+    
     // 过滤嵌套重复
     std::vector<RepeatInfo> filtered_repeats = filter_nested_repeats(repeats);
     
@@ -0,0 +1,411 @@
+// DNA Repeat Finder - 种子扩展版本（dna_repeat_finder_optimized.py 的原生多线程实现）
+// 参考序列中唯一出现的 min_length 片段作为种子，查询序列分块并行查找种子，
+// 然后按机器字宽向两侧扩展，正向与反向互补两条链都处理。
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <future>
+#include <chrono>
+#include <mutex>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+
+const int DEFAULT_MIN_LENGTH = 10;  // 默认最小重复片段长度（同时是种子长度）
+const int MAX_SEED_LENGTH = 32;     // 种子按2位编码放进一个64位整数
+
+// 重复信息的结构体
+struct RepeatInfo {
+    int position;        // 参考序列中的起始位置
+    int length;
+    int count;           // 查询序列中连续出现的次数（含第一次）
+    bool is_reverse;
+    int query_position;  // 第一次出现在查询序列中的位置
+    std::string orig_seq;
+};
+
+std::string read_sequence(const std::string& filename) {
+    std::ifstream file(filename);
+    std::string sequence, line;
+    while (std::getline(file, line)) {
+        for (char c : line) {
+            if (!std::isspace(static_cast<unsigned char>(c))) {
+                sequence.push_back(std::toupper(static_cast<unsigned char>(c)));
+            }
+        }
+    }
+    return sequence;
+}
+
+// 生成DNA序列的反向互补序列
+std::string get_reverse_complement(const std::string& sequence) {
+    std::string result;
+    result.reserve(sequence.length());
+
+    for (auto it = sequence.rbegin(); it != sequence.rend(); ++it) {
+        switch (*it) {
+            case 'A': result.push_back('T'); break;
+            case 'T': result.push_back('A'); break;
+            case 'G': result.push_back('C'); break;
+            case 'C': result.push_back('G'); break;
+            default: result.push_back('N'); // 处理非标准碱基
+        }
+    }
+
+    return result;
+}
+
+inline int base_code(char base) {
+    switch (base) {
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': return 3;
+        default: return -1;
+    }
+}
+
+// 2位编码的种子；含非标准碱基时返回false
+bool encode_seed(const char* seed, int k, uint64_t& code) {
+    code = 0;
+    for (int i = 0; i < k; ++i) {
+        int base = base_code(seed[i]);
+        if (base < 0) return false;
+        code = (code << 2) | static_cast<uint64_t>(base);
+    }
+    return true;
+}
+
+// 种子反向互补序列的2位编码（互补碱基的编码为 3 - code）
+bool encode_seed_rc(const char* seed, int k, uint64_t& code) {
+    code = 0;
+    for (int i = k - 1; i >= 0; --i) {
+        int base = base_code(seed[i]);
+        if (base < 0) return false;
+        code = (code << 2) | static_cast<uint64_t>(3 - base);
+    }
+    return true;
+}
+
+// 参考序列的种子索引：按编码排序的 (编码, 位置) 数组，
+// 同一编码只出现一次的种子才会被使用（对应Python版的 segment_counts == 1）
+class ReferenceIndex {
+public:
+    ReferenceIndex(const std::string& reference, int k, int num_threads) : k_(k) {
+        int num_seeds = static_cast<int>(reference.length()) - k + 1;
+        if (num_seeds <= 0) return;
+
+        std::vector<std::pair<uint64_t, int>> seeds(num_seeds);
+        std::vector<char> valid(num_seeds, 0);
+
+        // 各线程独立编码一段位置
+        std::vector<std::future<void>> futures;
+        int chunk = (num_seeds + num_threads - 1) / num_threads;
+        for (int t = 0; t < num_threads; ++t) {
+            int start = t * chunk;
+            int end = std::min(num_seeds, start + chunk);
+            futures.push_back(std::async(std::launch::async, [&, start, end]() {
+                for (int pos = start; pos < end; ++pos) {
+                    uint64_t code;
+                    valid[pos] = encode_seed(reference.data() + pos, k_, code);
+                    seeds[pos] = {code, pos};
+                }
+            }));
+        }
+        for (auto& future : futures) {
+            future.get();
+        }
+
+        entries_.reserve(num_seeds);
+        for (int pos = 0; pos < num_seeds; ++pos) {
+            if (valid[pos]) entries_.push_back(seeds[pos]);
+        }
+        std::sort(entries_.begin(), entries_.end());
+    }
+
+    // 编码对应的种子在参考序列中唯一出现时返回其位置，否则返回-1
+    int unique_position(uint64_t code) const {
+        auto it = std::lower_bound(entries_.begin(), entries_.end(), std::make_pair(code, -1));
+        if (it == entries_.end() || it->first != code) return -1;
+        auto next = it + 1;
+        if (next != entries_.end() && next->first == code) return -1;
+        return it->second;
+    }
+
+private:
+    int k_;
+    std::vector<std::pair<uint64_t, int>> entries_;
+};
+
+// 从 a、b 开始向右比较，每次比较8个字节，返回相同的字符数（不超过limit）
+int extend_right(const char* a, const char* b, int limit) {
+    int matched = 0;
+    while (matched + 8 <= limit) {
+        uint64_t x, y;
+        std::memcpy(&x, a + matched, 8);
+        std::memcpy(&y, b + matched, 8);
+        uint64_t diff = x ^ y;
+        if (diff) {
+            return matched + (__builtin_ctzll(diff) >> 3);
+        }
+        matched += 8;
+    }
+    while (matched < limit && a[matched] == b[matched]) {
+        ++matched;
+    }
+    return matched;
+}
+
+// 从 a-1、b-1 开始向左比较，返回相同的字符数（不超过limit）
+int extend_left(const char* a, const char* b, int limit) {
+    int matched = 0;
+    while (matched + 8 <= limit) {
+        uint64_t x, y;
+        std::memcpy(&x, a - matched - 8, 8);
+        std::memcpy(&y, b - matched - 8, 8);
+        uint64_t diff = x ^ y;
+        if (diff) {
+            return matched + (__builtin_clzll(diff) >> 3);
+        }
+        matched += 8;
+    }
+    while (matched < limit && a[-matched - 1] == b[-matched - 1]) {
+        ++matched;
+    }
+    return matched;
+}
+
+// 一次种子扩展的结果，ref_start 为正向参考坐标
+struct SeedMatch {
+    int ref_start;
+    int query_start;
+    int length;
+    bool is_reverse;
+};
+
+// 种子在 strand 上（正向为参考序列，反向为参考序列的反向互补）向两侧扩展
+SeedMatch extend_seed(const std::string& query, const std::string& strand, int query_pos, int strand_pos,
+                      int k, bool is_reverse) {
+    int q_len = query.length();
+    int s_len = strand.length();
+    int right = extend_right(query.data() + query_pos + k, strand.data() + strand_pos + k,
+                             std::min(q_len - query_pos - k, s_len - strand_pos - k));
+    int left = extend_left(query.data() + query_pos, strand.data() + strand_pos,
+                           std::min(query_pos, strand_pos));
+
+    SeedMatch match;
+    match.length = left + k + right;
+    match.query_start = query_pos - left;
+    int strand_start = strand_pos - left;
+    // 反向互补链上的 [s, s+len) 对应参考序列的 [n-s-len, n-s)
+    match.ref_start = is_reverse ? s_len - strand_start - match.length : strand_start;
+    match.is_reverse = is_reverse;
+    return match;
+}
+
+// 查询序列分块并行查找种子并扩展。
+// 连续的查询位置落在同一个匹配上时，只有最左侧的唯一种子负责扩展：
+// 若前一个位置的种子唯一且位于同一对角线，则当前种子已被覆盖。
+std::vector<SeedMatch> find_connected_seeds(const ReferenceIndex& index, const std::string& query,
+                                            const std::string& reference, const std::string& reference_rc,
+                                            int k, int num_threads) {
+    int num_positions = static_cast<int>(query.length()) - k + 1;
+    std::vector<SeedMatch> matches;
+    if (num_positions <= 0) return matches;
+
+    int n = reference.length();
+    std::mutex matches_mutex;
+    std::vector<std::future<void>> futures;
+    int chunk = (num_positions + num_threads - 1) / num_threads;
+
+    for (int t = 0; t < num_threads; ++t) {
+        int start = t * chunk;
+        int end = std::min(num_positions, start + chunk);
+        if (start >= end) break;
+
+        futures.push_back(std::async(std::launch::async, [&, start, end]() {
+            std::vector<SeedMatch> local_matches;
+            auto lookup_fwd = [&](int i) {
+                uint64_t code;
+                return encode_seed(query.data() + i, k, code) ? index.unique_position(code) : -1;
+            };
+            auto lookup_rev = [&](int i) {
+                uint64_t code;
+                return encode_seed_rc(query.data() + i, k, code) ? index.unique_position(code) : -1;
+            };
+
+            // 块起点前一个位置的种子状态
+            int prev_fwd = start > 0 ? lookup_fwd(start - 1) : -1;
+            int prev_rev = start > 0 ? lookup_rev(start - 1) : -1;
+
+            for (int i = start; i < end; ++i) {
+                // 正向：query[i, i+k) == reference[ref_pos, ref_pos+k)
+                int ref_pos = lookup_fwd(i);
+                if (ref_pos >= 0 && !(prev_fwd >= 0 && prev_fwd == ref_pos - 1)) {
+                    local_matches.push_back(extend_seed(query, reference, i, ref_pos, k, false));
+                }
+
+                // 反向互补：query[i, i+k) 是 reference[rc_pos, rc_pos+k) 的反向互补，
+                // 即反向互补链上的 [n-rc_pos-k, n-rc_pos)；沿查询前进时rc_pos递减
+                int rc_pos = lookup_rev(i);
+                if (rc_pos >= 0 && !(prev_rev >= 0 && prev_rev == rc_pos + 1)) {
+                    local_matches.push_back(extend_seed(query, reference_rc, i, n - rc_pos - k, k, true));
+                }
+
+                prev_fwd = ref_pos;
+                prev_rev = rc_pos;
+            }
+
+            std::lock_guard<std::mutex> lock(matches_mutex);
+            matches.insert(matches.end(), local_matches.begin(), local_matches.end());
+        }));
+    }
+
+    for (auto& future : futures) {
+        future.get();
+    }
+
+    return matches;
+}
+
+// 检查每个匹配在查询序列中是否紧接着连续重复（至少出现两次）
+std::vector<RepeatInfo> check_consecutive_repeats(const std::vector<SeedMatch>& matches, const std::string& query,
+                                                  const std::string& reference) {
+    std::vector<RepeatInfo> repeats;
+    int query_len = query.length();
+
+    for (const auto& match : matches) {
+        // 查询中的第一次出现就是要寻找的重复单元
+        const char* unit = query.data() + match.query_start;
+        int count = 1;
+        int current_pos = match.query_start + match.length;
+        while (current_pos + match.length <= query_len &&
+               std::memcmp(query.data() + current_pos, unit, match.length) == 0) {
+            count++;
+            current_pos += match.length;
+        }
+
+        if (count > 1) {
+            RepeatInfo info;
+            info.position = match.ref_start;
+            info.length = match.length;
+            info.count = count;
+            info.is_reverse = match.is_reverse;
+            info.query_position = match.query_start;
+            info.orig_seq = reference.substr(match.ref_start, match.length);
+            repeats.push_back(info);
+        }
+    }
+
+    return repeats;
+}
+
+// 过滤嵌套重复，只保留每个位置的最长重复
+std::vector<RepeatInfo> filter_nested_repeats(const std::vector<RepeatInfo>& repeats) {
+    std::map<std::pair<int, bool>, RepeatInfo> best;
+    for (const auto& repeat : repeats) {
+        auto key = std::make_pair(repeat.position, repeat.is_reverse);
+        auto it = best.find(key);
+        if (it == best.end() || repeat.length > it->second.length) {
+            best[key] = repeat;
+        }
+    }
+
+    std::vector<RepeatInfo> filtered;
+    for (const auto& entry : best) {
+        filtered.push_back(entry.second);
+    }
+    return filtered;
+}
+
+void save_repeats_to_file(const std::vector<RepeatInfo>& repeats, const std::string& output_file) {
+    std::ofstream file(output_file);
+    if (!file) {
+        std::cerr << "无法打开文件 " << output_file << std::endl;
+        return;
+    }
+
+    // 与 dna_repeat_finder_optimized.py 的输出格式相同，位置同样加上长度
+    file << "参考位置,长度,重复次数,是否反向重复,原始序列,查询位置\n";
+    for (const auto& repeat : repeats) {
+        file << repeat.position + repeat.length << ","
+             << repeat.length << ","
+             << repeat.count << ","
+             << (repeat.is_reverse ? "是" : "否") << ","
+             << repeat.orig_seq.substr(0, 30) << "...,"
+             << repeat.query_position << "\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string reference_file = "reference.txt";
+    std::string query_file = "query.txt";
+    std::string output_file = "repeat_results_seed_extend.txt";
+    int min_length = DEFAULT_MIN_LENGTH;
+
+    if (argc >= 3) {
+        reference_file = argv[1];
+        query_file = argv[2];
+    }
+    if (argc >= 4) {
+        min_length = std::atoi(argv[3]);
+    }
+    if (min_length < 1 || min_length > MAX_SEED_LENGTH) {
+        std::cerr << "最小长度必须在 1 到 " << MAX_SEED_LENGTH << " 之间" << std::endl;
+        return 1;
+    }
+
+    std::string reference = read_sequence(reference_file);
+    std::string query = read_sequence(query_file);
+    if (reference.empty() || query.empty()) {
+        std::cerr << "读取序列失败: " << reference_file << ", " << query_file << std::endl;
+        return 1;
+    }
+    std::cout << "参考序列长度: " << reference.length() << ", 查询序列长度: " << query.length() << std::endl;
+
+    int num_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "使用 " << num_threads << " 线程, min_length=" << min_length << std::endl;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    // 步骤1: 为参考序列创建种子索引
+    ReferenceIndex index(reference, min_length, num_threads);
+    std::string reference_rc = get_reverse_complement(reference);
+
+    // 步骤2: 并行查找种子并双向扩展
+    std::vector<SeedMatch> matches = find_connected_seeds(index, query, reference, reference_rc,
+                                                          min_length, num_threads);
+    std::cout << "找到 " << matches.size() << " 个潜在重复片段" << std::endl;
+
+    // 步骤3: 检查连续重复
+    std::vector<RepeatInfo> repeats = check_consecutive_repeats(matches, query, reference);
+    std::cout << "找到 " << repeats.size() << " 个确认重复片段" << std::endl;
+
+    // 步骤4: 过滤并按 长度×次数 排序
+    std::vector<RepeatInfo> filtered = filter_nested_repeats(repeats);
+    std::sort(filtered.begin(), filtered.end(), [](const RepeatInfo& a, const RepeatInfo& b) {
+        return a.length * a.count > b.length * b.count;
+    });
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    std::cout << "找到 " << filtered.size() << " 个重复片段，耗时: " << duration.count() << " 毫秒" << std::endl;
+
+    save_repeats_to_file(filtered, output_file);
+    std::cout << "结果已保存到 " << output_file << std::endl;
+
+    std::cout << "\n前5个重复片段:" << std::endl;
+    for (size_t i = 0; i < std::min<size_t>(5, filtered.size()); ++i) {
+        const RepeatInfo& repeat = filtered[i];
+        std::cout << "位置: " << repeat.position << ", 长度: " << repeat.length
+                  << ", 重复次数: " << repeat.count
+                  << ", 是否反向: " << (repeat.is_reverse ? "是" : "否")
+                  << ", 序列: " << repeat.orig_seq.substr(0, 20) << "..." << std::endl;
+    }
+
+    return 0;
+}
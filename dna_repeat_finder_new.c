@@ -12,6 +12,10 @@
 #define MIN_LENGTH 50
 #define MAX_REPEATS 1000
 
+// 前缀哈希参数：模 2^61-1 的多项式哈希
+#define HASH_MOD ((1ULL << 61) - 1)
+#define HASH_BASE 1000003ULL
+
 // 重复片段的数据结构
 typedef struct {
     int position;
@@ -38,6 +42,26 @@ typedef struct {
     float similarity_threshold; // 相似度阈值
 } HashMap;
 
+// 排序哈希索引的条目（按哈希值、再按位置排序）
+typedef struct {
+    unsigned long long hash;
+    int position;
+} HashEntry;
+
+// 前缀哈希引擎的状态：三条序列的前缀哈希，以及按长度惰性建立的查询索引
+typedef struct {
+    const char* query;
+    const char* reference;
+    char* rc_reference;
+    int query_len;
+    int ref_len;
+    unsigned long long* power;
+    unsigned long long* query_prefix;
+    unsigned long long* ref_prefix;
+    unsigned long long* rc_prefix;
+    HashEntry* length_index[MAX_LENGTH - MIN_LENGTH + 1];
+} PrefixHashEngine;
+
 // 函数声明
 char* read_sequence(const char* filename);
 void get_reverse_complement(const char* dna, char* result, int length);
@@ -54,6 +78,7 @@ int* find_consecutive_groups(int* positions, int pos_count, int length, int* gro
 void filter_nested_repeats(RepeatPattern* repeats, int* count);
 void quick_sort_repeats(RepeatPattern* repeats, int left, int right);
 HashMap* build_sequence_hashmap(const char* sequence, int seq_len, int length);
+RepeatPattern* find_repeats_prefix_hash(const char* query, const char* reference, int* repeat_count);
 
 // KMP算法实现
 int* build_next(const char* pattern, int length) {
@@ -497,6 +522,211 @@ RepeatPattern* find_repeats(const char* query, const char* reference, int* repea
     return repeats;
 }
 
+// 模 2^61-1 乘法
+static inline unsigned long long mod_mul(unsigned long long a, unsigned long long b) {
+    unsigned __int128 x = (unsigned __int128)a * b;
+    unsigned long long r = (unsigned long long)(x & HASH_MOD) + (unsigned long long)(x >> 61);
+    return r >= HASH_MOD ? r - HASH_MOD : r;
+}
+
+// 分配失败时退出，与读文件失败的处理一致
+static void* checked_malloc(size_t size) {
+    void* p = malloc(size);
+    if (p == NULL) {
+        printf("内存分配失败\n");
+        exit(1);
+    }
+    return p;
+}
+
+// 计算前缀哈希：prefix[i] 为 sequence[0, i) 的哈希
+static unsigned long long* build_prefix_hash(const char* sequence, int length) {
+    unsigned long long* prefix = (unsigned long long*)checked_malloc(sizeof(unsigned long long) * (length + 1));
+    prefix[0] = 0;
+    for (int i = 0; i < length; i++) {
+        unsigned long long h = mod_mul(prefix[i], HASH_BASE) + (unsigned char)sequence[i];
+        prefix[i + 1] = h >= HASH_MOD ? h - HASH_MOD : h;
+    }
+    return prefix;
+}
+
+// O(1) 取子串 [start, start + length) 的哈希
+static inline unsigned long long substring_hash(const unsigned long long* prefix, const unsigned long long* power,
+                                                int start, int length) {
+    unsigned long long h = prefix[start + length] + HASH_MOD - mod_mul(prefix[start], power[length]);
+    return h >= HASH_MOD ? h - HASH_MOD : h;
+}
+
+static int compare_hash_entries(const void* a, const void* b) {
+    const HashEntry* x = (const HashEntry*)a;
+    const HashEntry* y = (const HashEntry*)b;
+    if (x->hash != y->hash) return x->hash < y->hash ? -1 : 1;
+    return x->position - y->position;
+}
+
+// 取某一长度的查询窗口索引，首次探测该长度时才建立
+static const HashEntry* get_length_index(PrefixHashEngine* engine, int length) {
+    HashEntry** slot = &engine->length_index[length - MIN_LENGTH];
+    if (*slot == NULL) {
+        int windows = engine->query_len - length + 1;
+        HashEntry* index = (HashEntry*)checked_malloc(sizeof(HashEntry) * windows);
+        for (int i = 0; i < windows; i++) {
+            index[i].hash = substring_hash(engine->query_prefix, engine->power, i, length);
+            index[i].position = i;
+        }
+        qsort(index, windows, sizeof(HashEntry), compare_hash_entries);
+        *slot = index;
+    }
+    return *slot;
+}
+
+// 查询中与参考片段（或其反向互补）相同的长度为 length 的窗口：返回出现次数，
+// *first 指向索引中第一个匹配条目（位置有序）
+static int probe_length(PrefixHashEngine* engine, int ref_pos, int length, bool is_reverse, const HashEntry** first) {
+    const HashEntry* index = get_length_index(engine, length);
+    int windows = engine->query_len - length + 1;
+    const char* segment;
+    unsigned long long hash;
+    if (is_reverse) {
+        int rc_pos = engine->ref_len - ref_pos - length;
+        segment = engine->rc_reference + rc_pos;
+        hash = substring_hash(engine->rc_prefix, engine->power, rc_pos, length);
+    } else {
+        segment = engine->reference + ref_pos;
+        hash = substring_hash(engine->ref_prefix, engine->power, ref_pos, length);
+    }
+    
+    // 二分查找哈希值相等的区间
+    int lo = 0, hi = windows;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (index[mid].hash < hash) lo = mid + 1; else hi = mid;
+    }
+    int end = lo;
+    while (end < windows && index[end].hash == hash) end++;
+    
+    // 逐字符核对第一个命中，排除哈希碰撞
+    if (end == lo || memcmp(engine->query + index[lo].position, segment, length) != 0) {
+        return 0;
+    }
+    *first = index + lo;
+    return end - lo;
+}
+
+// 在某一长度的命中（位置有序）中找首尾相接的连续重复组并记录，返回记录的组数
+static int record_groups(RepeatPattern* repeats, int* repeat_count, const HashEntry* hits, int pos_count,
+                         const char* reference, int ref_pos, int length, bool is_reverse) {
+    int recorded = 0;
+    int start = 0;
+    for (int j = 1; j <= pos_count; j++) {
+        if (j < pos_count && hits[j].position == hits[j - 1].position + length) continue;
+        if (j - start >= 2 && *repeat_count < MAX_REPEATS) {
+            RepeatPattern* repeat = &repeats[*repeat_count];
+            repeat->position = ref_pos;
+            repeat->length = length;
+            repeat->repeat_count = j - start;
+            repeat->is_reverse = is_reverse;
+            repeat->original_sequence = (char*)checked_malloc(length + 1);
+            memcpy(repeat->original_sequence, reference + ref_pos, length);
+            repeat->original_sequence[length] = '\0';
+            repeat->query_position = hits[start].position;
+            (*repeat_count)++;
+            recorded++;
+        }
+        start = j;
+    }
+    return recorded;
+}
+
+// 查找重复片段（前缀哈希版）：每个参考位置、每条链二分查找在查询中仍出现至少两次的最长长度，
+// 再从该长度往下找最长的、有首尾相接连续重复组的长度（与 find_repeats 过滤嵌套后保留的一致）
+RepeatPattern* find_repeats_prefix_hash(const char* query, const char* reference, int* repeat_count) {
+    PrefixHashEngine engine;
+    memset(&engine, 0, sizeof(engine));
+    engine.query = query;
+    engine.reference = reference;
+    engine.query_len = strlen(query);
+    engine.ref_len = strlen(reference);
+    
+    printf("Query sequence length: %d\n", engine.query_len);
+    printf("Reference sequence length: %d\n", engine.ref_len);
+    
+    RepeatPattern* repeats = (RepeatPattern*)checked_malloc(sizeof(RepeatPattern) * MAX_REPEATS);
+    *repeat_count = 0;
+    if (engine.query_len < MIN_LENGTH || engine.ref_len < MIN_LENGTH) {
+        return repeats;
+    }
+    
+    // 三条序列的前缀哈希各算一次
+    int max_len = engine.query_len > engine.ref_len ? engine.query_len : engine.ref_len;
+    engine.power = (unsigned long long*)checked_malloc(sizeof(unsigned long long) * (max_len + 1));
+    engine.power[0] = 1;
+    for (int i = 1; i <= max_len; i++) {
+        engine.power[i] = mod_mul(engine.power[i - 1], HASH_BASE);
+    }
+    engine.rc_reference = (char*)checked_malloc(engine.ref_len + 1);
+    get_reverse_complement(reference, engine.rc_reference, engine.ref_len);
+    engine.query_prefix = build_prefix_hash(query, engine.query_len);
+    engine.ref_prefix = build_prefix_hash(reference, engine.ref_len);
+    engine.rc_prefix = build_prefix_hash(engine.rc_reference, engine.ref_len);
+    
+    for (int i = 0; i <= engine.ref_len - MIN_LENGTH && *repeat_count < MAX_REPEATS; i++) {
+        int longest = MAX_LENGTH;
+        if (longest > engine.ref_len - i) longest = engine.ref_len - i;
+        if (longest > engine.query_len) longest = engine.query_len;
+        
+        for (int strand = 0; strand < 2; strand++) {
+            bool is_reverse = strand == 1;
+            const HashEntry* first;
+            
+            // 出现次数随长度单调不增，因此可以二分
+            int min_count = probe_length(&engine, i, MIN_LENGTH, is_reverse, &first);
+            if (min_count < 2) continue;
+            int lo = MIN_LENGTH, hi = longest;
+            while (lo < hi) {
+                int mid = (lo + hi + 1) / 2;
+                const HashEntry* candidate;
+                if (probe_length(&engine, i, mid, is_reverse, &candidate) >= 2) lo = mid; else hi = mid - 1;
+            }
+            
+            // 长度 L 的连续组要求片段在 q 和 q + L 处都出现，它的前 MIN_LENGTH 个碱基也就在这两处出现，
+            // 所以只有 MIN_LENGTH 命中之间的间距可能是连续组的长度
+            bool is_period[MAX_LENGTH - MIN_LENGTH + 1] = {false};
+            for (int a = 0; a < min_count; a++) {
+                for (int b = a + 1; b < min_count; b++) {
+                    int gap = first[b].position - first[a].position;
+                    if (gap > lo) break;
+                    if (gap >= MIN_LENGTH) is_period[gap - MIN_LENGTH] = true;
+                }
+            }
+    
+            // 从最长的候选长度往下核对，第一个有连续组的长度就是结果
+            for (int length = lo; length >= MIN_LENGTH; length--) {
+                if (!is_period[length - MIN_LENGTH]) continue;
+                const HashEntry* hits = NULL;
+                int pos_count = probe_length(&engine, i, length, is_reverse, &hits);
+                if (record_groups(repeats, repeat_count, hits, pos_count, reference, i, length, is_reverse) > 0) {
+                    break;
+                }
+            }
+        }
+    }
+    
+    for (int l = 0; l <= MAX_LENGTH - MIN_LENGTH; l++) {
+        free(engine.length_index[l]);
+    }
+    free(engine.power);
+    free(engine.rc_reference);
+    free(engine.query_prefix);
+    free(engine.ref_prefix);
+    free(engine.rc_prefix);
+    
+    filter_nested_repeats(repeats, repeat_count);
+    quick_sort_repeats(repeats, 0, *repeat_count - 1);
+    
+    return repeats;
+}
+
 // 保存结果到文件
 void save_repeats_to_file(RepeatPattern* repeats, int count) {
     FILE* file = fopen("repeat_results_new.txt", "w");
@@ -556,11 +786,21 @@ HashMap* build_sequence_hashmap(const char* sequence, int seq_len, int length) {
 int main(int argc, char* argv[]) {
     char* query_file = "query.txt";
     char* reference_file = "reference.txt";
-    
-    // Check command-line arguments
-    if (argc >= 3) {
-        reference_file = argv[1];
-        query_file = argv[2];
+    bool use_prefix_hash = false;
+    
+    // Check command-line arguments (--prefix-hash selects the prefix hash engine)
+    char* positional[2];
+    int num_positional = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--prefix-hash") == 0) {
+            use_prefix_hash = true;
+        } else if (num_positional < 2) {
+            positional[num_positional++] = argv[i];
+        }
+    }
+    if (num_positional == 2) {
+        reference_file = positional[0];
+        query_file = positional[1];
     }
     
     printf("Reading query sequence: %s\n", query_file);
@@ -574,7 +814,8 @@ int main(int argc, char* argv[]) {
     
     // Find repeats
     int repeat_count;
-    RepeatPattern* repeats = find_repeats(query, reference, &repeat_count);
+    RepeatPattern* repeats = use_prefix_hash ? find_repeats_prefix_hash(query, reference, &repeat_count)
+                                             : find_repeats(query, reference, &repeat_count);
     
     // Calculate elapsed time
     clock_t end_time = clock();
@@ -4,6 +4,7 @@
 // CPU 特性检测和优化设置
 #ifdef __x86_64__
     #include <immintrin.h>
+    #include <cpuid.h>
 #endif
 
 // AMD Ryzen 9 7940HX specific optimizations
@@ -25,6 +26,7 @@
 #define ALIGN_TO_CACHE __attribute__((aligned(CACHE_LINE_SIZE)))
 #define LIKELY(x) __builtin_expect(!!(x), 1)
 #define UNLIKELY(x) __builtin_expect(!!(x), 0)
+#define FORCE_INLINE static inline __attribute__((always_inline))
 
 // 向量化和SIMD优化
 #ifdef __AVX2__
@@ -47,6 +49,7 @@ static inline void prefetch_read(const void* addr) {
         _mm_prefetch((const char*)addr, SOFTWARE_PREFETCH_HINT);
     #endif
 }
+#define PREFETCH_READ(addr) prefetch_read(addr)
 
 // 优化的内存分配函数
 static inline void* aligned_alloc_cache(size_t size) {
@@ -0,0 +1,23 @@
+#ifndef DNA_BITMATCH_H
+#define DNA_BITMATCH_H
+
+#include "dna_common.h"
+
+// Patterns longer than this are matched on their first 128 bases and the tail is verified
+#define BITMATCH_WORD_PATTERN 128
+
+// Text prepared for bit-parallel matching: one 2-bit base code per byte (4 for non-ACGT)
+typedef struct {
+    const char* sequence;    // Original text, used to verify long pattern tails
+    unsigned char* codes;    // Base codes indexing the Shift-Or mask tables
+    int length;              // Text length
+} BitmatchText;
+
+// Function prototypes for bit-parallel exact matching
+BitmatchText* prepare_bitmatch_text(const char* sequence, int length);
+int bitmatch_search(const BitmatchText* text, const char* pattern, int pattern_len, int* offsets, int max_offsets);
+void bitmatch_search_batch(const BitmatchText* text, const char* const* patterns, const int* pattern_lens,
+                           int num_patterns, int* const* offsets, const int* max_offsets, int* counts);
+void free_bitmatch_text(BitmatchText* text);
+
+#endif // DNA_BITMATCH_H
@@ -15,15 +15,46 @@ typedef struct {
     int length;         // Length of the repeat
     int count;          // Number of repeats
     int is_reverse;     // 1 if reverse complement, 0 otherwise
+    int query_position; // Query offset of the match that produced it, -1 if not tracked
     char* orig_seq ALIGN_TO_CACHE; // Original sequence, cache-aligned
-    char** repeat_examples; // Examples of repeat sequences found
-    int num_examples;   // Number of examples stored
+    int* example_positions; // Query offsets of the repeat instances found
+    int num_examples;   // Number of instance offsets stored
 } RepeatPattern;
 
+// Repeat engines selectable from the command line
+typedef enum {
+    ENGINE_GRAPH = 0,   // Seed graph (default)
+    ENGINE_DIAGONAL,    // Matrix-free diagonal run scan
+    ENGINE_MEM,         // Maximal exact matches from a suffix array
+    ENGINE_TRADITIONAL, // Every segment length looked up in a query k-mer index
+    ENGINE_AUTO         // Picked per input by the cost model
+} EngineKind;
+
+// Run-time options shared by all engines, set from the command line
+typedef struct {
+    int exact_mode;     // 1 to visit every reference position instead of sampling
+    EngineKind engine;  // Engine that produces the raw repeats
+    int smem_only;      // MEM engine: keep only super-maximal matches
+    int min_mem_length; // MEM engine: shortest match reported, 0 for the default
+    int top_k;          // Keep only the k best repeats by length x count, 0 keeps all
+    int self_mode;      // Reference and query are one sequence: report each pair once
+    const char* state_file; // Incremental mode: saved analysis to update, NULL for a full run
+    const char* edits_file; // Incremental mode: edit list, NULL to diff against the query file
+    const char* dotplot_file; // Dot plot mode: PPM image to render, NULL for a repeat search
+    int dotplot_size;   // Dot plot mode: largest side of the image in pixels, 0 for the default
+    int families_mode;  // 1 to report repeat families of the query instead of pairwise repeats
+} FinderOptions;
+
+extern FinderOptions finder_options;
+
 // Common utility functions
 char* get_reverse_complement(const char* sequence, int length);
+RepeatPattern* allocate_repeat_patterns(int count);
+RepeatPattern* resize_repeat_patterns(RepeatPattern* repeats, int count, int capacity);
 void free_repeat_patterns(RepeatPattern* repeats, int count);
 void print_usage(const char* program_name);
+void report_scan_throughput(const char* stage, int positions, double seconds);
+void report_cell_throughput(const char* stage, long long cells, double seconds);
 
 // Optimized memory allocation for DNA sequences
 FORCE_INLINE char* allocate_dna_sequence(size_t length) {
@@ -36,4 +67,82 @@ FORCE_INLINE char* allocate_dna_sequence(size_t length) {
     return sequence;
 }
 
+// Threads worth starting for a workload of work_size bytes: one per L2-sized share of it,
+// at most one per processor
+FORCE_INLINE int get_optimal_thread_count(size_t work_size) {
+    size_t shares = work_size / L2_CACHE_SIZE + 1;
+    int processors = omp_get_num_procs();
+    return shares < (size_t)processors ? (int)shares : processors;
+}
+
+// 2-bit code of a nucleotide (A=0, C=1, G=2, T=3), -1 for anything else
+FORCE_INLINE int dna_base_code(char base) {
+    switch (base) {
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': return 3;
+        default:  return -1;
+    }
+}
+
+// Number of equal bytes at a[0..] and b[0..], compared 8 bytes at a time (at most limit)
+FORCE_INLINE int match_forward(const char* a, const char* b, int limit) {
+    int matched = 0;
+    while (matched + 8 <= limit) {
+        unsigned long long x, y;
+        memcpy(&x, a + matched, 8);
+        memcpy(&y, b + matched, 8);
+        if (x != y) {
+            return matched + (__builtin_ctzll(x ^ y) >> 3);
+        }
+        matched += 8;
+    }
+    while (matched < limit && a[matched] == b[matched]) {
+        matched++;
+    }
+    return matched;
+}
+
+// Number of equal bytes at a[-1], a[-2], ... and b[-1], b[-2], ... (at most limit)
+FORCE_INLINE int match_backward(const char* a, const char* b, int limit) {
+    int matched = 0;
+    while (matched + 8 <= limit) {
+        unsigned long long x, y;
+        memcpy(&x, a - matched - 8, 8);
+        memcpy(&y, b - matched - 8, 8);
+        if (x != y) {
+            return matched + (__builtin_clzll(x ^ y) >> 3);
+        }
+        matched += 8;
+    }
+    while (matched < limit && a[-matched - 1] == b[-matched - 1]) {
+        matched++;
+    }
+    return matched;
+}
+
+// Same cell rule as the diagonal scan: equal bases, and only A/C/G/T ever match
+FORCE_INLINE int cells_match(char a, char b) {
+    return a == b && dna_base_code(a) >= 0;
+}
+
+// match_forward cut at the first base that is not A/C/G/T, so N never matches N
+FORCE_INLINE int match_bases_forward(const char* a, const char* b, int limit) {
+    int matched = match_forward(a, b, limit);
+    for (int i = 0; i < matched; i++) {
+        if (dna_base_code(a[i]) < 0) return i;
+    }
+    return matched;
+}
+
+// match_backward cut at the first base that is not A/C/G/T
+FORCE_INLINE int match_bases_backward(const char* a, const char* b, int limit) {
+    int matched = match_backward(a, b, limit);
+    for (int i = 0; i < matched; i++) {
+        if (dna_base_code(a[-i - 1]) < 0) return i;
+    }
+    return matched;
+}
+
 #endif // DNA_COMMON_H
@@ -0,0 +1,29 @@
+#ifndef DNA_COST_H
+#define DNA_COST_H
+
+#include "dna_common.h"
+
+// Bases in each calibration sequence; large enough to leave L1, small enough to take milliseconds
+#define COST_CALIBRATION_LENGTH (1 << 16)
+
+// Keys in the second sort measurement, past the last-level cache of most machines
+#define COST_LARGE_LENGTH (1 << 22)
+
+// Per-operation costs of the kernels the engines are built from, measured on this machine
+typedef struct {
+    int threads;             // Threads the engines will run with
+    double word_ns;          // One 32-cell packed XOR compare (diagonal scan)
+    double lookup_ns;        // One random k-mer bucket lookup or suffix array probe
+    double sort_ns;          // One element of a counting sort pass (suffix array build)
+    double sort_large_ns;    // The same with COST_LARGE_LENGTH keys
+    double index_ns;         // Indexing one base into a k-mer table
+} MachineProfile;
+
+// Function prototypes for cost-model engine selection
+const char* engine_name(EngineKind engine);
+const char* engine_result_set(EngineKind engine);
+void measure_machine_profile(MachineProfile* profile, int max_length);
+double estimate_engine_time(EngineKind engine, const MachineProfile* profile, int ref_len, int query_len);
+EngineKind choose_engine(const MachineProfile* profile, int ref_len, int query_len, double* predicted_ms);
+
+#endif // DNA_COST_H
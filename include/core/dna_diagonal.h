@@ -0,0 +1,36 @@
+#ifndef DNA_DIAGONAL_H
+#define DNA_DIAGONAL_H
+
+#include <stdint.h>
+#include "dna_common.h"
+
+// Shortest diagonal run reported as a repeat, same lower bound as the graph engine
+#define DIAGONAL_MIN_RUN 50
+
+// Sequence packed 32 bases per 64-bit word; base k sits at bits 2*(k%32) of word k/32.
+// Both arrays carry one extra zero word so a window starting anywhere can be read.
+typedef struct {
+    int length;              // Number of bases
+    int num_words;           // Words per array, including the padding word
+    uint64_t* bases;         // 2-bit codes (A=0, C=1, G=2, T=3, others packed as 0)
+    uint64_t* invalid;       // Bit 2*(k%32) set where base k is not A/C/G/T
+} PackedSequence;
+
+// Maximal run of matching cells on one diagonal of the (virtual) similarity matrix.
+// diagonal = reference position - query position, so the run covers
+// reference[ref_start, ref_start + length) and query[ref_start - diagonal, ...).
+typedef struct {
+    int diagonal;
+    int ref_start;
+    int length;
+} DiagonalSegment;
+
+// Function prototypes for the matrix-free diagonal engine
+PackedSequence* pack_sequence(const char* sequence, int length);
+void free_packed_sequence(PackedSequence* packed);
+DiagonalSegment* find_diagonal_runs(const char* reference, int ref_len, const char* query, int query_len,
+                                    int min_length, int* num_segments);
+RepeatPattern* find_repeats_diagonal(const char* reference, int ref_len, const char* query, int query_len,
+                                     int* num_repeats);
+
+#endif // DNA_DIAGONAL_H
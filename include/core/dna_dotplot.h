@@ -0,0 +1,40 @@
+#ifndef DNA_DOTPLOT_H
+#define DNA_DOTPLOT_H
+
+#include "dna_common.h"
+#include "dna_diagonal.h"
+
+// Rendered dot plots are at most this many pixels on a side unless the caller asks otherwise
+#define DOTPLOT_RASTER_DEFAULT 4096
+
+// Shortest match run drawn in a rendered dot plot
+#define DOTPLOT_MIN_RUN 20
+
+// Sparse dot plot: every maximal run of at least min_length matching A/C/G/T cells,
+// kept as diagonal segments instead of the n x m grid.
+// Forward segments use query coordinates (diagonal = reference - query position).
+// Reverse segments use coordinates in the reverse complement of the query: a segment
+// at rc position x covers query[query_len - x - length, query_len - x), reverse complemented.
+// Both arrays are sorted by diagonal, then by reference start.
+typedef struct {
+    int ref_len;
+    int query_len;
+    int min_length;
+    DiagonalSegment* forward;
+    int num_forward;
+    DiagonalSegment* reverse;
+    int num_reverse;
+} SparseDotPlot;
+
+// Function prototypes for the sparse dot plot
+SparseDotPlot* build_sparse_dotplot(const char* reference, int ref_len, const char* query, int query_len,
+                                    int min_length);
+void free_sparse_dotplot(SparseDotPlot* plot);
+const DiagonalSegment* dotplot_diagonal_range(const SparseDotPlot* plot, int is_reverse, int first_diagonal,
+                                              int last_diagonal, int* count);
+DiagonalSegment* dotplot_window(const SparseDotPlot* plot, int is_reverse, int ref_start, int ref_end,
+                                int query_start, int query_end, int* count);
+int render_dotplot(const char* reference, int ref_len, const char* query, int query_len, int min_length,
+                   int size, const char* path);
+
+#endif // DNA_DOTPLOT_H
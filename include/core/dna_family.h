@@ -0,0 +1,57 @@
+#ifndef DNA_FAMILY_H
+#define DNA_FAMILY_H
+
+#include <stdint.h>
+#include "dna_common.h"
+
+// k-mer length of the repeat family graph; odd, so no k-mer is its own reverse complement
+#define FAMILY_KMER_DEFAULT 31
+
+// Reference matches and bases printed per family
+#define FAMILY_MAX_MATCHES 5
+#define FAMILY_PRINT_BASES 100
+
+// Maximal non-branching path of the query's de Bruijn graph, spelled on one strand
+typedef struct {
+    int start;               // First base in the graph's base pool
+    int length;              // Bases, at least k
+    double multiplicity;     // Mean query occurrences (both strands) of its k-mers
+} Unitig;
+
+// Compacted de Bruijn graph of the query over canonical k-mers, two k-mers being linked
+// when one follows the other somewhere in the query. The k-mer table is an
+// open-addressing hash filled without locks; slot s holds canonical k-mer keys[s] - 1,
+// 0 marks an empty slot.
+typedef struct {
+    int k;
+    int num_kmers;           // Distinct canonical k-mers
+    int capacity;            // Table slots, a power of two
+    uint64_t* keys;          // Canonical 2-bit k-mer + 1
+    int* counts;             // Query occurrences of each k-mer, both strands
+    int* kmer_unitig;        // Unitig holding each k-mer
+    int* kmer_offset;        // 2 * offset in the unitig, +1 if the unitig spells it reverse complemented
+    unsigned char* links;    // Bases b with k-mer + b in the graph: bit b for the canonical strand, 4 + b for the other
+    Unitig* unitigs;
+    int num_unitigs;
+    char* bases;             // Sequences of all unitigs, back to back
+    int num_bases;
+} DeBruijnGraph;
+
+// Where a repeat family (a unitig seen more than once in the query) occurs in another sequence
+typedef struct {
+    int unitig;              // Family unitig
+    int is_reverse;          // 1 if the sequence holds the unitig's reverse complement
+    int first;               // Sequence span [first, last + k) of the shared k-mers
+    int last;
+    int kmers;               // Shared k-mers
+} FamilyMatch;
+
+// Function prototypes for the repeat family graph
+DeBruijnGraph* build_debruijn_graph(const char* query, int query_len, int k);
+void free_debruijn_graph(DeBruijnGraph* graph);
+FamilyMatch* match_repeat_families(const DeBruijnGraph* graph, const char* sequence, int seq_len,
+                                   int* num_matches);
+int report_repeat_families(const char* reference, int ref_len, const char* query, int query_len,
+                           FILE* output_file);
+
+#endif // DNA_FAMILY_H
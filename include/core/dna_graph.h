@@ -1,35 +1,34 @@
 #ifndef DNA_GRAPH_H
 #define DNA_GRAPH_H
 
+#include <stdint.h>
 #include "dna_common.h"
 
-// Structure to represent a node in our DNA graph
-typedef struct GraphNode {
-    int position;                // Position in sequence
-    struct GraphEdge* edges;     // Outgoing edges
-    int num_edges;               // Number of edges
-    int capacity;                // Capacity of edges array
-} GraphNode;
-
-// Structure to represent an edge in our DNA graph
-typedef struct GraphEdge {
-    struct GraphNode* target;    // Target node
-    int match_length;            // Length of matching subsequence
-    double weight;               // Edge weight (based on match quality)
-    int is_reverse;              // Whether this is a reverse complement match
-} GraphEdge;
+// Repeats returned by a full (non top-K) graph search, lowest reference positions first
+#define GRAPH_MAX_REPEATS 100
 
-// Structure for our DNA graph
+// Seed match graph in compressed sparse row form. Node i is reference position i and
+// its outgoing edges are [offsets[i], offsets[i + 1]) of the edge arrays.
 typedef struct {
-    GraphNode* nodes;            // Array of nodes
-    int num_nodes;               // Number of nodes
-    int capacity;                // Capacity of nodes array
+    int num_nodes;               // Number of nodes (reference positions)
+    int num_edges;               // Number of edges
+    int* offsets;                // num_nodes + 1 edge offsets
+    int* targets;                // Query position of each edge
+    int* lengths;                // Length of the matching subsequence of each edge
+    uint64_t* reverse;           // Bit e%64 of word e/64 is set for a reverse complement edge
+    int seed_length;             // Bases every seed edge was verified over
+    int seed_step;               // Seeds start at reference positions that are multiples of this
 } DNAGraph;
 
 // Function prototypes for graph operations
 DNAGraph* build_dna_graph(const char* reference, int ref_len, const char* query, int query_len);
-void add_edge(GraphNode* source, GraphNode* target, int match_length, int is_reverse);
-RepeatPattern* find_repeats_in_graph(DNAGraph* graph, const char* reference, const char* query, int* num_repeats);
+RepeatPattern* find_repeats_in_graph(DNAGraph* graph, const char* reference, int ref_len, 
+                                     const char* query, int query_len, int* num_repeats);
 void free_dna_graph(DNAGraph* graph);
 
+// Whether edge e is a reverse complement match
+FORCE_INLINE int graph_edge_is_reverse(const DNAGraph* graph, int e) {
+    return (int)((graph->reverse[e >> 6] >> (e & 63)) & 1);
+}
+
 #endif // DNA_GRAPH_H
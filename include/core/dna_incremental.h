@@ -0,0 +1,45 @@
+#ifndef DNA_INCREMENTAL_H
+#define DNA_INCREMENTAL_H
+
+#include <stdint.h>
+#include "dna_common.h"
+#include "dna_diagonal.h"
+#include "dna_index.h"
+
+// One edit of the query: bases [position, position + deleted) are replaced by
+// inserted[0, inserted_len). A SNP deletes and inserts one base.
+typedef struct {
+    int position;
+    int deleted;
+    char* inserted;
+    int inserted_len;
+} QueryEdit;
+
+// Saved analysis of one reference/query pair: the query as last analyzed, its
+// diagonal runs (sorted by diagonal, then reference start) and the reference k-mer
+// index every update seeds from, built once by the full analysis. The reference is
+// not stored, only its length and hash so a changed reference forces a full rebuild.
+typedef struct {
+    int ref_len;
+    uint64_t ref_hash;
+    KmerIndex* ref_index;
+    char* query;
+    int query_len;
+    DiagonalSegment* runs;
+    int num_runs;
+    int run_capacity;
+} IncrementalState;
+
+// Function prototypes for incremental re-analysis
+uint64_t hash_sequence(const char* sequence, int length);
+IncrementalState* build_incremental_state(const char* reference, int ref_len, const char* query, int query_len);
+IncrementalState* load_incremental_state(const char* path);
+int save_incremental_state(const IncrementalState* state, const char* path);
+void free_incremental_state(IncrementalState* state);
+QueryEdit* read_query_edits(const char* path, int* num_edits);
+QueryEdit* diff_query(const char* old_query, int old_len, const char* new_query, int new_len, int* num_edits);
+void free_query_edits(QueryEdit* edits, int num_edits);
+int apply_query_edit(IncrementalState* state, const char* reference, const QueryEdit* edit, int edit_id,
+                     FILE* delta);
+
+#endif // DNA_INCREMENTAL_H
@@ -0,0 +1,25 @@
+#ifndef DNA_INDEX_H
+#define DNA_INDEX_H
+
+#include "dna_common.h"
+
+// Largest k supported by the direct-addressed bucket table (4^12 buckets)
+#define KMER_INDEX_MAX_K 12
+
+// Index of every k-mer of a sequence in compressed sparse row layout.
+// Bucket id is the 2-bit packed k-mer, positions inside a bucket are ascending.
+typedef struct {
+    int k;                   // k-mer length
+    int seq_len;             // Length of the indexed sequence
+    unsigned int* offsets;   // 4^k + 1 bucket offsets into positions
+    int* positions;          // Start positions grouped by k-mer
+} KmerIndex;
+
+// Function prototypes for k-mer index operations
+int choose_kmer_size(int seq_len, int max_k);
+int encode_kmer(const char* kmer, int k, unsigned int* code);
+KmerIndex* build_kmer_index(const char* sequence, int seq_len, int k);
+int kmer_index_lookup(const KmerIndex* index, const char* kmer, const int** positions);
+void free_kmer_index(KmerIndex* index);
+
+#endif // DNA_INDEX_H
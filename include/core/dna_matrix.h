@@ -0,0 +1,149 @@
+#ifndef DNA_MATRIX_H
+#define DNA_MATRIX_H
+
+#include <stdint.h>
+#include "dna_common.h"
+
+// Matrices at least this large are backed by transparent huge pages where the OS allows
+#define MATRIX_HUGE_PAGE_BYTES ((size_t)2 << 20)
+
+// Dense int matrix in one allocation. Rows start on a cache line, so row i is
+// data + i * stride and no row shares a line with its neighbour.
+typedef struct {
+    int rows;
+    int cols;
+    int stride;              // Ints per row, cols rounded up to a cache line
+    int* data;               // rows x stride ints, not touched until the owner writes them
+    size_t bytes;            // Size of the allocation
+    int huge_pages;          // 1 if data is a mapping advised for huge pages
+} IntMatrix;
+
+// Similarity matrix at one bit per cell: bit j%64 of word j/64 in row i is set when
+// reference[i] == query[j]. Rows start on a cache line, padding bits are zero.
+typedef struct {
+    int rows;                // Reference length
+    int cols;                // Query length
+    int words_per_row;       // Row stride in 64-bit words, a multiple of a cache line
+    uint64_t* bits;          // rows x words_per_row words, one allocation
+} BitMatrix;
+
+// Tile edge used when the caller passes 0; tiles are square and a multiple of 64 cells wide
+#define MATRIX_TILE_DEFAULT 64
+
+// One cached tile of a TiledMatrix, bit-packed like BitMatrix rows
+typedef struct {
+    int tile_row;            // Tile coordinates, -1 while the slot is empty
+    int tile_col;
+    uint64_t* bits;          // tile_size rows x tile_words words
+    int lru_prev;            // Neighbours in the recency list (slot indices, -1 at the ends)
+    int lru_next;
+    int hash_next;           // Next slot in the same lookup bucket, -1 at the end
+} MatrixTile;
+
+// Similarity matrix computed tile by tile on demand from the two sequences. At most
+// max_tiles tiles are held; the least recently fetched one is recomputed into when full.
+// A TiledMatrix is not thread-safe: parallel callers create one per thread over the
+// same sequences.
+typedef struct {
+    const char* reference;
+    const char* query;
+    int rows;                // Reference length
+    int cols;                // Query length
+    int tile_size;           // Cells per tile edge
+    int tile_words;          // 64-bit words per tile row
+    int tiles_down;
+    int tiles_across;
+    MatrixTile* slots;
+    int max_tiles;
+    int num_used;
+    int lru_head;            // Most recently fetched slot
+    int lru_tail;            // Eviction candidate
+    int* buckets;            // Lookup table of slot chains, num_buckets entries
+    int num_buckets;
+    long long hits;
+    long long misses;
+} TiledMatrix;
+
+// Matching columns of one row, in increasing order
+typedef struct {
+    TiledMatrix* matrix;
+    int row;
+    int col;                 // Next column to examine
+    int end;                 // One past the last column
+} MatrixRowIterator;
+
+// Cells of one diagonal (reference - query = diagonal), in increasing reference order
+typedef struct {
+    TiledMatrix* matrix;
+    int i;                   // Next reference position
+    int end;                 // One past the last reference position
+    int diagonal;
+    int slot;                // Slot holding the current tile, -1 before the first fetch
+    int tile_row;
+    int tile_col;
+} MatrixDiagonalIterator;
+
+// Tiles covering a rectangle of cells, row-major
+typedef struct {
+    TiledMatrix* matrix;
+    int first_col;           // Tile columns [first_col, last_col]
+    int last_col;
+    int last_row;
+    int tile_row;            // Next tile
+    int tile_col;
+} MatrixTileIterator;
+
+// Function prototypes for the dense int matrix
+IntMatrix* create_int_matrix(int rows, int cols, int allow_huge_pages);
+void free_int_matrix(IntMatrix* matrix);
+
+// Function prototypes for the bit-packed similarity matrix
+BitMatrix* build_bit_matrix(const char* reference, int ref_len, const char* query, int query_len);
+void free_bit_matrix(BitMatrix* matrix);
+
+// Function prototypes for the tiled similarity matrix
+TiledMatrix* create_tiled_matrix(const char* reference, int ref_len, const char* query, int query_len,
+                                 int tile_size, int max_tiles);
+void free_tiled_matrix(TiledMatrix* matrix);
+const uint64_t* tiled_matrix_tile(TiledMatrix* matrix, int tile_row, int tile_col);
+int tiled_matrix_get(TiledMatrix* matrix, int i, int j);
+void matrix_row_iterator_init(MatrixRowIterator* it, TiledMatrix* matrix, int row, int first_col, int end_col);
+int matrix_row_iterator_next(MatrixRowIterator* it, int* col);
+void matrix_diagonal_iterator_init(MatrixDiagonalIterator* it, TiledMatrix* matrix, int diagonal,
+                                   int first_ref, int end_ref);
+int matrix_diagonal_iterator_next(MatrixDiagonalIterator* it, int* i, int* match);
+void matrix_tile_iterator_init(MatrixTileIterator* it, TiledMatrix* matrix, int first_row, int first_col,
+                               int end_row, int end_col);
+const uint64_t* matrix_tile_iterator_next(MatrixTileIterator* it, int* tile_row, int* tile_col);
+
+// Ints of row i
+FORCE_INLINE int* int_matrix_row(const IntMatrix* matrix, int i) {
+    return matrix->data + (size_t)i * matrix->stride;
+}
+
+// Words of row i
+FORCE_INLINE const uint64_t* bit_matrix_row(const BitMatrix* matrix, int i) {
+    return matrix->bits + (size_t)i * matrix->words_per_row;
+}
+
+// 1 if reference[i] == query[j], 0 otherwise
+FORCE_INLINE int bit_matrix_get(const BitMatrix* matrix, int i, int j) {
+    return (int)((bit_matrix_row(matrix, i)[j >> 6] >> (j & 63)) & 1);
+}
+
+// Cell value as build_similarity_matrix stores it: 1 for a match, -1 otherwise
+FORCE_INLINE int bit_matrix_score(const BitMatrix* matrix, int i, int j) {
+    return bit_matrix_get(matrix, i, j) ? 1 : -1;
+}
+
+// Number of matching cells in row i
+FORCE_INLINE int bit_matrix_row_matches(const BitMatrix* matrix, int i) {
+    const uint64_t* row = bit_matrix_row(matrix, i);
+    int count = 0;
+    for (int w = 0; w < matrix->words_per_row; w++) {
+        count += __builtin_popcountll(row[w]);
+    }
+    return count;
+}
+
+#endif // DNA_MATRIX_H
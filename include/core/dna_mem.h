@@ -0,0 +1,39 @@
+#ifndef DNA_MEM_H
+#define DNA_MEM_H
+
+#include "dna_common.h"
+
+// Default shortest maximal exact match, same lower bound as the graph engine
+#define MEM_DEFAULT_MIN_LENGTH 50
+
+// Bucket table over the first MEM_BUCKET_K bases narrows every suffix array search
+#define MEM_BUCKET_K 10
+
+// Suffix array of the reference with a k-mer bucket table in front of it
+typedef struct {
+    const char* text;        // Indexed reference (not owned)
+    int length;              // Reference length
+    int* sa;                 // Suffix start positions in lexicographic order
+    int bucket_k;            // Prefix length of the bucket table
+    int* bucket_start;       // First SA slot of every 2-bit packed prefix
+    int* bucket_end;         // One past the last SA slot of every prefix
+} SuffixIndex;
+
+// One maximal exact match. For strand 1 the query interval is the reverse
+// complement of reference[ref_pos, ref_pos + length).
+typedef struct {
+    int query_pos;
+    int ref_pos;
+    int length;
+    int strand;
+} MemRecord;
+
+// Function prototypes for MEM enumeration
+SuffixIndex* build_suffix_index(const char* reference, int ref_len);
+void free_suffix_index(SuffixIndex* index);
+MemRecord* find_mems(const SuffixIndex* index, const char* query, int query_len, int min_length,
+                     int smem_only, FILE* stream, int* num_mems);
+RepeatPattern* find_repeats_mem(const char* reference, int ref_len, const char* query, int query_len,
+                                FILE* stream, int* num_repeats);
+
+#endif // DNA_MEM_H
@@ -0,0 +1,63 @@
+#ifndef DNA_TOPK_H
+#define DNA_TOPK_H
+
+#include "dna_common.h"
+#include "dna_index.h"
+
+// Score used to rank repeats, same as the STL finder: length x count
+FORCE_INLINE long long repeat_score(const RepeatPattern* repeat) {
+    return (long long)repeat->length * repeat->count;
+}
+
+// Which copy of a self-mode pair a search reports, by the copy's offset in the target
+typedef enum {
+    SELF_ALL = 0,           // Not a self search: every match
+    SELF_TARGET_AFTER,      // Forward matches whose target copy lies right of the position
+    SELF_TARGET_BEFORE,     // Forward matches whose target copy lies left of the position
+    SELF_MIRROR             // Reverse matches whose query copy does not lie left of the position
+} SelfRule;
+
+// The matches a full search reports on one strand. A top-K search resolves a reference
+// position to the repeat the full search keeps there (filter_nested_repeats keeps the
+// longest per position and strand) and scores it with its real instance count before
+// offering it, so every thread offers the same repeat for a position and strand and a
+// heap's weakest score is a true lower bound on the final top K.
+typedef struct {
+    const char* target;      // Query, or its reverse complement for reverse repeats
+    int target_len;
+    const KmerIndex* index;  // k-mer index of target, k at most min_length
+    int is_reverse;
+    int min_length;          // Shortest match reported
+    int max_length;          // Longest match reported, 0 for no limit
+    int bases_only;          // N never matches (the diagonal scan); otherwise bytes compare
+    SelfRule self_rule;
+    int seed_step;           // Matches are found from seeds at multiples of seed_step...
+    int seed_length;         // ...seed_length bases long and lying inside the match
+} RepeatScope;
+
+// Bounded min-heap holding the k best repeats seen so far in compare_by_score order; the
+// root is the weakest kept repeat, so the bar a new candidate has to clear is one read away.
+// A repeat (reference position, query position, strand) is kept once.
+typedef struct {
+    RepeatPattern* items;    // Heap ordered by rank, weakest at items[0]
+    int size;                // Repeats currently kept
+    int capacity;            // k
+    int* slots;              // Open-addressing index over repeat keys: heap index + 1, 0 if empty
+    long long* slot_keys;    // Key held in each used slot
+    int slot_mask;           // Slot count - 1, a power of two at least twice the capacity
+} TopKHeap;
+
+// Function prototypes for top-K selection
+TopKHeap* create_topk_heap(int k);
+void free_topk_heap(TopKHeap* heap);
+int topk_offer(TopKHeap* heap, const RepeatPattern* repeat);
+long long topk_threshold(const TopKHeap* heap, const long long* shared_floor);
+void topk_publish_floor(const TopKHeap* heap, long long* shared_floor);
+void topk_merge(TopKHeap* into, TopKHeap* from);
+RepeatPattern* topk_release(TopKHeap* heap, int* count);
+long long repeat_score_bound(const RepeatScope* scope, const char* reference, int ref_len, int position);
+int resolve_repeat(const RepeatScope* scope, const char* reference, int ref_len, int position, 
+                   RepeatPattern* repeat);
+RepeatPattern* select_top_repeats(RepeatPattern* repeats, int num_repeats, int k, int* kept);
+
+#endif // DNA_TOPK_H
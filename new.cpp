@@ -9,6 +9,10 @@
 #include <atomic>
 #include <memory>
 #include <algorithm>
+#include <stdint.h>
+#include <unordered_map>
+#include <map>
+#include <string>
 
 // 前向声明
 class DNASequence;
@@ -16,6 +20,102 @@ class HashTable;
 class RepeatFinder;
 class FuzzyMatcher;
 
+// 碱基编码：A=0, C=1, G=2, T=3，其他字符返回-1
+static inline int baseCode(char c) {
+    switch (c) {
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': return 3;
+        default: return -1;
+    }
+}
+
+// Myers/Hyyrö 位向量编辑距离
+// 模式串按64位分块，每一列用垂直差分向量 Pv/Mv 表示，一次处理64个单元格
+class MyersPattern {
+private:
+    int length;
+    int blocks;
+    uint64_t lastBit;              // 最后一块中模式串末位对应的位
+    std::vector<uint64_t> peq;     // peq[c * blocks + b]：碱基c在第b块中出现的位置
+
+    // 推进一个块，hin为上一块传入的水平差分(-1/0/+1)，返回该块输出的水平差分
+    static inline int advanceBlock(uint64_t& pv, uint64_t& mv, uint64_t eq, int hin, uint64_t outBit) {
+        uint64_t xv = eq | mv;
+        if (hin < 0) eq |= 1ULL;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        int hout = 0;
+        if (ph & outBit) hout = 1;
+        else if (mh & outBit) hout = -1;
+
+        ph <<= 1;
+        mh <<= 1;
+        if (hin < 0) mh |= 1ULL;
+        else if (hin > 0) ph |= 1ULL;
+
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+        return hout;
+    }
+
+    // 逐列计算，globalStart为真时第0行为D[0][j]=j（全局比对），否则为0（在text中任意位置开始）
+    template <typename Visitor>
+    void run(const char* text, int n, bool globalStart, Visitor visit) const {
+        std::vector<uint64_t> pv(blocks, ~0ULL), mv(blocks, 0ULL);
+        int score = length;
+
+        for (int j = 0; j < n; j++) {
+            int c = baseCode(text[j]);
+            int carry = globalStart ? 1 : 0;
+            for (int b = 0; b < blocks; b++) {
+                uint64_t eq = c < 0 ? 0ULL : peq[c * blocks + b];
+                uint64_t outBit = (b == blocks - 1) ? lastBit : (1ULL << 63);
+                carry = advanceBlock(pv[b], mv[b], eq, carry, outBit);
+            }
+            score += carry;
+            if (!visit(j, score)) return;
+        }
+    }
+
+public:
+    MyersPattern(const char* pattern, int m)
+        : length(m), blocks((m + 63) / 64), lastBit(1ULL << ((m - 1) % 64)), peq(4 * ((m + 63) / 64), 0ULL) {
+        for (int i = 0; i < m; i++) {
+            int c = baseCode(pattern[i]);
+            if (c >= 0) {
+                peq[c * blocks + i / 64] |= 1ULL << (i % 64);
+            }
+        }
+    }
+
+    int getLength() const { return length; }
+
+    // 模式串与text整体的编辑距离
+    int globalDistance(const char* text, int n) const {
+        if (n == 0) return length;
+        int result = length;
+        run(text, n, true, [&](int, int score) { result = score; return true; });
+        return result;
+    }
+
+    // 在text中查找编辑距离不超过maxEdits的最佳结束位置，未找到返回-1
+    int search(const char* text, int n, int maxEdits, int* bestEnd) const {
+        int best = -1;
+        run(text, n, false, [&](int j, int score) {
+            if (score <= maxEdits && (best < 0 || score < best)) {
+                best = score;
+                *bestEnd = j;
+            }
+            return best != 0;
+        });
+        return best;
+    }
+};
+
 // DNA序列类
 class DNASequence {
 private:
@@ -106,13 +206,21 @@ class FuzzyMatcher {
 private:
     float similarityThreshold;
     int windowSize;
+    int maxEdits;   // 允许的最大编辑次数，-1表示由相似度阈值换算
 
 public:
-    FuzzyMatcher(float threshold = 0.85f, int wSize = 3) 
-        : similarityThreshold(threshold), windowSize(wSize) {}
+    FuzzyMatcher(float threshold = 0.85f, int wSize = 3, int edits = -1) 
+        : similarityThreshold(threshold), windowSize(wSize), maxEdits(edits) {}
+
+    // 长度为length的片段允许的编辑次数
+    int maxEditsFor(int length) const {
+        if (maxEdits >= 0) return maxEdits;
+        return (int)((1.0f - similarityThreshold) * length);
+    }
 
     bool isMatch(const char* str1, const char* str2, int length) const {
-        return calculateSimilarity(str1, str2, length) >= similarityThreshold;
+        MyersPattern pattern(str1, length);
+        return pattern.globalDistance(str2, length) <= maxEditsFor(length);
     }
 
     unsigned int getHash(const char* str, int length) const {
@@ -127,15 +235,10 @@ public:
         return hash;
     }
 
-private:
+    // 基于编辑距离的相似度
     float calculateSimilarity(const char* seq1, const char* seq2, int length) const {
-        int matches = 0;
-        for (int i = 0; i < length; i++) {
-            if (seq1[i] == seq2[i]) {
-                matches++;
-            }
-        }
-        return (float)matches / length;
+        MyersPattern pattern(seq1, length);
+        return 1.0f - (float)pattern.globalDistance(seq2, length) / length;
     }
 };
 
@@ -312,6 +415,218 @@ struct RepeatPattern {
     bool is_reverse;
     char* original_sequence;
     int query_position;
+    int edit_distance;   // 近似匹配的编辑次数，精确匹配为0
+};
+
+// 近似重复查找器：精确k-mer种子（鸽巢原理）筛选候选区域，再用Myers位向量验证
+// 长度为L、最多k次编辑的匹配中，把窗口切成k+1段，至少有一段与查询序列精确相同
+class ApproximateRepeatFinder {
+private:
+    struct WindowHit {
+        int ref_pos;
+        int query_start;
+        int query_end;
+        int edits;
+        bool is_reverse;
+    };
+
+    const DNASequence* query;
+    const DNASequence* reference;
+    int windowLength;
+    int maxEdits;
+    int seedLength;
+    std::unordered_map<uint64_t, std::vector<int>> seedIndex;
+
+    // 将seedLength个碱基打包为2位编码
+    bool packSeed(const char* seq, uint64_t* key) const {
+        uint64_t value = 0;
+        for (int i = 0; i < seedLength; i++) {
+            int c = baseCode(seq[i]);
+            if (c < 0) return false;
+            value = (value << 2) | (uint64_t)c;
+        }
+        *key = value;
+        return true;
+    }
+
+    // 为查询序列的所有种子建立索引
+    void buildSeedIndex() {
+        const char* seq = query->getSequence();
+        int len = query->getLength();
+        seedIndex.reserve(len);
+        for (int i = 0; i + seedLength <= len; i++) {
+            uint64_t key;
+            if (packSeed(seq + i, &key)) {
+                seedIndex[key].push_back(i);
+            }
+        }
+    }
+
+    // 在查询序列中查找窗口的所有近似出现
+    void searchWindow(const char* window, int ref_pos, bool is_reverse, std::vector<WindowHit>& hits) const {
+        const char* seq = query->getSequence();
+        int len = query->getLength();
+
+        // 每段种子精确命中给出一个候选起点（对角线）
+        std::vector<int> starts;
+        for (int piece = 0; piece <= maxEdits; piece++) {
+            uint64_t key;
+            if (!packSeed(window + piece * seedLength, &key)) continue;
+            auto it = seedIndex.find(key);
+            if (it == seedIndex.end()) continue;
+            for (int pos : it->second) {
+                starts.push_back(pos - piece * seedLength);
+            }
+        }
+        if (starts.empty()) return;
+
+        std::sort(starts.begin(), starts.end());
+        starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+
+        MyersPattern pattern(window, windowLength);
+        std::string reversed_window(window, windowLength);
+        std::reverse(reversed_window.begin(), reversed_window.end());
+        MyersPattern reversed_pattern(reversed_window.c_str(), windowLength);
+
+        // 合并相近的候选起点，每个区域只验证一次
+        size_t c = 0;
+        while (c < starts.size()) {
+            int lo = std::max(0, starts[c] - maxEdits);
+            int hi = starts[c] + windowLength + maxEdits;
+            while (c + 1 < starts.size() && starts[c + 1] - maxEdits <= hi - windowLength) {
+                c++;
+                hi = starts[c] + windowLength + maxEdits;
+            }
+            c++;
+            hi = std::min(hi, len);
+            if (hi <= lo) continue;
+
+            int end;
+            int edits = pattern.search(seq + lo, hi - lo, maxEdits, &end);
+            if (edits < 0) continue;
+
+            // 反向搜索得到匹配的起点
+            std::string reversed_text(seq + lo, end + 1);
+            std::reverse(reversed_text.begin(), reversed_text.end());
+            int reversed_end = end;
+            reversed_pattern.search(reversed_text.c_str(), end + 1, edits, &reversed_end);
+
+            hits.push_back({ref_pos, lo + end - reversed_end, lo + end, edits, is_reverse});
+        }
+    }
+
+    void workerThread(TaskDistributor& distributor, std::vector<WindowHit>& hits) const {
+        const char* ref = reference->getSequence();
+        char* rev_comp = nullptr;
+        int start, end;
+        while (distributor.getNextSegment(start, end)) {
+            for (int i = start; i < end; i++) {
+                searchWindow(ref + i, i, false, hits);
+
+                rev_comp = DNASequence::getReverseComplement(ref + i, windowLength);
+                searchWindow(rev_comp, i, true, hits);
+                free(rev_comp);
+            }
+        }
+    }
+
+public:
+    ApproximateRepeatFinder(const DNASequence* q, const DNASequence* r, int window, int edits)
+        : query(q), reference(r), windowLength(window), maxEdits(edits) {
+        seedLength = std::min(32, windowLength / (maxEdits + 1));
+        buildSeedIndex();
+    }
+
+    // 查找近似重复，相邻窗口落在同一(反)对角线附近的命中合并为一个重复
+    std::vector<RepeatPattern> findRepeats() {
+        std::vector<RepeatPattern> results;
+        int windows = reference->getLength() - windowLength + 1;
+        if (windows <= 0 || seedLength < 1) return results;
+
+        printf("Approximate search: window=%d, max edits=%d, seed length=%d\n",
+               windowLength, maxEdits, seedLength);
+
+        size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+        TaskDistributor distributor(windows);
+        std::vector<std::vector<WindowHit>> thread_hits(num_threads);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < num_threads; t++) {
+            threads.emplace_back(&ApproximateRepeatFinder::workerThread, this,
+                                 std::ref(distributor), std::ref(thread_hits[t]));
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        std::vector<WindowHit> hits;
+        for (auto& local : thread_hits) {
+            hits.insert(hits.end(), local.begin(), local.end());
+        }
+        std::sort(hits.begin(), hits.end(), [](const WindowHit& a, const WindowHit& b) {
+            if (a.ref_pos != b.ref_pos) return a.ref_pos < b.ref_pos;
+            return a.query_start < b.query_start;
+        });
+
+        // 正向重复沿对角线 query_start - ref_pos 延伸，反向互补沿反对角线 query_start + ref_pos 延伸
+        struct Chain {
+            int first_ref;
+            int last_ref;
+            int query_start;
+            int query_end;
+            bool is_reverse;
+        };
+        std::vector<Chain> chains;
+        std::map<std::pair<bool, int>, size_t> open_chains;
+
+        for (const auto& hit : hits) {
+            int diagonal = hit.is_reverse ? hit.query_start + hit.ref_pos : hit.query_start - hit.ref_pos;
+            auto it = open_chains.lower_bound({hit.is_reverse, diagonal - maxEdits});
+            bool extended = false;
+            while (it != open_chains.end() && it->first.first == hit.is_reverse &&
+                   it->first.second <= diagonal + maxEdits) {
+                Chain& chain = chains[it->second];
+                if (chain.last_ref == hit.ref_pos - 1) {
+                    chain.last_ref = hit.ref_pos;
+                    if (hit.is_reverse) chain.query_start = hit.query_start;
+                    else chain.query_end = hit.query_end;
+                    size_t index = it->second;
+                    open_chains.erase(it);
+                    open_chains[{hit.is_reverse, diagonal}] = index;
+                    extended = true;
+                    break;
+                }
+                ++it;
+            }
+            if (!extended) {
+                chains.push_back({hit.ref_pos, hit.ref_pos, hit.query_start, hit.query_end, hit.is_reverse});
+                open_chains[{hit.is_reverse, diagonal}] = chains.size() - 1;
+            }
+        }
+
+        // 相邻窗口重叠，逐窗口的编辑数会重复计入共享的编辑；
+        // 整条链的编辑数是参考区段（反向时取其反向互补）与查询区间的全局编辑距离
+        const char* ref = reference->getSequence();
+        const char* seq = query->getSequence();
+        for (const auto& chain : chains) {
+            RepeatPattern pattern;
+            pattern.position = chain.first_ref;
+            pattern.length = chain.last_ref - chain.first_ref + windowLength;
+            pattern.repeat_count = 1;
+            pattern.is_reverse = chain.is_reverse;
+            pattern.original_sequence = strndup(ref + pattern.position, pattern.length);
+            pattern.query_position = chain.query_start;
+
+            char* oriented = chain.is_reverse
+                ? DNASequence::getReverseComplement(pattern.original_sequence, pattern.length)
+                : pattern.original_sequence;
+            MyersPattern span(oriented, pattern.length);
+            pattern.edit_distance = span.globalDistance(seq + chain.query_start,
+                                                        chain.query_end - chain.query_start + 1);
+            if (oriented != pattern.original_sequence) free(oriented);
+            results.push_back(pattern);
+        }
+        return results;
+    }
 };
 
 // 修改 RepeatFinder 类
@@ -338,10 +653,10 @@ private:
     };
 
 public:
-    RepeatFinder(const char* query_file, const char* reference_file) {
+    RepeatFinder(const char* query_file, const char* reference_file, int max_edits = -1) {
         query = new DNASequence(query_file);
         reference = new DNASequence(reference_file);
-        matcher = new FuzzyMatcher();
+        matcher = new FuzzyMatcher(0.85f, 3, max_edits);
         hashTable = new HashTable(16384, matcher);
     }
 
@@ -419,6 +734,24 @@ public:
         return repeats;
     }
 
+    // 近似重复模式：以windowLength为窗口，编辑次数上限由FuzzyMatcher给出
+    RepeatPattern* findApproximateRepeats(int windowLength, int* repeat_count) {
+        printf("Query sequence length: %d\n", query->getLength());
+        printf("Reference sequence length: %d\n", reference->getLength());
+
+        ApproximateRepeatFinder approx(query, reference, windowLength,
+                                       matcher->maxEditsFor(windowLength));
+        std::vector<RepeatPattern> found = approx.findRepeats();
+
+        *repeat_count = (int)found.size();
+        RepeatPattern* repeats = (RepeatPattern*)malloc(
+            sizeof(RepeatPattern) * std::max<size_t>(1, found.size()));
+        std::copy(found.begin(), found.end(), repeats);
+
+        quickSortRepeats(repeats, 0, *repeat_count - 1);
+        return repeats;
+    }
+
 private:
     void workerThread(size_t thread_id, HashTable* local_hash_table,
                      std::vector<RepeatPattern>& local_results,
@@ -509,6 +842,7 @@ private:
             pattern.is_reverse = is_reverse;
             pattern.original_sequence = strdup(sequence);
             pattern.query_position = positions[g];
+            pattern.edit_distance = 0;
             
             results.push_back(pattern);
             count++;
@@ -622,6 +956,7 @@ private:
             repeats[*repeat_count].is_reverse = is_reverse;
             repeats[*repeat_count].original_sequence = strdup(sequence);
             repeats[*repeat_count].query_position = positions[g];
+            repeats[*repeat_count].edit_distance = 0;
             (*repeat_count)++;
         }
 
@@ -740,12 +1075,14 @@ private:
     
             fprintf(output, "Found %d repeat fragments\n", repeat_count);
             for (int i = 0; i < repeat_count; i++) {
-                fprintf(output, "Repeat #%d: Position %d, Length %d, Repeat Count %d, Is Reverse Repeat %s\n",
+                fprintf(output, "Repeat #%d: Position %d, Query Position %d, Length %d, Repeat Count %d, Is Reverse Repeat %s, Edits %d\n",
                     i + 1,
                     repeats[i].position,
+                    repeats[i].query_position,
                     repeats[i].length,
                     repeats[i].repeat_count,
-                    repeats[i].is_reverse ? "Yes" : "No");
+                    repeats[i].is_reverse ? "Yes" : "No",
+                    repeats[i].edit_distance);
             }
     
             fclose(output);
@@ -757,18 +1094,37 @@ int main(int argc, char* argv[]) {
     const char* query_file = "query.txt"; // 修改为 const char*
     const char* reference_file = "reference.txt";
 
-    if (argc >= 3) {
-        reference_file = argv[1];
-        query_file = argv[2];
+    // 可选参数：--max-edits K 启用近似匹配，--window L 设置近似匹配窗口长度
+    int max_edits = -1;
+    int window_length = 50;
+    bool approximate = false;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--max-edits") == 0 && i + 1 < argc) {
+            max_edits = atoi(argv[++i]);
+            approximate = true;
+        } else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) {
+            window_length = atoi(argv[++i]);
+            approximate = true;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+
+    if (files.size() >= 2) {
+        reference_file = files[0];
+        query_file = files[1];
     }
 
     // 开始计时
     clock_t start_time = clock();
 
     // 创建重复查找器并处理序列
-    RepeatFinder finder(query_file, reference_file);
+    RepeatFinder finder(query_file, reference_file, max_edits);
     int repeat_count;
-    RepeatPattern* repeats = finder.findRepeats(&repeat_count);
+    RepeatPattern* repeats = approximate
+        ? finder.findApproximateRepeats(window_length, &repeat_count)
+        : finder.findRepeats(&repeat_count);
 
     // 计算耗时
     clock_t end_time = clock();
@@ -778,13 +1134,15 @@ int main(int argc, char* argv[]) {
     printf("Found %d repeat fragments, elapsed time: %.2f ms\n", 
            repeat_count, time_spent * 1000);
     for (int i = 0; i < repeat_count; i++) {
-        printf("Repeat #%d: Position %d, Length %d, Repeat Count %d, "
-               "Is Reverse Repeat %s\n",
+        printf("Repeat #%d: Position %d, Query Position %d, Length %d, Repeat Count %d, "
+               "Is Reverse Repeat %s, Edits %d\n",
                i + 1,
                repeats[i].position,
+               repeats[i].query_position,
                repeats[i].length,
                repeats[i].repeat_count,
-               repeats[i].is_reverse ? "Yes" : "No");
+               repeats[i].is_reverse ? "Yes" : "No",
+               repeats[i].edit_distance);
     }
 
     // 保存结果
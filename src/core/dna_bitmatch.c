@@ -0,0 +1,296 @@
+#include "../include/core/dna_bitmatch.h"
+#include <stdint.h>
+
+// Shift-Or keeps one state bit per pattern position: bit j of D is 0 while
+// pattern[0..j] matches the text ending at the current base. A match ends
+// wherever bit m-1 is 0. Masks are indexed by base code, code 4 never matches.
+
+typedef unsigned __int128 uint128_t;
+
+// Encode the text once so every search uses a 5-entry mask table lookup
+BitmatchText* prepare_bitmatch_text(const char* sequence, int length) {
+    BitmatchText* text = (BitmatchText*)malloc(sizeof(BitmatchText));
+    if (UNLIKELY(!text)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    text->sequence = sequence;
+    text->length = length;
+    text->codes = (unsigned char*)aligned_alloc_cache(length > 0 ? length : 1);
+    if (UNLIKELY(!text->codes)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    #pragma omp parallel for schedule(static) if (length > PARALLEL_THRESHOLD)
+    for (int i = 0; i < length; i++) {
+        int code = dna_base_code(sequence[i]);
+        text->codes[i] = (unsigned char)(code < 0 ? 4 : code);
+    }
+    
+    return text;
+}
+
+// Build the 128-bit masks for the first BITMATCH_WORD_PATTERN bases of a pattern.
+// Returns 0 if the pattern contains a base that can never match.
+static int build_masks_128(const char* pattern, int pattern_len, uint128_t masks[5]) {
+    int m = pattern_len < BITMATCH_WORD_PATTERN ? pattern_len : BITMATCH_WORD_PATTERN;
+    for (int c = 0; c < 5; c++) masks[c] = ~(uint128_t)0;
+    for (int j = 0; j < m; j++) {
+        int code = dna_base_code(pattern[j]);
+        if (code < 0) return 0;
+        masks[code] &= ~((uint128_t)1 << j);
+    }
+    return 1;
+}
+
+// Record a match ending at end_pos if the (optional) pattern tail also matches
+static inline int accept_match(const BitmatchText* text, const char* pattern, int pattern_len, int end_pos) {
+    if (pattern_len <= BITMATCH_WORD_PATTERN) return 1;
+    int start = end_pos - BITMATCH_WORD_PATTERN + 1;
+    return start + pattern_len <= text->length &&
+           memcmp(text->sequence + start + BITMATCH_WORD_PATTERN, pattern + BITMATCH_WORD_PATTERN,
+                  pattern_len - BITMATCH_WORD_PATTERN) == 0;
+}
+
+// Scalar Shift-Or on 64-bit state for patterns up to 64 bases
+static int shift_or_64(const BitmatchText* text, const char* pattern, int pattern_len, int* offsets, int max_offsets) {
+    uint128_t wide[5];
+    if (!build_masks_128(pattern, pattern_len, wide)) return 0;
+    
+    uint64_t masks[5];
+    for (int c = 0; c < 5; c++) masks[c] = (uint64_t)wide[c];
+    
+    const unsigned char* codes = text->codes;
+    const uint64_t hit = 1ULL << (pattern_len - 1);
+    uint64_t state = ~0ULL;
+    int count = 0;
+    
+    for (int i = 0; i < text->length; i++) {
+        state = (state << 1) | masks[codes[i]];
+        if (UNLIKELY(!(state & hit))) {
+            if (offsets) offsets[count] = i - pattern_len + 1;
+            if (++count >= max_offsets) break;
+        }
+    }
+    return count;
+}
+
+// Scalar Shift-Or on 128-bit state; longer patterns match their prefix and verify the tail
+static int shift_or_128(const BitmatchText* text, const char* pattern, int pattern_len, int* offsets, int max_offsets) {
+    uint128_t masks[5];
+    if (!build_masks_128(pattern, pattern_len, masks)) return 0;
+    
+    int m = pattern_len < BITMATCH_WORD_PATTERN ? pattern_len : BITMATCH_WORD_PATTERN;
+    const unsigned char* codes = text->codes;
+    const uint128_t hit = (uint128_t)1 << (m - 1);
+    uint128_t state = ~(uint128_t)0;
+    int count = 0;
+    
+    for (int i = 0; i < text->length; i++) {
+        state = (state << 1) | masks[codes[i]];
+        if (UNLIKELY(!(state & hit)) && accept_match(text, pattern, pattern_len, i)) {
+            if (offsets) offsets[count] = i - m + 1;
+            if (++count >= max_offsets) break;
+        }
+    }
+    return count;
+}
+
+// Find up to max_offsets occurrence offsets of a pattern in the text; with NULL offsets
+// the occurrences are only counted
+int bitmatch_search(const BitmatchText* text, const char* pattern, int pattern_len, int* offsets, int max_offsets) {
+    if (pattern_len <= 0 || pattern_len > text->length || max_offsets <= 0) return 0;
+    
+    if (pattern_len <= 64) {
+        return shift_or_64(text, pattern, pattern_len, offsets, max_offsets);
+    }
+    return shift_or_128(text, pattern, pattern_len, offsets, max_offsets);
+}
+
+#ifdef __AVX2__
+// Four patterns of up to 64 bases, one per 64-bit lane, advanced by one shared text scan
+static void shift_or_x4(const BitmatchText* text, const char* const* patterns, const int* pattern_lens, int n,
+                        int* const* offsets, const int* max_offsets, int* counts) {
+    uint64_t lane_masks[5][4] ALIGN_TO_CACHE;
+    uint64_t hits[4] ALIGN_TO_CACHE = {0, 0, 0, 0};
+    int remaining = 0;
+    
+    for (int c = 0; c < 5; c++) {
+        for (int l = 0; l < 4; l++) lane_masks[c][l] = ~0ULL;
+    }
+    for (int l = 0; l < n; l++) {
+        uint128_t wide[5];
+        counts[l] = 0;
+        if (pattern_lens[l] > text->length || max_offsets[l] <= 0 ||
+            !build_masks_128(patterns[l], pattern_lens[l], wide)) {
+            continue;
+        }
+        for (int c = 0; c < 5; c++) lane_masks[c][l] = (uint64_t)wide[c];
+        hits[l] = 1ULL << (pattern_lens[l] - 1);
+        remaining++;
+    }
+    if (remaining == 0) return;
+    
+    __m256i table[5];
+    for (int c = 0; c < 5; c++) {
+        table[c] = _mm256_load_si256((const __m256i*)lane_masks[c]);
+    }
+    __m256i hit_bits = _mm256_load_si256((const __m256i*)hits);
+    __m256i state = _mm256_set1_epi64x(-1);
+    uint64_t lanes[4] ALIGN_TO_CACHE;
+    
+    const unsigned char* codes = text->codes;
+    for (int i = 0; i < text->length; i++) {
+        state = _mm256_or_si256(_mm256_slli_epi64(state, 1), table[codes[i]]);
+        
+        // A lane matched if its hit bit is clear in the state
+        __m256i matched = _mm256_andnot_si256(state, hit_bits);
+        if (LIKELY(_mm256_testz_si256(matched, matched))) continue;
+        
+        _mm256_store_si256((__m256i*)lanes, matched);
+        for (int l = 0; l < n; l++) {
+            if (!lanes[l]) continue;
+            offsets[l][counts[l]++] = i - pattern_lens[l] + 1;
+            if (counts[l] >= max_offsets[l]) {
+                hits[l] = 0;
+                remaining--;
+            }
+        }
+        if (remaining == 0) break;
+        hit_bits = _mm256_load_si256((const __m256i*)hits);
+    }
+}
+
+// Two patterns of up to 128 bases, each spread over a 128-bit lane as (low, high) words.
+// The carry out of the low word is moved into the high word with an in-lane byte shift.
+static void shift_or_x2(const BitmatchText* text, const char* const* patterns, const int* pattern_lens, int n,
+                        int* const* offsets, const int* max_offsets, int* counts) {
+    uint64_t lane_masks[5][4] ALIGN_TO_CACHE;
+    uint64_t hits[4] ALIGN_TO_CACHE = {0, 0, 0, 0};
+    int prefix_lens[2] = {0, 0};
+    int remaining = 0;
+    
+    for (int c = 0; c < 5; c++) {
+        for (int w = 0; w < 4; w++) lane_masks[c][w] = ~0ULL;
+    }
+    for (int l = 0; l < n; l++) {
+        uint128_t wide[5];
+        counts[l] = 0;
+        if (pattern_lens[l] > text->length || max_offsets[l] <= 0 ||
+            !build_masks_128(patterns[l], pattern_lens[l], wide)) {
+            continue;
+        }
+        for (int c = 0; c < 5; c++) {
+            lane_masks[c][2 * l] = (uint64_t)wide[c];
+            lane_masks[c][2 * l + 1] = (uint64_t)(wide[c] >> 64);
+        }
+        int m = pattern_lens[l] < BITMATCH_WORD_PATTERN ? pattern_lens[l] : BITMATCH_WORD_PATTERN;
+        prefix_lens[l] = m;
+        if (m <= 64) {
+            hits[2 * l] = 1ULL << (m - 1);
+        } else {
+            hits[2 * l + 1] = 1ULL << (m - 65);
+        }
+        remaining++;
+    }
+    if (remaining == 0) return;
+    
+    __m256i table[5];
+    for (int c = 0; c < 5; c++) {
+        table[c] = _mm256_load_si256((const __m256i*)lane_masks[c]);
+    }
+    __m256i hit_bits = _mm256_load_si256((const __m256i*)hits);
+    __m256i state = _mm256_set1_epi64x(-1);
+    uint64_t words[4] ALIGN_TO_CACHE;
+    
+    const unsigned char* codes = text->codes;
+    for (int i = 0; i < text->length; i++) {
+        __m256i carry = _mm256_slli_si256(_mm256_srli_epi64(state, 63), 8);
+        state = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi64(state, 1), carry), table[codes[i]]);
+        
+        __m256i matched = _mm256_andnot_si256(state, hit_bits);
+        if (LIKELY(_mm256_testz_si256(matched, matched))) continue;
+        
+        _mm256_store_si256((__m256i*)words, matched);
+        for (int l = 0; l < n; l++) {
+            if (!(words[2 * l] | words[2 * l + 1])) continue;
+            if (!accept_match(text, patterns[l], pattern_lens[l], i)) continue;
+            offsets[l][counts[l]++] = i - prefix_lens[l] + 1;
+            if (counts[l] >= max_offsets[l]) {
+                hits[2 * l] = hits[2 * l + 1] = 0;
+                remaining--;
+            }
+        }
+        if (remaining == 0) break;
+        hit_bits = _mm256_load_si256((const __m256i*)hits);
+    }
+}
+#endif
+
+// Search several patterns at once. With AVX2, short patterns share a text scan four
+// to a register and patterns up to 128 bases two to a register.
+void bitmatch_search_batch(const BitmatchText* text, const char* const* patterns, const int* pattern_lens,
+                           int num_patterns, int* const* offsets, const int* max_offsets, int* counts) {
+#ifdef __AVX2__
+    const char* lane_patterns[4];
+    int lane_lens[4];
+    int* lane_offsets[4];
+    int lane_max[4];
+    int lane_index[4];
+    int lane_counts[4];
+    
+    // Short patterns, four lanes per scan
+    int n = 0;
+    for (int p = 0; p <= num_patterns; p++) {
+        if (p < num_patterns && !(pattern_lens[p] > 0 && pattern_lens[p] <= 64)) continue;
+        if (p < num_patterns) {
+            lane_patterns[n] = patterns[p];
+            lane_lens[n] = pattern_lens[p];
+            lane_offsets[n] = offsets[p];
+            lane_max[n] = max_offsets[p];
+            lane_index[n] = p;
+            n++;
+        }
+        if (n == 4 || (p == num_patterns && n > 0)) {
+            shift_or_x4(text, lane_patterns, lane_lens, n, lane_offsets, lane_max, lane_counts);
+            for (int l = 0; l < n; l++) counts[lane_index[l]] = lane_counts[l];
+            n = 0;
+        }
+    }
+    
+    // Long patterns, two lanes per scan
+    for (int p = 0; p <= num_patterns; p++) {
+        if (p < num_patterns && pattern_lens[p] <= 64) {
+            if (pattern_lens[p] <= 0) counts[p] = 0;
+            continue;
+        }
+        if (p < num_patterns) {
+            lane_patterns[n] = patterns[p];
+            lane_lens[n] = pattern_lens[p];
+            lane_offsets[n] = offsets[p];
+            lane_max[n] = max_offsets[p];
+            lane_index[n] = p;
+            n++;
+        }
+        if (n == 2 || (p == num_patterns && n > 0)) {
+            shift_or_x2(text, lane_patterns, lane_lens, n, lane_offsets, lane_max, lane_counts);
+            for (int l = 0; l < n; l++) counts[lane_index[l]] = lane_counts[l];
+            n = 0;
+        }
+    }
+#else
+    for (int p = 0; p < num_patterns; p++) {
+        counts[p] = bitmatch_search(text, patterns[p], pattern_lens[p], offsets[p], max_offsets[p]);
+    }
+#endif
+}
+
+// Free memory used by the prepared text (the original sequence is not owned)
+void free_bitmatch_text(BitmatchText* text) {
+    if (!text) return;
+    
+    free(text->codes);
+    free(text);
+}
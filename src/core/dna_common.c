@@ -1,5 +1,8 @@
 #include "../include/core/dna_common.h"
 
+// Global engine options (sampling mode by default)
+FinderOptions finder_options = {0};
+
 // Get the reverse complement of a DNA sequence
 char* get_reverse_complement(const char* sequence, int length) {
     char* result = (char*)malloc((length + 1) * sizeof(char));
@@ -22,6 +25,26 @@ char* get_reverse_complement(const char* sequence, int length) {
     return result;
 }
 
+// Allocate an array of repeat patterns. RepeatPattern is cache-line aligned, and
+// wide vector copies of it fault on anything less, so plain malloc is not enough.
+// Returns NULL on failure, like malloc.
+RepeatPattern* allocate_repeat_patterns(int count) {
+    size_t bytes = (size_t)(count > 0 ? count : 1) * sizeof(RepeatPattern);
+    return (RepeatPattern*)aligned_alloc_cache(bytes);
+}
+
+// Aligned replacement for realloc: move the first count repeats into a new array of
+// capacity entries and free the old one. Returns NULL and keeps the old array on failure.
+RepeatPattern* resize_repeat_patterns(RepeatPattern* repeats, int count, int capacity) {
+    RepeatPattern* resized = allocate_repeat_patterns(capacity);
+    if (!resized) return NULL;
+    if (repeats) {
+        memcpy(resized, repeats, (size_t)count * sizeof(RepeatPattern));
+        free(repeats);
+    }
+    return resized;
+}
+
 // Free memory used by repeat patterns
 void free_repeat_patterns(RepeatPattern* repeats, int count) {
     if (!repeats) return;
@@ -29,19 +52,56 @@ void free_repeat_patterns(RepeatPattern* repeats, int count) {
     for (int i = 0; i < count; i++) {
         free(repeats[i].orig_seq);
         
-        if (repeats[i].repeat_examples) {
-            for (int j = 0; j < repeats[i].num_examples; j++) {
-                free(repeats[i].repeat_examples[j]);
-            }
-            free(repeats[i].repeat_examples);
-        }
+        free(repeats[i].example_positions);
     }
     
     free(repeats);
 }
 
+// Report how many reference positions an engine visited and how fast
+void report_scan_throughput(const char* stage, int positions, double seconds) {
+    double rate = seconds > 0 ? positions / seconds : 0.0;
+    printf("%s: %d positions in %.3f s (%.0f positions/second)\n", stage, positions, seconds, rate);
+}
+
+// Report how many similarity matrix cells an engine compared and how fast
+void report_cell_throughput(const char* stage, long long cells, double seconds) {
+    double rate = seconds > 0 ? cells / seconds : 0.0;
+    printf("%s: %lld cells in %.3f s (%.0f cells/second)\n", stage, cells, seconds, rate);
+}
+
 // Print program usage instructions
 void print_usage(const char* program_name) {
-    printf("Usage: %s <reference_file> <query_file>\n", program_name);
-    printf("Example: %s reference.txt query.txt\n", program_name);
+    printf("Usage: %s [options] <reference_file> <query_file>\n", program_name);
+    printf("Options:\n");
+    printf("  --exact    Visit every reference position instead of sampling large inputs\n");
+    printf("  --engine <graph|diagonal|mem|traditional|auto>\n");
+    printf("             Repeat engine: seed graph (default), matrix-free diagonal runs,\n");
+    printf("             maximal exact matches on both strands, every segment length\n");
+    printf("             looked up in a query index with back-to-back copy counts, or\n");
+    printf("             whichever of graph and mem a cost model predicts to be fastest\n");
+    printf("             on this machine. The two report different result sets, so with\n");
+    printf("             auto the output can change with the input size and the machine;\n");
+    printf("             auto logs which one it used. Name an engine for stable output\n");
+    printf("  --smem     With --engine mem, report only super-maximal matches\n");
+    printf("  --min-mem <L>\n");
+    printf("             With --engine mem, shortest match reported (default 50)\n");
+    printf("  --top <K>  Keep only the K highest scoring repeats (length x count);\n");
+    printf("             engines skip candidates that cannot beat the current K-th best\n");
+    printf("  --self     Find repeats within one sequence (the only file argument);\n");
+    printf("             each pair of copies is reported once, identity matches skipped\n");
+    printf("  --state <file>\n");
+    printf("             Incremental mode: update the diagonal runs saved in file for the\n");
+    printf("             edited query and write only the changes (built on first use)\n");
+    printf("  --edits <file>\n");
+    printf("             With --state, apply \"<position> <deleted> <inserted|->\" lines in\n");
+    printf("             order instead of diffing against the query file\n");
+    printf("  --dotplot <file.ppm>\n");
+    printf("             Render a dot plot of both strands (forward red, reverse complement\n");
+    printf("             green) instead of searching for repeats\n");
+    printf("  --dotplot-size <N>\n");
+    printf("             With --dotplot, largest image side in pixels (default 4096)\n");
+    printf("  --families Group the query's repeats into families from its de Bruijn graph\n");
+    printf("             (k=31) and list where each family matches the reference\n");
+    printf("Example: %s --exact reference.txt query.txt\n", program_name);
 }
@@ -0,0 +1,261 @@
+#include "../include/core/dna_cost.h"
+#include "../include/core/dna_diagonal.h"
+#include "../include/core/dna_index.h"
+#include "../include/core/dna_mem.h"
+#include <math.h>
+#include <stdint.h>
+
+// Seed graph parameters, as chosen by build_dna_graph
+#define GRAPH_SAMPLED_POSITIONS 10000
+
+// Results of the timed loops land here so the compiler cannot drop them
+static volatile unsigned long long cost_sink;
+
+// Engines the automatic mode chooses from. Both report maximal exact matches of at least
+// 50 bases on both strands; the diagonal engine only finds forward runs, so it would
+// silently drop every reverse complement repeat and is never picked.
+static const EngineKind candidate_engines[] = {ENGINE_GRAPH, ENGINE_MEM};
+#define NUM_CANDIDATE_ENGINES ((int)(sizeof(candidate_engines) / sizeof(candidate_engines[0])))
+
+// Command-line name of an engine
+const char* engine_name(EngineKind engine) {
+    switch (engine) {
+        case ENGINE_GRAPH:    return "graph";
+        case ENGINE_DIAGONAL: return "diagonal";
+        case ENGINE_MEM:      return "mem";
+        case ENGINE_TRADITIONAL: return "traditional";
+        case ENGINE_AUTO:     return "auto";
+    }
+    return "unknown";
+}
+
+// What an engine reports. The candidates agree on the kind of match but not on the
+// result set, so the automatic mode logs which one it got.
+const char* engine_result_set(EngineKind engine) {
+    switch (engine) {
+        case ENGINE_GRAPH:    return "maximal matches of 50-100 bases on both strands, nested ones filtered, "
+                                     "at most 100 (seeds sampled on large inputs unless --exact)";
+        case ENGINE_DIAGONAL: return "forward diagonal runs of at least 50 bases, nested ones filtered";
+        case ENGINE_MEM:      return "every maximal exact match of at least --min-mem bases on both strands";
+        case ENGINE_TRADITIONAL: return "the longest reference segment of up to 120 bases at each position and strand "
+                                        "with a query occurrence, forward ones only when copies follow back to back "
+                                        "(positions sampled on large inputs unless --exact)";
+        case ENGINE_AUTO:     return "that of the engine the cost model picks";
+    }
+    return "unknown";
+}
+
+// Deterministic random bases so calibration does not depend on the input
+static char* random_bases(int length, unsigned long long seed) {
+    char* sequence = allocate_dna_sequence(length);
+    unsigned long long state = seed;
+    for (int i = 0; i < length; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        sequence[i] = "ACGT"[state & 3];
+    }
+    sequence[length] = '\0';
+    return sequence;
+}
+
+// Unaligned 32-base window of a packed array, as the diagonal scan reads it
+static inline unsigned long long window_at(const uint64_t* words, int w, int shift) {
+    unsigned long long window = words[w] >> shift;
+    if (shift) window |= words[w + 1] << (64 - shift);
+    return window;
+}
+
+// Time the diagonal scan's inner step: four unaligned windows (bases and invalid masks
+// of both sequences), XOR, and the fold of the 2-bit slots into a mismatch mask
+static double measure_word_ns(const char* a, const char* b, int length) {
+    PackedSequence* x = pack_sequence(a, length);
+    PackedSequence* y = pack_sequence(b, length);
+    int words = x->num_words - 1;
+    int rounds = 64;
+    unsigned long long sink = 0;
+    double elapsed = 0.0;
+    
+    // The first pass only warms the caches
+    for (int pass = 0; pass < 2; pass++) {
+        double start = omp_get_wtime();
+        for (int r = 0; r < rounds; r++) {
+            int shift_x = ((r * 5) & 31) << 1;
+            int shift_y = ((r * 7) & 31) << 1;
+            for (int w = 0; w < words; w++) {
+                unsigned long long diff = window_at(x->bases, w, shift_x) ^ window_at(y->bases, w, shift_y);
+                unsigned long long mismatch = ((diff | (diff >> 1)) & 0x5555555555555555ULL) |
+                                              window_at(x->invalid, w, shift_x) | window_at(y->invalid, w, shift_y);
+                if (mismatch) sink += __builtin_ctzll(mismatch) + __builtin_clzll(mismatch);
+            }
+        }
+        elapsed = omp_get_wtime() - start;
+    }
+    
+    free_packed_sequence(x);
+    free_packed_sequence(y);
+    cost_sink = sink;
+    return elapsed * 1e9 / ((double)rounds * words);
+}
+
+// Time a stable counting sort pass over random keys, the unit of the suffix array build
+static double measure_sort_ns(int length) {
+    int* in = (int*)malloc(length * sizeof(int));
+    int* out = (int*)malloc(length * sizeof(int));
+    int* key = (int*)malloc(length * sizeof(int));
+    int* counts = (int*)malloc((length + 1) * sizeof(int));
+    if (UNLIKELY(!in || !out || !key || !counts)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    unsigned int state = 12345;
+    for (int i = 0; i < length; i++) {
+        in[i] = i;
+        state = state * 1103515245u + 12345u;
+        key[i] = (int)((state >> 8) % (unsigned int)length);
+    }
+    
+    // Fault the buffers in first so the timed pass sees only cache behavior
+    memset(out, 0, length * sizeof(int));
+    memset(counts, 0, (length + 1) * sizeof(int));
+    double start = omp_get_wtime();
+    for (int i = 0; i < length; i++) counts[key[in[i]] + 1]++;
+    for (int k = 0; k < length; k++) counts[k + 1] += counts[k];
+    for (int i = 0; i < length; i++) out[counts[key[in[i]]]++] = in[i];
+    double elapsed = omp_get_wtime() - start;
+    cost_sink = out[length / 2];
+    
+    free(in);
+    free(out);
+    free(key);
+    free(counts);
+    return elapsed * 1e9 / length;
+}
+
+// Measure the kernel costs on synthetic sequences (single thread, a few milliseconds,
+// plus one large sort pass when max_length exceeds the calibration length)
+void measure_machine_profile(MachineProfile* profile, int max_length) {
+    int length = COST_CALIBRATION_LENGTH;
+    char* a = random_bases(length, 0x9E3779B97F4A7C15ULL);
+    char* b = random_bases(length, 0xD1B54A32D192ED03ULL);
+    
+    profile->threads = omp_get_max_threads();
+    profile->word_ns = measure_word_ns(a, b, length);
+    profile->sort_ns = measure_sort_ns(length);
+    
+    // Random scatter gets slower once the arrays leave the caches; only pay for that
+    // measurement when the input is large enough to need it
+    profile->sort_large_ns = max_length > length ? measure_sort_ns(COST_LARGE_LENGTH) : profile->sort_ns;
+    
+    int k = choose_kmer_size(length, KMER_INDEX_MAX_K);
+    double start = omp_get_wtime();
+    KmerIndex* index = build_kmer_index(a, length, k);
+    profile->index_ns = (omp_get_wtime() - start) * 1e9 / length;
+    
+    // Probe at scattered positions of the other sequence, as seeds from a second sequence do;
+    // the first pass only warms the caches
+    unsigned long long hits = 0;
+    int probes = length / 3;
+    for (int pass = 0; pass < 2; pass++) {
+        start = omp_get_wtime();
+        for (int p = 0; p < probes; p++) {
+            const int* positions;
+            int offset = (int)(((long long)p * 3 * 40503) % (length - k));
+            int found = kmer_index_lookup(index, b + offset, &positions);
+            if (found > 0) hits += positions[0];
+        }
+        profile->lookup_ns = (omp_get_wtime() - start) * 1e9 / probes;
+    }
+    cost_sink = hits;
+    
+    free_kmer_index(index);
+    free(a);
+    free(b);
+}
+
+// Counting sort cost per element for n keys, interpolated on log(n) between the two
+// measured sizes
+static double sort_ns_at(const MachineProfile* profile, double n) {
+    double lo = log2((double)COST_CALIBRATION_LENGTH), hi = log2((double)COST_LARGE_LENGTH);
+    double t = (log2(n > 1 ? n : 1) - lo) / (hi - lo);
+    if (t < 0) t = 0;
+    if (t > 1) t = 1;
+    return profile->sort_ns + t * (profile->sort_large_ns - profile->sort_ns);
+}
+
+// Predicted wall time in milliseconds of one engine on sequences of the given lengths.
+// Every term is an operation count from the engine's structure times a measured cost;
+// parallel loops are divided by the thread count, serial parts are not.
+double estimate_engine_time(EngineKind engine, const MachineProfile* profile, int ref_len, int query_len) {
+    double n = ref_len, m = query_len;
+    double threads = profile->threads > 0 ? profile->threads : 1;
+    double ns = 0.0;
+    
+    switch (engine) {
+        case ENGINE_DIAGONAL: {
+            // Pack both sequences, then one word compare per 32 cells of every diagonal
+            ns = (n + m) * profile->index_ns / threads +
+                 (n * m / 32.0) * profile->word_ns / threads;
+            if (finder_options.self_mode) ns /= 2.0;  // One sequence, diagonals above the identity only
+            break;
+        }
+        case ENGINE_MEM: {
+            // Prefix doubling on random-like text settles once h passes log4(n); every round is
+            // two counting sorts plus a rank pass. The query scan binary searches one bucket.
+            double depth = log(n > 4 ? n : 4) / log(4.0);
+            int rounds = 1;
+            while ((1 << rounds) < 2 * depth) rounds++;
+            double buckets = (double)(1 << (2 * MEM_BUCKET_K));
+            double bucket_size = n / buckets;
+            double probes = 2.0 * (log2(bucket_size > 1 ? bucket_size : 1) + 1.0) + 1.0;
+            ns = (rounds + 1) * 3.0 * n * sort_ns_at(profile, n) +
+                 2.0 * buckets * profile->sort_ns +
+                 2.0 * m * probes * profile->lookup_ns / threads;
+            break;
+        }
+        case ENGINE_GRAPH: {
+            // Two query indexes, one seed lookup per strand for every scanned reference
+            // position, edges emitted and scattered by all threads, then a pass over all nodes
+            int min_length = 5 > (ref_len / 1000) ? 5 : (ref_len / 1000);
+            int k = choose_kmer_size(query_len, min_length);
+            double positions = n - min_length;
+            if (!finder_options.exact_mode && n > GRAPH_SAMPLED_POSITIONS) {
+                positions = GRAPH_SAMPLED_POSITIONS;
+            }
+            double hits_per_lookup = m / pow(4.0, k);
+            double edges = 2.0 * positions * hits_per_lookup;
+            double nodes = n > m ? n : m;
+            ns = 2.0 * m * profile->index_ns +
+                 2.0 * positions * profile->lookup_ns / threads +
+                 edges * 4.0 * profile->lookup_ns / threads +
+                 nodes * 2.0 * profile->sort_ns / threads;
+            break;
+        }
+        case ENGINE_TRADITIONAL:
+        case ENGINE_AUTO:
+            // Not candidates of the automatic choice
+            break;
+    }
+    return ns / 1e6;
+}
+
+// Pick the candidate engine with the lowest predicted time and log every estimate
+EngineKind choose_engine(const MachineProfile* profile, int ref_len, int query_len, double* predicted_ms) {
+    EngineKind best = ENGINE_GRAPH;
+    double best_ms = -1.0;
+    
+    printf("Cost model (%d threads): word %.2f ns, lookup %.2f ns, sort %.2f/%.2f ns, index %.2f ns\n",
+           profile->threads, profile->word_ns, profile->lookup_ns, profile->sort_ns, profile->sort_large_ns,
+           profile->index_ns);
+    for (int e = 0; e < NUM_CANDIDATE_ENGINES; e++) {
+        double ms = estimate_engine_time(candidate_engines[e], profile, ref_len, query_len);
+        printf("  %-8s predicted %.2f ms\n", engine_name(candidate_engines[e]), ms);
+        if (best_ms < 0 || ms < best_ms) {
+            best = candidate_engines[e];
+            best_ms = ms;
+        }
+    }
+    
+    *predicted_ms = best_ms;
+    return best;
+}
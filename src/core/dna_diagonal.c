@@ -0,0 +1,356 @@
+#include "../include/core/dna_diagonal.h"
+#include "../include/core/dna_topk.h"
+
+// One bit per base in a packed word (the low bit of every 2-bit slot)
+#define EVEN_BITS 0x5555555555555555ULL
+
+// Pack a sequence into 2-bit words plus a mask of non-ACGT bases
+PackedSequence* pack_sequence(const char* sequence, int length) {
+    PackedSequence* packed = (PackedSequence*)malloc(sizeof(PackedSequence));
+    if (UNLIKELY(!packed)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    packed->length = length;
+    packed->num_words = (length + 31) / 32 + 1;
+    packed->bases = (uint64_t*)aligned_alloc_cache(packed->num_words * sizeof(uint64_t));
+    packed->invalid = (uint64_t*)aligned_alloc_cache(packed->num_words * sizeof(uint64_t));
+    if (UNLIKELY(!packed->bases || !packed->invalid)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    // Every word is built by one thread from its own 32 bases
+    #pragma omp parallel for schedule(static) if (packed->num_words > PARALLEL_THRESHOLD)
+    for (int w = 0; w < packed->num_words; w++) {
+        uint64_t bases = 0, invalid = 0;
+        int end = (w + 1) * 32 < length ? (w + 1) * 32 : length;
+        for (int k = w * 32; k < end; k++) {
+            int code = dna_base_code(sequence[k]);
+            int shift = (k & 31) << 1;
+            if (UNLIKELY(code < 0)) {
+                invalid |= 1ULL << shift;
+            } else {
+                bases |= (uint64_t)code << shift;
+            }
+        }
+        packed->bases[w] = bases;
+        packed->invalid[w] = invalid;
+    }
+    
+    return packed;
+}
+
+// Free a packed sequence
+void free_packed_sequence(PackedSequence* packed) {
+    if (!packed) return;
+    free(packed->bases);
+    free(packed->invalid);
+    free(packed);
+}
+
+// The 32 bases starting at pos as one word (funnel shift of two neighbouring words)
+static inline uint64_t packed_window(const uint64_t* words, int pos) {
+    int w = pos >> 5;
+    int shift = (pos & 31) << 1;
+    uint64_t window = words[w] >> shift;
+    if (shift) {
+        window |= words[w + 1] << (64 - shift);
+    }
+    return window;
+}
+
+// Thread-local growable segment buffer
+typedef struct {
+    DiagonalSegment* segments;
+    int count;
+    int capacity;
+} SegmentBuffer;
+
+static void push_segment(SegmentBuffer* buffer, int diagonal, int ref_start, int length) {
+    if (buffer->count >= buffer->capacity) {
+        buffer->capacity *= 2;
+        DiagonalSegment* new_segments = (DiagonalSegment*)realloc(buffer->segments, 
+                                         buffer->capacity * sizeof(DiagonalSegment));
+        if (UNLIKELY(!new_segments)) {
+            fprintf(stderr, "Memory reallocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        buffer->segments = new_segments;
+    }
+    DiagonalSegment* segment = &buffer->segments[buffer->count++];
+    segment->diagonal = diagonal;
+    segment->ref_start = ref_start;
+    segment->length = length;
+}
+
+// Walk one diagonal 32 cells at a time. XOR of the packed words leaves a zero 2-bit
+// slot for every matching cell; runs are read off the mismatch mask with ctz/clz.
+static void scan_diagonal(const PackedSequence* ref, const PackedSequence* qry, int diagonal, 
+                          int min_length, SegmentBuffer* out) {
+    int i = diagonal > 0 ? diagonal : 0;
+    int end = ref->length < qry->length + diagonal ? ref->length : qry->length + diagonal;
+    int run = 0;  // Matching cells immediately before i
+    
+    while (i < end) {
+        int j = i - diagonal;
+        int cells = end - i < 32 ? end - i : 32;
+        
+        uint64_t diff = packed_window(ref->bases, i) ^ packed_window(qry->bases, j);
+        uint64_t mismatch = ((diff | (diff >> 1)) & EVEN_BITS) |
+                            packed_window(ref->invalid, i) | packed_window(qry->invalid, j);
+        if (cells < 32) {
+            mismatch &= (1ULL << (cells << 1)) - 1;
+        }
+        
+        if (LIKELY(mismatch == 0)) {
+            run += cells;
+            i += cells;
+            continue;
+        }
+        
+        // The run entering this word ends at the first mismatch
+        int first = __builtin_ctzll(mismatch) >> 1;
+        run += first;
+        if (run >= min_length) {
+            push_segment(out, diagonal, i + first - run, run);
+        }
+        
+        // Runs strictly between two mismatches fit in one word, so only short minimums need them
+        if (min_length < 31) {
+            int prev = first;
+            uint64_t rest = mismatch & (mismatch - 1);
+            while (rest) {
+                int next = __builtin_ctzll(rest) >> 1;
+                if (next - prev - 1 >= min_length) {
+                    push_segment(out, diagonal, i + prev + 1, next - prev - 1);
+                }
+                prev = next;
+                rest &= rest - 1;
+            }
+        }
+        
+        // Matching cells after the last mismatch start the next run
+        int last = (63 - __builtin_clzll(mismatch)) >> 1;
+        run = cells - 1 - last;
+        i += cells;
+    }
+    
+    if (run >= min_length) {
+        push_segment(out, diagonal, end - run, run);
+    }
+}
+
+static int compare_segments(const void* a, const void* b) {
+    const DiagonalSegment* x = (const DiagonalSegment*)a;
+    const DiagonalSegment* y = (const DiagonalSegment*)b;
+    if (x->diagonal != y->diagonal) return x->diagonal < y->diagonal ? -1 : 1;
+    return (x->ref_start > y->ref_start) - (x->ref_start < y->ref_start);
+}
+
+// Find every maximal run of at least min_length matching cells on every diagonal,
+// without materializing the similarity matrix. Memory is O(n + m) plus the output.
+// Segments are returned sorted by diagonal, then by reference start.
+DiagonalSegment* find_diagonal_runs(const char* reference, int ref_len, const char* query, int query_len,
+                                    int min_length, int* num_segments) {
+    *num_segments = 0;
+    if (!reference || !query || min_length < 1 || ref_len < min_length || query_len < min_length) {
+        return NULL;
+    }
+    
+    // A sequence against itself is symmetric about the identity diagonal: pack it once
+    // and scan only diagonals above it, so every pair of copies is found once
+    int self = finder_options.self_mode && reference == query && ref_len == query_len;
+    PackedSequence* ref = pack_sequence(reference, ref_len);
+    PackedSequence* qry = self ? ref : pack_sequence(query, query_len);
+    
+    // Diagonals shorter than min_length cannot hold a run
+    int first_diagonal = self ? 1 : -(query_len - min_length);
+    int last_diagonal = ref_len - min_length;
+    
+    int capacity = 1000;
+    DiagonalSegment* segments = (DiagonalSegment*)malloc(capacity * sizeof(DiagonalSegment));
+    if (UNLIKELY(!segments)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    int segment_count = 0;
+    
+    omp_lock_t segment_lock;
+    omp_init_lock(&segment_lock);
+    
+    long long cells_scanned = 0;
+    double scan_start = omp_get_wtime();
+    
+    #pragma omp parallel reduction(+:cells_scanned)
+    {
+        SegmentBuffer local = {NULL, 0, 64};
+        local.segments = (DiagonalSegment*)malloc(local.capacity * sizeof(DiagonalSegment));
+        if (UNLIKELY(!local.segments)) {
+            fprintf(stderr, "Memory allocation failed in thread %d\n", omp_get_thread_num());
+            exit(EXIT_FAILURE);
+        }
+        
+        #pragma omp for schedule(dynamic, 64)
+        for (int d = first_diagonal; d <= last_diagonal; d++) {
+            int diagonal_end = ref_len < query_len + d ? ref_len : query_len + d;
+            cells_scanned += diagonal_end - (d > 0 ? d : 0);
+            scan_diagonal(ref, qry, d, min_length, &local);
+        }
+        
+        // Merge thread-local results into global array
+        omp_set_lock(&segment_lock);
+        if (segment_count + local.count > capacity) {
+            while (segment_count + local.count > capacity) capacity *= 2;
+            DiagonalSegment* new_segments = (DiagonalSegment*)realloc(segments, capacity * sizeof(DiagonalSegment));
+            if (UNLIKELY(!new_segments)) {
+                fprintf(stderr, "Memory reallocation failed during merge\n");
+                omp_unset_lock(&segment_lock);
+                exit(EXIT_FAILURE);
+            }
+            segments = new_segments;
+        }
+        memcpy(segments + segment_count, local.segments, local.count * sizeof(DiagonalSegment));
+        segment_count += local.count;
+        omp_unset_lock(&segment_lock);
+        
+        free(local.segments);
+    }
+    
+    omp_destroy_lock(&segment_lock);
+    report_cell_throughput("Diagonal scan", cells_scanned, omp_get_wtime() - scan_start);
+    
+    free_packed_sequence(ref);
+    if (qry != ref) free_packed_sequence(qry);
+    
+    qsort(segments, segment_count, sizeof(DiagonalSegment), compare_segments);
+    
+    *num_segments = segment_count;
+    return segments;
+}
+
+// Keep the top_k repeats of a full diagonal search. Every run's reference position is
+// resolved to the repeat the full search keeps there (the longest run starting at it) and
+// scored with its query instance count, so each thread's bounded heap holds final repeats
+// and positions whose best possible score is below the weakest of them are not resolved.
+static RepeatPattern* find_top_diagonal_runs(const char* reference, int ref_len, const char* query, 
+                                             int query_len, int top_k, int* num_repeats) {
+    *num_repeats = 0;
+    if (ref_len < DIAGONAL_MIN_RUN || query_len < DIAGONAL_MIN_RUN) {
+        return NULL;
+    }
+    
+    int self = finder_options.self_mode && reference == query && ref_len == query_len;
+    PackedSequence* ref = pack_sequence(reference, ref_len);
+    PackedSequence* qry = self ? ref : pack_sequence(query, query_len);
+    int first_diagonal = self ? 1 : -(query_len - DIAGONAL_MIN_RUN);
+    int last_diagonal = ref_len - DIAGONAL_MIN_RUN;
+    
+    KmerIndex* query_index = build_kmer_index(query, query_len, choose_kmer_size(query_len, DIAGONAL_MIN_RUN));
+    if (UNLIKELY(!query_index)) {
+        fprintf(stderr, "Failed to build query index\n");
+        exit(EXIT_FAILURE);
+    }
+    RepeatScope scope = {query, query_len, query_index, 0, DIAGONAL_MIN_RUN, 0, 1, 
+                         self ? SELF_TARGET_BEFORE : SELF_ALL, 1, 0};
+    
+    TopKHeap* top = create_topk_heap(top_k);
+    long long shared_floor = -1;
+    long long cells_scanned = 0;
+    
+    omp_lock_t top_lock;
+    omp_init_lock(&top_lock);
+    
+    double scan_start = omp_get_wtime();
+    
+    #pragma omp parallel reduction(+:cells_scanned)
+    {
+        SegmentBuffer local = {NULL, 0, 64};
+        local.segments = (DiagonalSegment*)malloc(local.capacity * sizeof(DiagonalSegment));
+        if (UNLIKELY(!local.segments)) {
+            fprintf(stderr, "Memory allocation failed in thread %d\n", omp_get_thread_num());
+            exit(EXIT_FAILURE);
+        }
+        TopKHeap* local_top = create_topk_heap(top_k);
+        
+        #pragma omp for schedule(dynamic, 64)
+        for (int d = first_diagonal; d <= last_diagonal; d++) {
+            int diagonal_end = ref_len < query_len + d ? ref_len : query_len + d;
+            cells_scanned += diagonal_end - (d > 0 ? d : 0);
+            local.count = 0;
+            scan_diagonal(ref, qry, d, DIAGONAL_MIN_RUN, &local);
+            
+            long long threshold = topk_threshold(local_top, &shared_floor);
+            for (int s = 0; s < local.count; s++) {
+                int position = local.segments[s].ref_start;
+                RepeatPattern candidate;
+                if (repeat_score_bound(&scope, reference, ref_len, position) >= threshold &&
+                    resolve_repeat(&scope, reference, ref_len, position, &candidate) &&
+                    topk_offer(local_top, &candidate)) {
+                    threshold = topk_threshold(local_top, &shared_floor);
+                }
+            }
+            topk_publish_floor(local_top, &shared_floor);
+        }
+        
+        omp_set_lock(&top_lock);
+        topk_merge(top, local_top);
+        omp_unset_lock(&top_lock);
+        
+        free(local.segments);
+    }
+    
+    omp_destroy_lock(&top_lock);
+    report_cell_throughput("Diagonal scan", cells_scanned, omp_get_wtime() - scan_start);
+    
+    free_kmer_index(query_index);
+    free_packed_sequence(ref);
+    if (qry != ref) free_packed_sequence(qry);
+    
+    RepeatPattern* repeats = topk_release(top, num_repeats);
+    printf("Kept the %d best diagonal repeats (top %d)\n", *num_repeats, top_k);
+    return repeats;
+}
+
+// Report every diagonal run of at least DIAGONAL_MIN_RUN bases as a forward repeat.
+// Instances and nesting are resolved afterwards by get_repeat_sequences and filter_nested_repeats.
+RepeatPattern* find_repeats_diagonal(const char* reference, int ref_len, const char* query, int query_len,
+                                     int* num_repeats) {
+    printf("Finding diagonal match runs of at least %d bases...\n", DIAGONAL_MIN_RUN);
+    
+    if (finder_options.top_k > 0) {
+        return find_top_diagonal_runs(reference, ref_len, query, query_len, finder_options.top_k, num_repeats);
+    }
+    
+    int num_segments = 0;
+    DiagonalSegment* segments = find_diagonal_runs(reference, ref_len, query, query_len, 
+                                                   DIAGONAL_MIN_RUN, &num_segments);
+    *num_repeats = 0;
+    if (num_segments == 0) {
+        free(segments);
+        return NULL;
+    }
+    
+    RepeatPattern* repeats = allocate_repeat_patterns(num_segments);
+    if (UNLIKELY(!repeats)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    for (int s = 0; s < num_segments; s++) {
+        repeats[s].position = segments[s].ref_start;
+        repeats[s].length = segments[s].length;
+        repeats[s].count = 1;
+        repeats[s].is_reverse = 0;
+        repeats[s].query_position = segments[s].ref_start - segments[s].diagonal;
+        repeats[s].orig_seq = NULL;
+        repeats[s].example_positions = NULL;
+        repeats[s].num_examples = 0;
+    }
+    free(segments);
+    
+    printf("Found %d diagonal runs\n", num_segments);
+    *num_repeats = num_segments;
+    return repeats;
+}
@@ -0,0 +1,350 @@
+#include "../include/core/dna_dotplot.h"
+#include "../include/core/dna_index.h"
+#include <math.h>
+
+// Thread-local list of segments found by one thread
+typedef struct {
+    DiagonalSegment* segments;
+    int count;
+    int capacity;
+} DotplotBuffer;
+
+static void push_dotplot_segment(DotplotBuffer* buffer, int diagonal, int ref_start, int length) {
+    if (buffer->count == buffer->capacity) {
+        buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 64;
+        DiagonalSegment* grown = (DiagonalSegment*)realloc(buffer->segments,
+                                                           buffer->capacity * sizeof(DiagonalSegment));
+        if (UNLIKELY(!grown)) {
+            fprintf(stderr, "Memory reallocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        buffer->segments = grown;
+    }
+    DiagonalSegment* segment = &buffer->segments[buffer->count++];
+    segment->diagonal = diagonal;
+    segment->ref_start = ref_start;
+    segment->length = length;
+}
+
+static int compare_dotplot_segments(const void* a, const void* b) {
+    const DiagonalSegment* x = (const DiagonalSegment*)a;
+    const DiagonalSegment* y = (const DiagonalSegment*)b;
+    if (x->diagonal != y->diagonal) return x->diagonal < y->diagonal ? -1 : 1;
+    return (x->ref_start > y->ref_start) - (x->ref_start < y->ref_start);
+}
+
+// Length of the maximal run starting at seed (r, p), or 0 if the cell to its left also
+// matches. A run starts at exactly one seed, so each run is extended once, by whichever
+// thread owns that seed.
+FORCE_INLINE int seed_run_length(const char* reference, int ref_len, const char* sequence, int seq_len,
+                                 int r, int p, int k) {
+    if (r > 0 && p > 0 && cells_match(reference[r - 1], sequence[p - 1])) return 0;
+    
+    int limit = ref_len - r < seq_len - p ? ref_len - r : seq_len - p;
+    int length = k;
+    while (length < limit && cells_match(reference[r + length], sequence[p + length])) {
+        length++;
+    }
+    return length;
+}
+
+// Every maximal run of at least min_length cells between reference and sequence, seeded
+// from the reference k-mer index
+static DiagonalSegment* collect_runs(const char* reference, int ref_len, const KmerIndex* ref_index,
+                                     const char* sequence, int seq_len, int min_length, int* num_runs) {
+    int k = ref_index->k;
+    int num_probes = seq_len - k + 1;
+    DotplotBuffer merged = {NULL, 0, 0};
+    
+    omp_lock_t merge_lock;
+    omp_init_lock(&merge_lock);
+    
+    #pragma omp parallel
+    {
+        DotplotBuffer local = {NULL, 0, 0};
+    
+        #pragma omp for schedule(dynamic, 1024)
+        for (int p = 0; p < num_probes; p++) {
+            const int* hits;
+            int num_hits = kmer_index_lookup(ref_index, sequence + p, &hits);
+            for (int h = 0; h < num_hits; h++) {
+                int length = seed_run_length(reference, ref_len, sequence, seq_len, hits[h], p, k);
+                if (length >= min_length) {
+                    push_dotplot_segment(&local, hits[h] - p, hits[h], length);
+                }
+            }
+        }
+    
+        // Merge thread-local results into the shared array
+        omp_set_lock(&merge_lock);
+        if (merged.count + local.count > merged.capacity) {
+            while (merged.count + local.count > merged.capacity) {
+                merged.capacity = merged.capacity ? merged.capacity * 2 : 64;
+            }
+            DiagonalSegment* grown = (DiagonalSegment*)realloc(merged.segments,
+                                                               merged.capacity * sizeof(DiagonalSegment));
+            if (UNLIKELY(!grown)) {
+                fprintf(stderr, "Memory reallocation failed during merge\n");
+                omp_unset_lock(&merge_lock);
+                exit(EXIT_FAILURE);
+            }
+            merged.segments = grown;
+        }
+        if (local.count > 0) {
+            memcpy(merged.segments + merged.count, local.segments, local.count * sizeof(DiagonalSegment));
+            merged.count += local.count;
+        }
+        omp_unset_lock(&merge_lock);
+        free(local.segments);
+    }
+    
+    omp_destroy_lock(&merge_lock);
+    
+    qsort(merged.segments, merged.count, sizeof(DiagonalSegment), compare_dotplot_segments);
+    *num_runs = merged.count;
+    return merged.segments;
+}
+
+// Seeds no longer than the shortest run, or runs could start between seeds
+static int dotplot_seed_size(int ref_len, int min_length) {
+    int max_k = min_length < KMER_INDEX_MAX_K ? min_length : KMER_INDEX_MAX_K;
+    return choose_kmer_size(ref_len, max_k);
+}
+
+// Build the sparse dot plot of both strands. The reference is indexed once and every
+// k-mer of the query and of its reverse complement is probed in parallel, so the work
+// is proportional to the seed hits instead of n x m cells.
+SparseDotPlot* build_sparse_dotplot(const char* reference, int ref_len, const char* query, int query_len,
+                                    int min_length) {
+    SparseDotPlot* plot = (SparseDotPlot*)calloc(1, sizeof(SparseDotPlot));
+    if (UNLIKELY(!plot)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    plot->ref_len = ref_len;
+    plot->query_len = query_len;
+    plot->min_length = min_length > 0 ? min_length : 1;
+    if (ref_len < plot->min_length || query_len < plot->min_length) {
+        return plot;
+    }
+    
+    double start = omp_get_wtime();
+    KmerIndex* ref_index = build_kmer_index(reference, ref_len, dotplot_seed_size(ref_len, plot->min_length));
+    char* rc_query = get_reverse_complement(query, query_len);
+    
+    plot->forward = collect_runs(reference, ref_len, ref_index, query, query_len, plot->min_length,
+                                 &plot->num_forward);
+    plot->reverse = collect_runs(reference, ref_len, ref_index, rc_query, query_len, plot->min_length,
+                                 &plot->num_reverse);
+    
+    free(rc_query);
+    free_kmer_index(ref_index);
+    report_scan_throughput("Dot plot seeding", 2 * query_len, omp_get_wtime() - start);
+    return plot;
+}
+
+// Free a sparse dot plot
+void free_sparse_dotplot(SparseDotPlot* plot) {
+    if (!plot) return;
+    free(plot->forward);
+    free(plot->reverse);
+    free(plot);
+}
+
+// First segment whose diagonal is at least diagonal (past_equal = 0) or above it (past_equal = 1)
+static int diagonal_bound(const DiagonalSegment* segments, int count, int diagonal, int past_equal) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (segments[mid].diagonal < diagonal || (past_equal && segments[mid].diagonal == diagonal)) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Segments of one strand with first_diagonal <= diagonal <= last_diagonal, in the strand's
+// own coordinates. They are contiguous in the sorted array, so this returns a pointer into
+// the plot and a count.
+const DiagonalSegment* dotplot_diagonal_range(const SparseDotPlot* plot, int is_reverse, int first_diagonal,
+                                              int last_diagonal, int* count) {
+    const DiagonalSegment* segments = is_reverse ? plot->reverse : plot->forward;
+    int total = is_reverse ? plot->num_reverse : plot->num_forward;
+    int begin = diagonal_bound(segments, total, first_diagonal, 0);
+    int end = diagonal_bound(segments, total, last_diagonal, 1);
+    *count = end > begin ? end - begin : 0;
+    return segments ? segments + begin : NULL;
+}
+
+// Segments of one strand with at least one cell in reference [ref_start, ref_end) x
+// query [query_start, query_end). The window is in query coordinates on both strands;
+// the segments come back as stored, in diagonal order. Only the band of diagonals that
+// can cross the window is examined. The caller frees the result.
+DiagonalSegment* dotplot_window(const SparseDotPlot* plot, int is_reverse, int ref_start, int ref_end,
+                                int query_start, int query_end, int* count) {
+    *count = 0;
+    if (ref_start < 0) ref_start = 0;
+    if (ref_end > plot->ref_len) ref_end = plot->ref_len;
+    if (query_start < 0) query_start = 0;
+    if (query_end > plot->query_len) query_end = plot->query_len;
+    if (ref_end <= ref_start || query_end <= query_start) return NULL;
+    
+    // Reverse segments walk the reverse complement of the query: mirror the window onto it
+    if (is_reverse) {
+        int mirrored_start = plot->query_len - query_end;
+        query_end = plot->query_len - query_start;
+        query_start = mirrored_start;
+    }
+    
+    int band;
+    const DiagonalSegment* segments = dotplot_diagonal_range(plot, is_reverse, ref_start - (query_end - 1),
+                                                             (ref_end - 1) - query_start, &band);
+    DiagonalSegment* found = NULL;
+    for (int s = 0; s < band; s++) {
+        const DiagonalSegment* segment = &segments[s];
+    
+        // Cells of the segment whose query position also falls in the window
+        int lo = segment->ref_start > ref_start ? segment->ref_start : ref_start;
+        int hi = segment->ref_start + segment->length < ref_end ? segment->ref_start + segment->length : ref_end;
+        if (lo < query_start + segment->diagonal) lo = query_start + segment->diagonal;
+        if (hi > query_end + segment->diagonal) hi = query_end + segment->diagonal;
+        if (lo >= hi) continue;
+    
+        if (!found) {
+            found = (DiagonalSegment*)malloc(band * sizeof(DiagonalSegment));
+            if (UNLIKELY(!found)) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        found[(*count)++] = *segment;
+    }
+    return found;
+}
+
+// Add the cells of one run to a raster channel. The run walks the reference forward and
+// the query by query_step (+1 on the forward strand, -1 on the reverse one); consecutive
+// cells that land in the same pixel are added with one atomic update.
+static void rasterize_run(unsigned int* channel, int width, int height, int ref_len, int query_len,
+                          int ref_start, int query_start, int query_step, int length) {
+    int last = -1;
+    unsigned int cells = 0;
+    for (int c = 0; c < length; c++) {
+        int y = (int)((long long)(ref_start + c) * height / ref_len);
+        int x = (int)((long long)(query_start + query_step * c) * width / query_len);
+        int pixel = y * width + x;
+        if (pixel != last) {
+            if (cells) __atomic_fetch_add(&channel[last], cells, __ATOMIC_RELAXED);
+            last = pixel;
+            cells = 0;
+        }
+        cells++;
+    }
+    if (cells) __atomic_fetch_add(&channel[last], cells, __ATOMIC_RELAXED);
+}
+
+// Seed every k-mer of sequence against the reference index and bin the runs straight into
+// the channel; nothing but the raster is written
+static void rasterize_strand(unsigned int* channel, int width, int height, const char* reference, int ref_len,
+                             const KmerIndex* ref_index, const char* sequence, int seq_len, int min_length,
+                             int is_reverse) {
+    int k = ref_index->k;
+    int num_probes = seq_len - k + 1;
+    
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int p = 0; p < num_probes; p++) {
+        const int* hits;
+        int num_hits = kmer_index_lookup(ref_index, sequence + p, &hits);
+        for (int h = 0; h < num_hits; h++) {
+            int length = seed_run_length(reference, ref_len, sequence, seq_len, hits[h], p, k);
+            if (length < min_length) continue;
+    
+            // Reverse runs are in reverse complement coordinates: map back onto the query
+            int query_start = is_reverse ? seq_len - 1 - p : p;
+            rasterize_run(channel, width, height, ref_len, seq_len, hits[h], query_start,
+                          is_reverse ? -1 : 1, length);
+        }
+    }
+}
+
+// Matched cells of a pixel as an 8-bit intensity, log-scaled against the fullest pixel
+FORCE_INLINE unsigned char pixel_intensity(unsigned int cells, double log_max) {
+    if (!cells) return 0;
+    int value = 32 + (int)(223.0 * log1p((double)cells) / log_max);
+    return (unsigned char)(value > 255 ? 255 : value);
+}
+
+// Render a dot plot of runs of at least min_length cells into a binary PPM of at most
+// size x size pixels (reference down, query across): forward matches in the red channel,
+// reverse complement matches in the green one. Runs are binned as they are found, so
+// memory is the reference index and the raster whatever the sequence lengths.
+// Returns 1 on success, 0 if the file could not be written.
+int render_dotplot(const char* reference, int ref_len, const char* query, int query_len, int min_length,
+                   int size, const char* path) {
+    if (size <= 0) size = DOTPLOT_RASTER_DEFAULT;
+    if (min_length <= 0) min_length = DOTPLOT_MIN_RUN;
+    int width = query_len < size ? query_len : size;
+    int height = ref_len < size ? ref_len : size;
+    if (width <= 0 || height <= 0) {
+        fprintf(stderr, "Nothing to plot for empty sequences\n");
+        return 0;
+    }
+    
+    size_t pixels = (size_t)width * height;
+    unsigned int* forward = (unsigned int*)calloc(pixels, sizeof(unsigned int));
+    unsigned int* reverse = (unsigned int*)calloc(pixels, sizeof(unsigned int));
+    if (UNLIKELY(!forward || !reverse)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    double start = omp_get_wtime();
+    if (ref_len >= min_length && query_len >= min_length) {
+        KmerIndex* ref_index = build_kmer_index(reference, ref_len, dotplot_seed_size(ref_len, min_length));
+        char* rc_query = get_reverse_complement(query, query_len);
+        rasterize_strand(forward, width, height, reference, ref_len, ref_index, query, query_len, min_length, 0);
+        rasterize_strand(reverse, width, height, reference, ref_len, ref_index, rc_query, query_len, min_length, 1);
+        free(rc_query);
+        free_kmer_index(ref_index);
+    }
+    report_scan_throughput("Dot plot rendering", 2 * query_len, omp_get_wtime() - start);
+    
+    unsigned int max_forward = 0, max_reverse = 0;
+    #pragma omp parallel for reduction(max:max_forward, max_reverse) if (pixels > PARALLEL_THRESHOLD)
+    for (size_t i = 0; i < pixels; i++) {
+        if (forward[i] > max_forward) max_forward = forward[i];
+        if (reverse[i] > max_reverse) max_reverse = reverse[i];
+    }
+    double log_forward = log1p((double)(max_forward ? max_forward : 1));
+    double log_reverse = log1p((double)(max_reverse ? max_reverse : 1));
+    
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Could not open file: %s\n", path);
+        free(forward);
+        free(reverse);
+        return 0;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    unsigned char* row = (unsigned char*)malloc((size_t)width * 3);
+    if (UNLIKELY(!row)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            size_t i = (size_t)y * width + x;
+            row[3 * x] = pixel_intensity(forward[i], log_forward);
+            row[3 * x + 1] = pixel_intensity(reverse[i], log_reverse);
+            row[3 * x + 2] = 0;
+        }
+        fwrite(row, 3, width, file);
+    }
+    int ok = !ferror(file);
+    fclose(file);
+    
+    free(row);
+    free(forward);
+    free(reverse);
+    return ok;
+}
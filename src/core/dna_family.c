@@ -0,0 +1,609 @@
+#include "../include/core/dna_family.h"
+
+// Unitigs and k-mers a thread has walked, before they join the graph
+typedef struct {
+    Unitig* unitigs;
+    int num_unitigs;
+    int unitig_capacity;
+    char* bases;
+    int num_bases;
+    int base_capacity;
+    int* kmers;              // 2 * slot (+1 if reverse complemented) of every k-mer, unitig by unitig
+    int num_kmers;
+    int kmer_capacity;
+} UnitigBuffer;
+
+// One k-mer of a sequence that belongs to a repeat family; hits of one occurrence share
+// a diagonal (position - offset forward, position + offset reverse complemented)
+typedef struct {
+    int unitig;
+    int is_reverse;
+    int diagonal;
+    int position;
+} FamilyHit;
+
+// Grow an array so it holds at least needed elements
+static void* grow_array(void* array, int* capacity, int needed, size_t element_size) {
+    if (needed <= *capacity) return array;
+    int new_capacity = *capacity > 0 ? *capacity : 64;
+    while (new_capacity < needed) new_capacity *= 2;
+    void* grown = realloc(array, (size_t)new_capacity * element_size);
+    if (UNLIKELY(!grown)) {
+        fprintf(stderr, "Memory reallocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = new_capacity;
+    return grown;
+}
+
+// Reverse complement of a 2-bit packed k-mer: reverse the base order, then complement
+static inline uint64_t reverse_complement_kmer(uint64_t x, int k) {
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    x = ((x >> 8) & 0x00FF00FF00FF00FFULL) | ((x & 0x00FF00FF00FF00FFULL) << 8);
+    x = ((x >> 16) & 0x0000FFFF0000FFFFULL) | ((x & 0x0000FFFF0000FFFFULL) << 16);
+    x = (x >> 32) | (x << 32);
+    return ~x >> (64 - 2 * k);
+}
+
+static inline uint64_t canonical_kmer(uint64_t x, int k) {
+    uint64_t rc = reverse_complement_kmer(x, k);
+    return x < rc ? x : rc;
+}
+
+// Spread the k-mer bits over the table index (splitmix64 finalizer)
+static inline uint64_t hash_kmer(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Slot of a canonical k-mer, claiming an empty one if it is new. A slot is claimed with
+// a compare-and-swap on its key, so threads insert concurrently without a lock.
+static int kmer_table_insert(DeBruijnGraph* graph, uint64_t kmer, int* inserted) {
+    uint64_t key = kmer + 1;
+    int mask = graph->capacity - 1;
+    int slot = (int)(hash_kmer(kmer) & (uint64_t)mask);
+    for (;;) {
+        uint64_t current = __atomic_load_n(&graph->keys[slot], __ATOMIC_ACQUIRE);
+        if (current == 0) {
+            if (__atomic_compare_exchange_n(&graph->keys[slot], &current, key, 0,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                *inserted = 1;
+                return slot;
+            }
+        }
+        // A thread that lost the race sees the winner's key here
+        if (current == key) {
+            *inserted = 0;
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+// Slot of a canonical k-mer, -1 if the query does not contain it
+static int kmer_table_find(const DeBruijnGraph* graph, uint64_t kmer) {
+    uint64_t key = kmer + 1;
+    int mask = graph->capacity - 1;
+    int slot = (int)(hash_kmer(kmer) & (uint64_t)mask);
+    while (graph->keys[slot] != 0) {
+        if (graph->keys[slot] == key) return slot;
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+// Bases that extend k-mer x (stored at slot) to a k-mer of the graph, as a 4-bit mask
+static inline int successor_mask(const DeBruijnGraph* graph, uint64_t x, int slot) {
+    return x == graph->keys[slot] - 1 ? graph->links[slot] & 15 : graph->links[slot] >> 4;
+}
+
+// Whether x continues into its successor inside one unitig: the successor is unique, x is
+// the successor's unique predecessor, and the step does not fold back onto x's other strand
+static int linked_successor(const DeBruijnGraph* graph, uint64_t x, int slot, uint64_t* next, int* next_slot) {
+    int k = graph->k;
+    int bases = successor_mask(graph, x, slot);
+    if (bases == 0 || (bases & (bases - 1)) != 0) return 0;
+    
+    uint64_t y = ((x << 2) | (uint64_t)__builtin_ctz(bases)) & ((1ULL << (2 * k)) - 1);
+    int y_slot = kmer_table_find(graph, canonical_kmer(y, k));
+    if (y_slot == slot) return 0;
+    
+    // x on the other strand is one successor of y on the other strand; it must be the only one
+    int back = successor_mask(graph, reverse_complement_kmer(y, k), y_slot);
+    if ((back & (back - 1)) != 0) return 0;
+    
+    *next = y;
+    *next_slot = y_slot;
+    return 1;
+}
+
+// Path entry of k-mer x stored at slot: 2 * slot, +1 if x is the reverse complemented form
+static inline int path_entry(const DeBruijnGraph* graph, uint64_t x, int slot) {
+    return 2 * slot + (x != graph->keys[slot] - 1);
+}
+
+// Follow the unitig from k-mer start until it branches or comes back round to start;
+// returns the number of k-mers stored in path
+static int walk_unitig(const DeBruijnGraph* graph, uint64_t start, int start_slot, int** path, int* path_capacity) {
+    uint64_t current = start;
+    int slot = start_slot;
+    uint64_t next;
+    int next_slot;
+    int length = 0;
+    
+    *path = (int*)grow_array(*path, path_capacity, 1, sizeof(int));
+    (*path)[length++] = path_entry(graph, current, slot);
+    while (length < graph->num_kmers && linked_successor(graph, current, slot, &next, &next_slot) &&
+           next_slot != start_slot) {
+        *path = (int*)grow_array(*path, path_capacity, length + 1, sizeof(int));
+        (*path)[length++] = path_entry(graph, next, next_slot);
+        current = next;
+        slot = next_slot;
+    }
+    return length;
+}
+
+// Spell a walked path as a unitig and keep its path entries for assign_unitig_kmers
+static void append_unitig(UnitigBuffer* buffer, const DeBruijnGraph* graph, const int* path, int length) {
+    int k = graph->k;
+    int num_bases = k + length - 1;
+    buffer->unitigs = (Unitig*)grow_array(buffer->unitigs, &buffer->unitig_capacity, buffer->num_unitigs + 1,
+                                          sizeof(Unitig));
+    buffer->bases = (char*)grow_array(buffer->bases, &buffer->base_capacity, buffer->num_bases + num_bases,
+                                      sizeof(char));
+    buffer->kmers = (int*)grow_array(buffer->kmers, &buffer->kmer_capacity, buffer->num_kmers + length,
+                                     sizeof(int));
+    
+    char* bases = buffer->bases + buffer->num_bases;
+    long long occurrences = 0;
+    for (int i = 0; i < length; i++) {
+        int slot = path[i] >> 1;
+        uint64_t kmer = graph->keys[slot] - 1;
+        if (path[i] & 1) kmer = reverse_complement_kmer(kmer, k);
+    
+        // The first k-mer gives k bases, every later one adds its last base
+        if (i == 0) {
+            for (int b = 0; b < k; b++) {
+                bases[b] = "ACGT"[(kmer >> (2 * (k - 1 - b))) & 3];
+            }
+        } else {
+            bases[k + i - 1] = "ACGT"[kmer & 3];
+        }
+        occurrences += graph->counts[slot];
+        buffer->kmers[buffer->num_kmers++] = path[i];
+    }
+    
+    Unitig* unitig = &buffer->unitigs[buffer->num_unitigs++];
+    unitig->start = buffer->num_bases;
+    unitig->length = num_bases;
+    unitig->multiplicity = (double)occurrences / length;
+    buffer->num_bases += num_bases;
+}
+
+// Move a buffer's unitigs into the graph (the caller serializes this) and return the id
+// of the first one
+static int merge_unitigs(DeBruijnGraph* graph, const UnitigBuffer* buffer, int* unitig_capacity,
+                         int* base_capacity) {
+    int first_unitig = graph->num_unitigs;
+    int first_base = graph->num_bases;
+    graph->unitigs = (Unitig*)grow_array(graph->unitigs, unitig_capacity, first_unitig + buffer->num_unitigs,
+                                         sizeof(Unitig));
+    graph->bases = (char*)grow_array(graph->bases, base_capacity, first_base + buffer->num_bases, sizeof(char));
+    
+    for (int u = 0; u < buffer->num_unitigs; u++) {
+        graph->unitigs[first_unitig + u] = buffer->unitigs[u];
+        graph->unitigs[first_unitig + u].start += first_base;
+    }
+    memcpy(graph->bases + first_base, buffer->bases, buffer->num_bases);
+    graph->num_unitigs += buffer->num_unitigs;
+    graph->num_bases += buffer->num_bases;
+    return first_unitig;
+}
+
+// Point every k-mer of a buffer at its unitig; each k-mer is in exactly one buffer
+static void assign_unitig_kmers(DeBruijnGraph* graph, const UnitigBuffer* buffer, int first_unitig) {
+    int next = 0;
+    for (int u = 0; u < buffer->num_unitigs; u++) {
+        int length = buffer->unitigs[u].length - graph->k + 1;
+        for (int offset = 0; offset < length; offset++, next++) {
+            int slot = buffer->kmers[next] >> 1;
+            graph->kmer_unitig[slot] = first_unitig + u;
+            graph->kmer_offset[slot] = 2 * offset + (buffer->kmers[next] & 1);
+        }
+    }
+}
+
+static void free_unitig_buffer(UnitigBuffer* buffer) {
+    free(buffer->unitigs);
+    free(buffer->bases);
+    free(buffer->kmers);
+    memset(buffer, 0, sizeof(UnitigBuffer));
+}
+
+// Build the compacted de Bruijn graph of the query. Threads count canonical k-mers of
+// their part of the query, and the links between neighbouring ones, into one lock-free
+// table; then every k-mer with no predecessor in its unitig starts a walk. Of the two
+// ends of a unitig, the one that spells the smaller strand keeps it. Unitigs closed into
+// cycles have no end and are walked last.
+DeBruijnGraph* build_debruijn_graph(const char* query, int query_len, int k) {
+    if (!query || query_len <= 0 || k < 1 || k > 31 || (k & 1) == 0) {
+        fprintf(stderr, "Invalid parameters for de Bruijn graph (k=%d)\n", k);
+        return NULL;
+    }
+    
+    DeBruijnGraph* graph = (DeBruijnGraph*)calloc(1, sizeof(DeBruijnGraph));
+    if (UNLIKELY(!graph)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    graph->k = k;
+    
+    // Twice the number of k-mer positions keeps the table at most half full
+    int positions = query_len >= k ? query_len - k + 1 : 0;
+    graph->capacity = 1024;
+    while (graph->capacity < 2LL * positions) {
+        if (graph->capacity >= (1 << 30)) {
+            fprintf(stderr, "Query too long for the de Bruijn graph (%d bases)\n", query_len);
+            free(graph);
+            return NULL;
+        }
+        graph->capacity <<= 1;
+    }
+    graph->keys = (uint64_t*)calloc(graph->capacity, sizeof(uint64_t));
+    graph->counts = (int*)calloc(graph->capacity, sizeof(int));
+    graph->kmer_unitig = (int*)malloc(graph->capacity * sizeof(int));
+    graph->kmer_offset = (int*)malloc(graph->capacity * sizeof(int));
+    graph->links = (unsigned char*)calloc(graph->capacity, sizeof(unsigned char));
+    if (UNLIKELY(!graph->keys || !graph->counts || !graph->kmer_unitig || !graph->kmer_offset || !graph->links)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(graph->kmer_unitig, 0xFF, graph->capacity * sizeof(int));
+    
+    // Count k-mers: each thread rolls both strands across its own stretch of start positions.
+    // Two k-mers that follow each other in the query are linked in the graph, so the scan
+    // also records each one as a successor of the other on the matching strand; a thread
+    // starts one k-mer early to see the link into its first k-mer.
+    uint64_t mask = (1ULL << (2 * k)) - 1;
+    int distinct = 0;
+    #pragma omp parallel reduction(+:distinct) if (positions > PARALLEL_THRESHOLD)
+    {
+        int t = omp_get_thread_num();
+        int threads = omp_get_num_threads();
+        int begin = (int)((long long)positions * t / threads);
+        int end = (int)((long long)positions * (t + 1) / threads);
+        uint64_t forward = 0, reverse = 0;
+        int valid = 0;
+        int previous_slot = -1;
+        uint64_t previous = 0;
+    
+        for (int p = begin > 0 ? begin - 1 : 0; p < end + k - 1; p++) {
+            int base = dna_base_code(query[p]);
+            if (base < 0) {
+                valid = 0;
+                continue;
+            }
+            forward = ((forward << 2) | (uint64_t)base) & mask;
+            reverse = (reverse >> 2) | ((uint64_t)(3 - base) << (2 * (k - 1)));
+            if (++valid < k) continue;
+    
+            int inserted;
+            int is_canonical = forward < reverse;
+            int slot = kmer_table_insert(graph, is_canonical ? forward : reverse, &inserted);
+            distinct += inserted;
+            if (p - k + 1 < begin) {
+                previous_slot = slot;
+                previous = forward;
+                continue;
+            }
+            #pragma omp atomic
+            graph->counts[slot]++;
+    
+            // previous + base is this k-mer; on the other strand, this k-mer extended by the
+            // complement of previous's first base is previous
+            if (valid > k) {
+                int first = (int)(previous >> (2 * (k - 1)));
+                int previous_canonical = previous == graph->keys[previous_slot] - 1;
+                unsigned char forward_link = (unsigned char)(1 << (previous_canonical ? base : 4 + base));
+                unsigned char reverse_link = (unsigned char)(1 << (is_canonical ? 4 + (3 - first) : 3 - first));
+                #pragma omp atomic
+                graph->links[previous_slot] |= forward_link;
+                #pragma omp atomic
+                graph->links[slot] |= reverse_link;
+            }
+            previous_slot = slot;
+            previous = forward;
+        }
+    }
+    graph->num_kmers = distinct;
+    
+    int unitig_capacity = 0, base_capacity = 0;
+    omp_lock_t unitig_lock;
+    omp_init_lock(&unitig_lock);
+    
+    #pragma omp parallel
+    {
+        UnitigBuffer local = {0};
+        int* path = NULL;
+        int path_capacity = 0;
+    
+        #pragma omp for schedule(dynamic, 1024)
+        for (int s = 0; s < graph->capacity; s++) {
+            if (graph->keys[s] == 0) continue;
+            uint64_t canonical = graph->keys[s] - 1;
+    
+            for (int strand = 0; strand < 2; strand++) {
+                uint64_t start = strand ? reverse_complement_kmer(canonical, k) : canonical;
+                uint64_t previous;
+                int previous_slot;
+    
+                // Only a k-mer that does not continue a unitig from the left starts one
+                if (linked_successor(graph, reverse_complement_kmer(start, k), s, &previous, &previous_slot)) continue;
+                int length = walk_unitig(graph, start, s, &path, &path_capacity);
+    
+                // The walk from the other end starts at the last k-mer's reverse complement;
+                // of the two, the smaller start keeps the unitig
+                uint64_t other_start = graph->keys[path[length - 1] >> 1] - 1;
+                if (!(path[length - 1] & 1)) other_start = reverse_complement_kmer(other_start, k);
+                if (start > other_start) continue;
+                append_unitig(&local, graph, path, length);
+            }
+        }
+    
+        omp_set_lock(&unitig_lock);
+        int first_unitig = merge_unitigs(graph, &local, &unitig_capacity, &base_capacity);
+        omp_unset_lock(&unitig_lock);
+    
+        assign_unitig_kmers(graph, &local, first_unitig);
+        free_unitig_buffer(&local);
+        free(path);
+    }
+    
+    omp_destroy_lock(&unitig_lock);
+    
+    // What is left lies on cycles; walk each once from any of its k-mers
+    UnitigBuffer cycle = {0};
+    int* path = NULL;
+    int path_capacity = 0;
+    for (int s = 0; s < graph->capacity; s++) {
+        if (graph->keys[s] == 0 || graph->kmer_unitig[s] >= 0) continue;
+        int length = walk_unitig(graph, graph->keys[s] - 1, s, &path, &path_capacity);
+        append_unitig(&cycle, graph, path, length);
+        assign_unitig_kmers(graph, &cycle, merge_unitigs(graph, &cycle, &unitig_capacity, &base_capacity));
+        free_unitig_buffer(&cycle);
+    }
+    free(path);
+    
+    return graph;
+}
+
+// Free memory used by the de Bruijn graph
+void free_debruijn_graph(DeBruijnGraph* graph) {
+    if (!graph) return;
+    
+    free(graph->keys);
+    free(graph->counts);
+    free(graph->kmer_unitig);
+    free(graph->kmer_offset);
+    free(graph->links);
+    free(graph->unitigs);
+    free(graph->bases);
+    free(graph);
+}
+
+static int compare_family_hits(const void* a, const void* b) {
+    const FamilyHit* x = (const FamilyHit*)a;
+    const FamilyHit* y = (const FamilyHit*)b;
+    if (x->unitig != y->unitig) return x->unitig < y->unitig ? -1 : 1;
+    if (x->is_reverse != y->is_reverse) return x->is_reverse - y->is_reverse;
+    if (x->diagonal != y->diagonal) return x->diagonal < y->diagonal ? -1 : 1;
+    return (x->position > y->position) - (x->position < y->position);
+}
+
+// Best supported matches of a family first
+static int compare_family_matches(const void* a, const void* b) {
+    const FamilyMatch* x = (const FamilyMatch*)a;
+    const FamilyMatch* y = (const FamilyMatch*)b;
+    if (x->unitig != y->unitig) return x->unitig < y->unitig ? -1 : 1;
+    if (x->kmers != y->kmers) return x->kmers > y->kmers ? -1 : 1;
+    if (x->first != y->first) return x->first < y->first ? -1 : 1;
+    return x->is_reverse - y->is_reverse;
+}
+
+// Find the repeat families (unitigs with multiplicity above 1) in a sequence. Every
+// k-mer of the sequence is looked up in the graph; k-mers of one family that sit on the
+// same diagonal form one match. Matches are grouped by unitig, best supported first.
+FamilyMatch* match_repeat_families(const DeBruijnGraph* graph, const char* sequence, int seq_len,
+                                   int* num_matches) {
+    int k = graph->k;
+    uint64_t mask = (1ULL << (2 * k)) - 1;
+    int positions = seq_len >= k ? seq_len - k + 1 : 0;
+    
+    int capacity = 0;
+    int hit_count = 0;
+    FamilyHit* hits = NULL;
+    omp_lock_t hit_lock;
+    omp_init_lock(&hit_lock);
+    
+    #pragma omp parallel if (positions > PARALLEL_THRESHOLD)
+    {
+        int t = omp_get_thread_num();
+        int threads = omp_get_num_threads();
+        int begin = (int)((long long)positions * t / threads);
+        int end = (int)((long long)positions * (t + 1) / threads);
+        int local_capacity = 0;
+        int local_count = 0;
+        FamilyHit* local_hits = NULL;
+        uint64_t forward = 0, reverse = 0;
+        int valid = 0;
+    
+        for (int p = begin; p < end + k - 1; p++) {
+            int base = dna_base_code(sequence[p]);
+            if (base < 0) {
+                valid = 0;
+                continue;
+            }
+            forward = ((forward << 2) | (uint64_t)base) & mask;
+            reverse = (reverse >> 2) | ((uint64_t)(3 - base) << (2 * (k - 1)));
+            if (++valid < k) continue;
+    
+            int is_canonical = forward <= reverse;
+            int slot = kmer_table_find(graph, is_canonical ? forward : reverse);
+            if (slot < 0) continue;
+            int unitig = graph->kmer_unitig[slot];
+            if (graph->unitigs[unitig].multiplicity <= 1.0) continue;
+    
+            // The sequence holds the unitig's strand when the unitig spells this k-mer in
+            // canonical form exactly when the sequence does
+            int start = p - k + 1;
+            int offset = graph->kmer_offset[slot] >> 1;
+            int is_reverse = is_canonical == (graph->kmer_offset[slot] & 1);
+    
+            local_hits = (FamilyHit*)grow_array(local_hits, &local_capacity, local_count + 1, sizeof(FamilyHit));
+            FamilyHit* hit = &local_hits[local_count++];
+            hit->unitig = unitig;
+            hit->is_reverse = is_reverse;
+            hit->diagonal = is_reverse ? start + offset : start - offset;
+            hit->position = start;
+        }
+    
+        // Merge thread-local hits into the global array
+        omp_set_lock(&hit_lock);
+        hits = (FamilyHit*)grow_array(hits, &capacity, hit_count + local_count, sizeof(FamilyHit));
+        if (local_count > 0) memcpy(hits + hit_count, local_hits, local_count * sizeof(FamilyHit));
+        hit_count += local_count;
+        omp_unset_lock(&hit_lock);
+    
+        free(local_hits);
+    }
+    
+    omp_destroy_lock(&hit_lock);
+    
+    // Hits of one occurrence are adjacent once sorted by diagonal
+    if (hit_count > 1) qsort(hits, hit_count, sizeof(FamilyHit), compare_family_hits);
+    FamilyMatch* matches = (FamilyMatch*)malloc((hit_count > 0 ? hit_count : 1) * sizeof(FamilyMatch));
+    if (UNLIKELY(!matches)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    int match_count = 0;
+    for (int h = 0; h < hit_count; h++) {
+        if (h > 0 && hits[h].unitig == hits[h - 1].unitig && hits[h].is_reverse == hits[h - 1].is_reverse &&
+            hits[h].diagonal == hits[h - 1].diagonal) {
+            matches[match_count - 1].last = hits[h].position;
+            matches[match_count - 1].kmers++;
+            continue;
+        }
+        FamilyMatch* match = &matches[match_count++];
+        match->unitig = hits[h].unitig;
+        match->is_reverse = hits[h].is_reverse;
+        match->first = hits[h].position;
+        match->last = hits[h].position;
+        match->kmers = 1;
+    }
+    free(hits);
+    
+    if (match_count > 1) qsort(matches, match_count, sizeof(FamilyMatch), compare_family_matches);
+    *num_matches = match_count;
+    return matches;
+}
+
+// A family and the query bases it accounts for (length x multiplicity)
+typedef struct {
+    double score;
+    int unitig;
+    int length;
+    const char* bases;
+} FamilyRank;
+
+// Highest score first; unitig ids depend on thread timing, so ties go by sequence
+static int compare_family_ranks(const void* a, const void* b) {
+    const FamilyRank* x = (const FamilyRank*)a;
+    const FamilyRank* y = (const FamilyRank*)b;
+    if (x->score != y->score) return x->score > y->score ? -1 : 1;
+    if (x->length != y->length) return x->length > y->length ? -1 : 1;
+    return memcmp(x->bases, y->bases, x->length);
+}
+
+// Build the query's repeat graph, print its repeat families with their reference
+// matches to stdout and output_file, and return the number of families reported
+int report_repeat_families(const char* reference, int ref_len, const char* query, int query_len,
+                           FILE* output_file) {
+    double start_time = omp_get_wtime();
+    int k = FAMILY_KMER_DEFAULT;
+    
+    DeBruijnGraph* graph = build_debruijn_graph(query, query_len, k);
+    if (!graph) return -1;
+    
+    int num_matches = 0;
+    FamilyMatch* matches = match_repeat_families(graph, reference, ref_len, &num_matches);
+    
+    // First match of every unitig; matches are grouped by unitig
+    int* match_start = (int*)calloc(graph->num_unitigs + 1, sizeof(int));
+    FamilyRank* families = (FamilyRank*)malloc((graph->num_unitigs > 0 ? graph->num_unitigs : 1) * sizeof(FamilyRank));
+    if (UNLIKELY(!match_start || !families)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int m = 0; m < num_matches; m++) match_start[matches[m].unitig + 1]++;
+    for (int u = 0; u < graph->num_unitigs; u++) match_start[u + 1] += match_start[u];
+    
+    int num_families = 0;
+    for (int u = 0; u < graph->num_unitigs; u++) {
+        const Unitig* unitig = &graph->unitigs[u];
+        if (unitig->multiplicity > 1.0) {
+            FamilyRank* rank = &families[num_families++];
+            rank->score = unitig->length * unitig->multiplicity;
+            rank->unitig = u;
+            rank->length = unitig->length;
+            rank->bases = graph->bases + unitig->start;
+        }
+    }
+    qsort(families, num_families, sizeof(FamilyRank), compare_family_ranks);
+    int reported = num_families;
+    if (finder_options.top_k > 0 && reported > finder_options.top_k) reported = finder_options.top_k;
+    
+    double elapsed_ms = (omp_get_wtime() - start_time) * 1000.0;
+    printf("de Bruijn graph of the query (k=%d): %d distinct k-mers, %d unitigs, %d repeat families\n",
+           k, graph->num_kmers, graph->num_unitigs, num_families);
+    printf("Repeat family time: %.2f milliseconds\n", elapsed_ms);
+    fprintf(output_file, "de Bruijn graph of the query (k=%d): %d distinct k-mers, %d unitigs, %d repeat families\n",
+            k, graph->num_kmers, graph->num_unitigs, num_families);
+    fprintf(output_file, "Repeat family time: %.2f milliseconds\n", elapsed_ms);
+    
+    for (int f = 0; f < reported; f++) {
+        int u = families[f].unitig;
+        const Unitig* unitig = &graph->unitigs[u];
+        const char* bases = graph->bases + unitig->start;
+        int shown = unitig->length < FAMILY_PRINT_BASES ? unitig->length : FAMILY_PRINT_BASES;
+        const char* more = unitig->length > shown ? "..." : "";
+        int family_matches = match_start[u + 1] - match_start[u];
+    
+        printf("Repeat Family %d: Length: %d, Copies: %.1f, Reference Matches: %d\n",
+               f + 1, unitig->length, unitig->multiplicity, family_matches);
+        printf("  Sequence: %.*s%s\n", shown, bases, more);
+        fprintf(output_file, "Repeat Family %d: Length: %d, Copies: %.1f, Reference Matches: %d\n",
+                f + 1, unitig->length, unitig->multiplicity, family_matches);
+        fprintf(output_file, "  Sequence: %.*s%s\n", shown, bases, more);
+    
+        for (int m = 0; m < family_matches && m < FAMILY_MAX_MATCHES; m++) {
+            const FamilyMatch* match = &matches[match_start[u] + m];
+            const char* strand = match->is_reverse ? "reverse" : "forward";
+            int kmers = unitig->length - k + 1;
+            printf("  Match %d (reference %d-%d, %s): %d of %d k-mers\n",
+                   m + 1, match->first, match->last + k, strand, match->kmers, kmers);
+            fprintf(output_file, "  Match %d (reference %d-%d, %s): %d of %d k-mers\n",
+                    m + 1, match->first, match->last + k, strand, match->kmers, kmers);
+        }
+    }
+    
+    free(match_start);
+    free(families);
+    free(matches);
+    free_debruijn_graph(graph);
+    return reported;
+}
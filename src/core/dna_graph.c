@@ -1,6 +1,251 @@
 #include "../include/core/dna_graph.h"
+#include "../include/core/dna_index.h"
+#include "../include/core/dna_topk.h"
 
-// Build a directed acyclic graph representation of the DNA sequences
+// An edge as the scan emits it, before it is placed in the CSR arrays
+typedef struct {
+    int source;
+    int target;
+    int is_reverse;
+} EmittedEdge;
+
+// Turn counts[0..n) into exclusive prefix sums, counts[n] receives the total.
+// Each thread sums one contiguous block, then offsets its block by the blocks before it.
+static void exclusive_prefix_sum(int* counts, int n) {
+    int max_threads = omp_get_max_threads();
+    int* block_sums = (int*)calloc(max_threads + 1, sizeof(int));
+    if (UNLIKELY(!block_sums)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    #pragma omp parallel if (n > PARALLEL_THRESHOLD)
+    {
+        int t = omp_get_thread_num();
+        int threads = omp_get_num_threads();
+        int begin = (int)((long long)n * t / threads);
+        int end = (int)((long long)n * (t + 1) / threads);
+    
+        int sum = 0;
+        for (int i = begin; i < end; i++) {
+            int count = counts[i];
+            counts[i] = sum;
+            sum += count;
+        }
+        block_sums[t + 1] = sum;
+    
+        #pragma omp barrier
+        #pragma omp single
+        {
+            for (int b = 0; b < threads; b++) {
+                block_sums[b + 1] += block_sums[b];
+            }
+            counts[n] = block_sums[threads];
+        }
+    
+        int base = block_sums[t];
+        for (int i = begin; i < end; i++) {
+            counts[i] += base;
+        }
+    }
+    
+    free(block_sums);
+}
+
+// An edge during compaction: the same match seen along its diagonal. Reverse
+// complement diagonals are taken against the reverse complemented query.
+typedef struct {
+    int source;
+    int diagonal;
+    int length;
+    int is_reverse;
+} DiagonalEdge;
+
+static int compare_diagonal_edges(const void* a, const void* b) {
+    const DiagonalEdge* x = (const DiagonalEdge*)a;
+    const DiagonalEdge* y = (const DiagonalEdge*)b;
+    if (x->is_reverse != y->is_reverse) return x->is_reverse - y->is_reverse;
+    if (x->diagonal != y->diagonal) return x->diagonal < y->diagonal ? -1 : 1;
+    return (x->source > y->source) - (x->source < y->source);
+}
+
+// Merge edges that overlap or touch on the same diagonal into one super-edge spanning
+// all of them. Every reference position of a repeat seeds its own edge, so a repeat of
+// length L arrives as about L - min_length + 1 edges and leaves as one. Edges are
+// spread over diagonal buckets, each bucket is sorted and merged by one thread, and
+// the survivors are placed back into CSR form in their original order within a node.
+static void compact_graph_edges(DNAGraph* graph, int query_len) {
+    int num_edges = graph->num_edges;
+    if (num_edges < 2) return;
+    
+    int max_threads = omp_get_max_threads();
+    int num_buckets = 1;
+    while (num_buckets < max_threads * 64 && num_buckets * 16 < num_edges) num_buckets <<= 1;
+    
+    DiagonalEdge* edges = (DiagonalEdge*)malloc(num_edges * sizeof(DiagonalEdge));
+    DiagonalEdge* buckets = (DiagonalEdge*)malloc(num_edges * sizeof(DiagonalEdge));
+    int* bucket_counts = (int*)calloc((size_t)max_threads * num_buckets + 1, sizeof(int));
+    int* bucket_kept = (int*)malloc(num_buckets * sizeof(int));
+    int* node_counts = (int*)calloc(graph->num_nodes + 1, sizeof(int));
+    if (UNLIKELY(!edges || !buckets || !bucket_counts || !bucket_kept || !node_counts)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    // Count every thread's edges per bucket, then scatter them bucket-major; the two
+    // loops share a static schedule so each thread sees the same nodes in both
+    #pragma omp parallel num_threads(max_threads)
+    {
+        int* counts = bucket_counts + (size_t)omp_get_thread_num() * num_buckets;
+    
+        #pragma omp for schedule(static)
+        for (int i = 0; i < graph->num_nodes; i++) {
+            for (int e = graph->offsets[i]; e < graph->offsets[i + 1]; e++) {
+                DiagonalEdge* edge = &edges[e];
+                edge->source = i;
+                edge->length = graph->lengths[e];
+                edge->is_reverse = graph_edge_is_reverse(graph, e);
+                edge->diagonal = edge->is_reverse ? i - (query_len - graph->targets[e] - edge->length)
+                                                  : i - graph->targets[e];
+                counts[(unsigned int)(edge->diagonal * 2 + edge->is_reverse) & (num_buckets - 1)]++;
+            }
+        }
+    
+        #pragma omp single
+        {
+            // Bucket-major prefix sum: bucket b holds thread 0's edges, then thread 1's, ...
+            int total = 0;
+            for (int b = 0; b < num_buckets; b++) {
+                for (int t = 0; t < max_threads; t++) {
+                    int count = bucket_counts[(size_t)t * num_buckets + b];
+                    bucket_counts[(size_t)t * num_buckets + b] = total;
+                    total += count;
+                }
+            }
+            bucket_counts[(size_t)max_threads * num_buckets] = total;
+        }
+    
+        #pragma omp for schedule(static)
+        for (int i = 0; i < graph->num_nodes; i++) {
+            for (int e = graph->offsets[i]; e < graph->offsets[i + 1]; e++) {
+                buckets[counts[(unsigned int)(edges[e].diagonal * 2 + edges[e].is_reverse) & (num_buckets - 1)]++] =
+                    edges[e];
+            }
+        }
+    
+        // Bucket b now starts where thread 0's cursor for b was before the scatter,
+        // which is where the last thread's cursor for b - 1 ended
+        #pragma omp for schedule(dynamic, 16)
+        for (int b = 0; b < num_buckets; b++) {
+            int begin = b == 0 ? 0 : bucket_counts[(size_t)(max_threads - 1) * num_buckets + b - 1];
+            int end = bucket_counts[(size_t)(max_threads - 1) * num_buckets + b];
+            DiagonalEdge* bucket = buckets + begin;
+            int size = end - begin;
+            int kept = 0;
+    
+            qsort(bucket, size, sizeof(DiagonalEdge), compare_diagonal_edges);
+            for (int r = 0; r < size; r++) {
+                DiagonalEdge* last = kept > 0 ? &bucket[kept - 1] : NULL;
+                if (last && last->is_reverse == bucket[r].is_reverse && last->diagonal == bucket[r].diagonal &&
+                    bucket[r].source <= last->source + last->length) {
+                    int span = bucket[r].source + bucket[r].length - last->source;
+                    if (span > last->length) last->length = span;
+                    continue;
+                }
+                bucket[kept++] = bucket[r];
+            }
+            bucket_kept[b] = kept;
+    
+            for (int r = 0; r < kept; r++) {
+                #pragma omp atomic
+                node_counts[bucket[r].source]++;
+            }
+        }
+    }
+    
+    // Rebuild the CSR arrays from the surviving super-edges
+    exclusive_prefix_sum(node_counts, graph->num_nodes);
+    int kept_edges = node_counts[graph->num_nodes];
+    int* targets = (int*)malloc(kept_edges * sizeof(int));
+    int* lengths = (int*)malloc(kept_edges * sizeof(int));
+    uint64_t* reverse = (uint64_t*)calloc((kept_edges >> 6) + 1, sizeof(uint64_t));
+    int* cursors = (int*)malloc(graph->num_nodes * sizeof(int));
+    if (UNLIKELY(!targets || !lengths || !reverse || !cursors)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(cursors, node_counts, graph->num_nodes * sizeof(int));
+    
+    #pragma omp parallel
+    {
+        #pragma omp for schedule(dynamic, 16)
+        for (int b = 0; b < num_buckets; b++) {
+            int begin = b == 0 ? 0 : bucket_counts[(size_t)(max_threads - 1) * num_buckets + b - 1];
+            for (int r = begin; r < begin + bucket_kept[b]; r++) {
+                const DiagonalEdge* edge = &buckets[r];
+                int e;
+                #pragma omp atomic capture
+                e = cursors[edge->source]++;
+    
+                // The strand bit is set once the node's edges are in order
+                targets[e] = edge->is_reverse ? query_len - (edge->source - edge->diagonal) - edge->length
+                                              : edge->source - edge->diagonal;
+                lengths[e] = edge->length;
+                edges[e] = *edge;
+            }
+        }
+    
+        // Buckets land in any order, so restore the scan's order within each node:
+        // forward edges before reverse ones, each by query position
+        #pragma omp for schedule(dynamic, 256)
+        for (int i = 0; i < graph->num_nodes; i++) {
+            for (int e = node_counts[i] + 1; e < node_counts[i + 1]; e++) {
+                DiagonalEdge edge = edges[e];
+                int target = targets[e];
+                int length = lengths[e];
+                int f = e - 1;
+                while (f >= node_counts[i] && (edges[f].is_reverse > edge.is_reverse ||
+                       (edges[f].is_reverse == edge.is_reverse && targets[f] > target))) {
+                    edges[f + 1] = edges[f];
+                    targets[f + 1] = targets[f];
+                    lengths[f + 1] = lengths[f];
+                    f--;
+                }
+                edges[f + 1] = edge;
+                targets[f + 1] = target;
+                lengths[f + 1] = length;
+            }
+            for (int e = node_counts[i]; e < node_counts[i + 1]; e++) {
+                if (edges[e].is_reverse) {
+                    #pragma omp atomic
+                    reverse[e >> 6] |= 1ULL << (e & 63);
+                }
+            }
+        }
+    }
+    
+    printf("Compacted %d graph edges into %d super-edges\n", num_edges, kept_edges);
+    
+    free(graph->offsets);
+    free(graph->targets);
+    free(graph->lengths);
+    free(graph->reverse);
+    graph->offsets = node_counts;
+    graph->targets = targets;
+    graph->lengths = lengths;
+    graph->reverse = reverse;
+    graph->num_edges = kept_edges;
+    
+    free(edges);
+    free(buckets);
+    free(bucket_counts);
+    free(bucket_kept);
+    free(cursors);
+}
+
+// Build the seed match graph. Threads scan reference positions and emit edges into
+// thread-local buffers, counting the edges of each node they own; a prefix sum of
+// the counts gives the CSR offsets and every thread then scatters its own edges.
 DNAGraph* build_dna_graph(const char* reference, int ref_len, const char* query, int query_len) {
     printf("Building DNA graph for pattern matching...\n");
     
@@ -11,143 +256,203 @@ DNAGraph* build_dna_graph(const char* reference, int ref_len, const char* query,
     }
     
     // Allocate and initialize the graph
-    DNAGraph* graph = (DNAGraph*)malloc(sizeof(DNAGraph));
+    DNAGraph* graph = (DNAGraph*)calloc(1, sizeof(DNAGraph));
     if (!graph) {
         fprintf(stderr, "Failed to allocate memory for graph\n");
         return NULL;
     }
     
-    // Create nodes for each position in the reference sequence
-    int initial_capacity = ref_len;
-    graph->nodes = (GraphNode*)malloc(initial_capacity * sizeof(GraphNode));
-    if (!graph->nodes) {
+    // One node per reference position; offsets[i] counts the edges of node i until the prefix sum
+    graph->num_nodes = ref_len;
+    graph->offsets = (int*)calloc(ref_len + 1, sizeof(int));
+    if (!graph->offsets) {
         fprintf(stderr, "Failed to allocate memory for graph nodes\n");
         free(graph);
         return NULL;
     }
     
-    graph->num_nodes = ref_len;
-    graph->capacity = initial_capacity;
-    
-    // Initialize each node
-    #pragma omp parallel for
-    for (int i = 0; i < ref_len; i++) {
-        graph->nodes[i].position = i;
-        graph->nodes[i].edges = NULL;
-        graph->nodes[i].num_edges = 0;
-        graph->nodes[i].capacity = 0;
-    }
-    
     // Parameters for matching
     int min_length = 5 > (ref_len / 1000) ? 5 : (ref_len / 1000);
     
-    // For large reference sequences, limit the positions we check
+    // For large reference sequences, limit the positions we check unless exact mode is on
     int max_positions_to_check = 10000;
     int positions_step = ref_len > max_positions_to_check ? (ref_len / max_positions_to_check) : 1;
+    if (finder_options.exact_mode) {
+        positions_step = 1;
+    }
+    
+    // Seed lookups come from indexes of the query and its reverse complement;
+    // a hit at p in query_rc is a reverse complement match at query_len - p - min_length
+    int seed_k = choose_kmer_size(query_len, min_length);
+    char* query_rc = get_reverse_complement(query, query_len);
+    KmerIndex* query_index = build_kmer_index(query, query_len, seed_k);
+    KmerIndex* query_rc_index = build_kmer_index(query_rc, query_len, seed_k);
+    if (!query_index || !query_rc_index) {
+        fprintf(stderr, "Failed to build query index for graph\n");
+        free_kmer_index(query_index);
+        free_kmer_index(query_rc_index);
+        free(query_rc);
+        free_dna_graph(graph);
+        return NULL;
+    }
     
     printf("Building graph edges with min_length=%d...\n", min_length);
+    graph->seed_length = min_length;
+    graph->seed_step = positions_step;
+    
+    // In self mode a forward match and its mirror image are the same pair of copies and
+    // sit on mirrored diagonals, so only edges to later positions are kept. Reverse
+    // matches are mirrored along their own anti-diagonal and are resolved after extension.
+    int self = finder_options.self_mode && reference == query && ref_len == query_len;
     
-    // Build edges between nodes based on sequence matches
-    #pragma omp parallel for schedule(dynamic)
-    for (int i = 0; i < ref_len - min_length; i += positions_step) {
-        // Extract segment from reference
-        char* segment = (char*)malloc((min_length + 1) * sizeof(char));
-        if (!segment) continue;
-        
-        strncpy(segment, reference + i, min_length);
-        segment[min_length] = '\0';
-        
-        // Find matches in query
-        int start_idx = 0;
-        while (1) {
-            char* found = strstr(query + start_idx, segment);
-            if (!found) break;
-            
-            int match_pos = found - query;
-            
-            // Add an edge in the graph
-            #pragma omp critical
-            {
-                add_edge(&graph->nodes[i], &graph->nodes[match_pos], min_length, 0);
-            }
-            
-            start_idx = match_pos + 1;
-            if (start_idx >= query_len - min_length) break;
-        }
-        
-        // Check for reverse complement matches
-        char* rev_comp = get_reverse_complement(segment, min_length);
-        start_idx = 0;
-        
-        while (1) {
-            char* found = strstr(query + start_idx, rev_comp);
-            if (!found) break;
-            
-            int match_pos = found - query;
-            
-            // Add an edge for reverse complement match
-            #pragma omp critical
-            {
-                add_edge(&graph->nodes[i], &graph->nodes[match_pos], min_length, 1);
-            }
-            
-            start_idx = match_pos + 1;
-            if (start_idx >= query_len - min_length) break;
-        }
-        
-        free(segment);
-        free(rev_comp);
-    }
-    
-    printf("Graph construction complete: %d nodes created\n", graph->num_nodes);
+    int max_threads = omp_get_max_threads();
+    EmittedEdge** thread_edges = (EmittedEdge**)calloc(max_threads, sizeof(EmittedEdge*));
+    int* thread_counts = (int*)calloc(max_threads, sizeof(int));
+    if (UNLIKELY(!thread_edges || !thread_counts)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    int positions_checked = 0;
+    double scan_start = omp_get_wtime();
+    
+    #pragma omp parallel reduction(+:positions_checked)
+    {
+        int local_capacity = 256;
+        int local_count = 0;
+        EmittedEdge* local_edges = (EmittedEdge*)malloc(local_capacity * sizeof(EmittedEdge));
+        if (UNLIKELY(!local_edges)) {
+            fprintf(stderr, "Memory allocation failed in thread %d\n", omp_get_thread_num());
+            exit(EXIT_FAILURE);
+        }
+    
+        // Build edges between nodes based on sequence matches. Every node is scanned by
+        // exactly one thread, so its count needs no synchronization.
+        #pragma omp for schedule(dynamic, 64)
+        for (int i = 0; i < ref_len - min_length; i += positions_step) {
+            positions_checked++;
+            const char* segment = reference + i;
+            const int* seeds;
+    
+            for (int is_reverse = 0; is_reverse <= 1; is_reverse++) {
+                const char* target = is_reverse ? query_rc : query;
+                int num_seeds = kmer_index_lookup(is_reverse ? query_rc_index : query_index, segment, &seeds);
+    
+                // Reverse hits are visited from the back so their query positions ascend
+                for (int n = 0; n < num_seeds; n++) {
+                    int p = is_reverse ? seeds[num_seeds - 1 - n] : seeds[n];
+                    if ((self && !is_reverse && p <= i) || p + min_length > query_len || 
+                        memcmp(target + p + seed_k, segment + seed_k, min_length - seed_k) != 0) {
+                        continue;
+                    }
+    
+                    if (local_count >= local_capacity) {
+                        local_capacity *= 2;
+                        EmittedEdge* new_local = (EmittedEdge*)realloc(local_edges, 
+                                                  local_capacity * sizeof(EmittedEdge));
+                        if (UNLIKELY(!new_local)) {
+                            fprintf(stderr, "Memory reallocation failed\n");
+                            exit(EXIT_FAILURE);
+                        }
+                        local_edges = new_local;
+                    }
+    
+                    EmittedEdge* edge = &local_edges[local_count++];
+                    edge->source = i;
+                    edge->target = is_reverse ? query_len - p - min_length : p;
+                    edge->is_reverse = is_reverse;
+                    graph->offsets[i]++;
+                }
+            }
+        }
+    
+        thread_edges[omp_get_thread_num()] = local_edges;
+        thread_counts[omp_get_thread_num()] = local_count;
+    }
+    
+    report_scan_throughput("Graph edge scan", positions_checked, omp_get_wtime() - scan_start);
+    
+    free_kmer_index(query_index);
+    free_kmer_index(query_rc_index);
+    free(query_rc);
+    
+    // Edge counts become offsets, then the edge arrays can be sized exactly
+    exclusive_prefix_sum(graph->offsets, ref_len);
+    int num_edges = graph->offsets[ref_len];
+    graph->num_edges = num_edges;
+    graph->targets = (int*)malloc((num_edges > 0 ? num_edges : 1) * sizeof(int));
+    graph->lengths = (int*)malloc((num_edges > 0 ? num_edges : 1) * sizeof(int));
+    graph->reverse = (uint64_t*)calloc((num_edges >> 6) + 1, sizeof(uint64_t));
+    if (UNLIKELY(!graph->targets || !graph->lengths || !graph->reverse)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    // A node's edges sit together, in emission order, in the buffer of the thread that
+    // scanned it, so each thread writes them from the node's offset onwards
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int t = 0; t < max_threads; t++) {
+        const EmittedEdge* edges = thread_edges[t];
+        int source = -1;
+        int e = 0;
+        for (int r = 0; r < thread_counts[t]; r++) {
+            if (edges[r].source != source) {
+                source = edges[r].source;
+                e = graph->offsets[source];
+            }
+            graph->targets[e] = edges[r].target;
+            graph->lengths[e] = min_length;
+            if (edges[r].is_reverse) {
+                // Neighbouring nodes of other threads can share the word
+                #pragma omp atomic
+                graph->reverse[e >> 6] |= 1ULL << (e & 63);
+            }
+            e++;
+        }
+    }
+    
+    for (int t = 0; t < max_threads; t++) {
+        free(thread_edges[t]);
+    }
+    free(thread_edges);
+    free(thread_counts);
+    
+    compact_graph_edges(graph, query_len);
+    
+    printf("Graph construction complete: %d nodes, %d edges\n", graph->num_nodes, graph->num_edges);
     return graph;
 }
 
-// Add an edge between two nodes in the graph
-void add_edge(GraphNode* source, GraphNode* target, int match_length, int is_reverse) {
-    if (!source || !target) return; // Validate parameters
-    
-    // Allocate initial edges array if needed
-    if (source->edges == NULL) {
-        source->capacity = 5;  // Start with space for 5 edges
-        source->edges = (GraphEdge*)malloc(source->capacity * sizeof(GraphEdge));
-        if (!source->edges) return;
-    }
-    
-    // Expand edges array if needed
-    if (source->num_edges >= source->capacity) {
-        source->capacity *= 2;
-        GraphEdge* new_edges = (GraphEdge*)realloc(source->edges, source->capacity * sizeof(GraphEdge));
-        if (!new_edges) return;
-        source->edges = new_edges;
-    }
-    
-    // Add the new edge with parameters
-    source->edges[source->num_edges].target = target;
-    source->edges[source->num_edges].match_length = match_length;
-    source->edges[source->num_edges].weight = match_length + (is_reverse ? 0.5 : 0);  // Weight based on match length
-    source->edges[source->num_edges].is_reverse = is_reverse;
-    source->num_edges++;
-}
-
 // Free memory used by the DNA graph
 void free_dna_graph(DNAGraph* graph) {
     if (!graph) return;
     
-    if (graph->nodes) {
-        for (int i = 0; i < graph->num_nodes; i++) {
-            if (graph->nodes[i].edges) {
-                free(graph->nodes[i].edges);
-            }
-        }
-        free(graph->nodes);
-    }
-    
+    free(graph->offsets);
+    free(graph->targets);
+    free(graph->lengths);
+    free(graph->reverse);
     free(graph);
 }
 
-// Find repeats by traversing paths in the DNA graph
-RepeatPattern* find_repeats_in_graph(DNAGraph* graph, const char* reference, const char* query, int* num_repeats) {
+static int compare_graph_repeats(const void* a, const void* b) {
+    const RepeatPattern* x = (const RepeatPattern*)a;
+    const RepeatPattern* y = (const RepeatPattern*)b;
+    if (x->position != y->position) return x->position < y->position ? -1 : 1;
+    if (x->length != y->length) return x->length < y->length ? -1 : 1;
+    if (x->is_reverse != y->is_reverse) return x->is_reverse - y->is_reverse;
+    return (x->query_position > y->query_position) - (x->query_position < y->query_position);
+}
+
+// Find repeats by traversing paths in the DNA graph. Every edge is extended to
+// a maximal match in both directions; reverse complement edges are extended
+// against the reverse complemented query so both strands use the same
+// word-at-a-time comparison. Edges on one diagonal extend to the same match,
+// so duplicates are removed before returning. Like the original traversal, a full
+// search returns at most GRAPH_MAX_REPEATS repeats, those at the lowest reference positions.
+// A top-K search resolves every match's position to the repeat a full search keeps there
+// and ranks it by length x count, so within that cap it returns the full search's best K.
+RepeatPattern* find_repeats_in_graph(DNAGraph* graph, const char* reference, int ref_len, 
+                                     const char* query, int query_len, int* num_repeats) {
     if (!graph || !reference || !query || !num_repeats) {
         if (num_repeats) *num_repeats = 0;
         return NULL;
@@ -155,63 +460,192 @@ RepeatPattern* find_repeats_in_graph(DNAGraph* graph, const char* reference, con
     
     printf("Finding repeats using graph traversal (length 50-100)...\n");
     
-    // Allocate space for repeat patterns
-    int max_repeats = 100;
-    RepeatPattern* repeats = (RepeatPattern*)malloc(max_repeats * sizeof(RepeatPattern));
-    if (!repeats) {
-        *num_repeats = 0;
-        return NULL;
-    }
-    
-    int repeat_count = 0;
     int min_repeat_length = 50;  // 修改为最小长度50
     int max_repeat_length = 100; // 最大长度100
     
-    // Iterate through all graph nodes to find potential repeats
-    for (int i = 0; i < graph->num_nodes && repeat_count < max_repeats; i++) {
-        GraphNode* current_node = &graph->nodes[i];
-        
-        // Skip nodes with no edges
-        if (current_node->num_edges == 0) continue;
-        
-        for (int j = 0; j < current_node->num_edges && repeat_count < max_repeats; j++) {
-            GraphEdge* edge = &current_node->edges[j];
-            int match_length = edge->match_length;
-            
-            // 尝试扩展匹配长度
-            if (match_length >= 5) { // 最小匹配长度为5，然后尝试扩展
-                int ref_pos = current_node->position;
-                int query_pos = edge->target->position;
-                int is_reverse = edge->is_reverse;
-                int extended_length = match_length;
-                
-                if (!is_reverse) {
-                    // 向前扩展匹配
-                    while (ref_pos + extended_length < strlen(reference) && 
-                           query_pos + extended_length < strlen(query) &&
-                           reference[ref_pos + extended_length] == query[query_pos + extended_length]) {
-                        extended_length++;
-                    }
-                } else {
-                    // 对于反向互补，我们需要不同的扩展逻辑
-                    // 这里简化处理，仅使用原始匹配长度
+    int self = finder_options.self_mode && reference == query && ref_len == query_len;
+    
+    // A match query[q, q+len) == rev_comp(reference[r, r+len)) is the forward match
+    // query_rc[query_len-q-len, query_len-q) == reference[r, r+len)
+    char* query_rc = get_reverse_complement(query, query_len);
+    
+    int capacity = 100;
+    RepeatPattern* repeats = allocate_repeat_patterns(capacity);
+    if (UNLIKELY(!repeats)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    int repeat_count = 0;
+    
+    // Top-K mode keeps a bounded heap of scored repeats per thread instead of every match.
+    // Positions are resolved and counted against k-mer indexes of both query strands.
+    int top_k = finder_options.top_k;
+    TopKHeap* top = top_k > 0 ? create_topk_heap(top_k) : NULL;
+    long long shared_floor = -1;
+    RepeatScope scopes[2];
+    KmerIndex* strand_index[2] = {NULL, NULL};
+    if (top) {
+        int seed_k = choose_kmer_size(query_len, min_repeat_length);
+        for (int strand = 0; strand <= 1; strand++) {
+            const char* target = strand ? query_rc : query;
+            strand_index[strand] = build_kmer_index(target, query_len, seed_k);
+            if (UNLIKELY(!strand_index[strand])) {
+                fprintf(stderr, "Failed to build query index\n");
+                exit(EXIT_FAILURE);
+            }
+            RepeatScope scope = {target, query_len, strand_index[strand], strand, min_repeat_length, 
+                                 max_repeat_length, 0, SELF_ALL, graph->seed_step, graph->seed_length};
+            if (self) scope.self_rule = strand ? SELF_MIRROR : SELF_TARGET_AFTER;
+            scopes[strand] = scope;
+        }
+    }
+    
+    omp_lock_t repeat_lock;
+    omp_init_lock(&repeat_lock);
+    
+    #pragma omp parallel
+    {
+        int local_capacity = 64;
+        int local_count = 0;
+        RepeatPattern* local_repeats = allocate_repeat_patterns(local_capacity);
+        if (UNLIKELY(!local_repeats)) {
+            fprintf(stderr, "Memory allocation failed in thread %d\n", omp_get_thread_num());
+            exit(EXIT_FAILURE);
+        }
+        TopKHeap* local_top = top ? create_topk_heap(top_k) : NULL;
+        int last_position = -1, last_reverse = -1;
+    
+        #pragma omp for schedule(dynamic, 256)
+        for (int i = 0; i < graph->num_nodes; i++) {
+            long long threshold = local_top ? topk_threshold(local_top, &shared_floor) : -1;
+    
+            for (int e = graph->offsets[i]; e < graph->offsets[i + 1]; e++) {
+                int match_length = graph->lengths[e];
+                if (match_length < 5) continue; // 最小匹配长度为5，然后尝试扩展
+    
+                int ref_pos = i;
+                int is_reverse = graph_edge_is_reverse(graph, e);
+                const char* target = is_reverse ? query_rc : query;
+                int target_pos = is_reverse ? query_len - graph->targets[e] - match_length 
+                                            : graph->targets[e];
+    
+                // 向两侧扩展匹配
+                int right_limit = ref_len - ref_pos - match_length;
+                if (query_len - target_pos - match_length < right_limit) {
+                    right_limit = query_len - target_pos - match_length;
                 }
-                
+                int left_limit = ref_pos < target_pos ? ref_pos : target_pos;
+    
+                int right = match_forward(reference + ref_pos + match_length, 
+                                          target + target_pos + match_length, right_limit);
+                int left = match_backward(reference + ref_pos, target + target_pos, left_limit);
+                int extended_length = left + match_length + right;
+    
                 // 如果扩展后的长度在50-100范围内，保存为重复序列
-                if (extended_length >= min_repeat_length && extended_length <= max_repeat_length) {
-                    // Store as repeat pattern
-                    repeats[repeat_count].position = ref_pos;
-                    repeats[repeat_count].length = extended_length;
-                    repeats[repeat_count].count = 1;
-                    repeats[repeat_count].is_reverse = is_reverse;
-                    repeats[repeat_count].orig_seq = NULL;
-                    repeats[repeat_count].repeat_examples = NULL;
-                    repeats[repeat_count].num_examples = 0;
-                    
-                    repeat_count++;
+                if (extended_length < min_repeat_length || extended_length > max_repeat_length) {
+                    continue;
+                }
+                int query_position = is_reverse ? query_len - (target_pos - left) - extended_length 
+                                                : target_pos - left;
+    
+                // Self mode keeps one of a reverse match and its mirror image
+                if (self && is_reverse && ref_pos - left > query_position) continue;
+    
+                // Offer the repeat a full search keeps at this position, once per run of edges
+                if (local_top) {
+                    int position = ref_pos - left;
+                    if (position == last_position && is_reverse == last_reverse) continue;
+                    last_position = position;
+                    last_reverse = is_reverse;
+    
+                    RepeatPattern candidate;
+                    const RepeatScope* scope = &scopes[is_reverse];
+                    if (repeat_score_bound(scope, reference, ref_len, position) >= threshold &&
+                        resolve_repeat(scope, reference, ref_len, position, &candidate) &&
+                        topk_offer(local_top, &candidate)) {
+                        threshold = topk_threshold(local_top, &shared_floor);
+                    }
+                    continue;
+                }
+    
+                if (local_count >= local_capacity) {
+                    local_capacity *= 2;
+                    RepeatPattern* new_local = resize_repeat_patterns(local_repeats, local_count, 
+                                                                      local_capacity);
+                    if (UNLIKELY(!new_local)) {
+                        fprintf(stderr, "Memory reallocation failed\n");
+                        exit(EXIT_FAILURE);
+                    }
+                    local_repeats = new_local;
                 }
+    
+                RepeatPattern* repeat = &local_repeats[local_count++];
+                repeat->position = ref_pos - left;
+                repeat->length = extended_length;
+                repeat->count = 1;
+                repeat->is_reverse = is_reverse;
+                repeat->query_position = query_position;
+                repeat->orig_seq = NULL;
+                repeat->example_positions = NULL;
+                repeat->num_examples = 0;
+            }
+    
+            if (local_top) {
+                topk_publish_floor(local_top, &shared_floor);
+            }
+        }
+    
+        // Merge thread-local results into global array
+        omp_set_lock(&repeat_lock);
+        if (local_top) {
+            topk_merge(top, local_top);
+        }
+        if (repeat_count + local_count > capacity) {
+            while (repeat_count + local_count > capacity) capacity *= 2;
+            RepeatPattern* new_repeats = resize_repeat_patterns(repeats, repeat_count, capacity);
+            if (UNLIKELY(!new_repeats)) {
+                fprintf(stderr, "Memory reallocation failed during merge\n");
+                omp_unset_lock(&repeat_lock);
+                exit(EXIT_FAILURE);
             }
+            repeats = new_repeats;
         }
+        memcpy(repeats + repeat_count, local_repeats, local_count * sizeof(RepeatPattern));
+        repeat_count += local_count;
+        omp_unset_lock(&repeat_lock);
+    
+        free(local_repeats);
+    }
+    
+    omp_destroy_lock(&repeat_lock);
+    free_kmer_index(strand_index[0]);
+    free_kmer_index(strand_index[1]);
+    free(query_rc);
+    
+    // The heaps already dropped duplicate matches
+    if (top) {
+        free(repeats);
+        repeats = topk_release(top, &repeat_count);
+        printf("Kept the %d best graph repeats (top %d)\n", repeat_count, top_k);
+    }
+    
+    // Collapse edges that extended to the same match
+    if (repeat_count > 1) {
+        qsort(repeats, repeat_count, sizeof(RepeatPattern), compare_graph_repeats);
+        int unique = 1;
+        for (int r = 1; r < repeat_count; r++) {
+            if (compare_graph_repeats(&repeats[r], &repeats[unique - 1]) != 0) {
+                repeats[unique++] = repeats[r];
+            }
+        }
+        repeat_count = unique;
+    }
+    
+    // The heap already bounds a top-K search; a full one keeps the original cap
+    if (top_k <= 0 && repeat_count > GRAPH_MAX_REPEATS) {
+        printf("Keeping the first %d of %d graph matches by reference position\n", 
+               GRAPH_MAX_REPEATS, repeat_count);
+        repeat_count = GRAPH_MAX_REPEATS;
     }
     
     // If no repeats found
@@ -224,4 +658,4 @@ RepeatPattern* find_repeats_in_graph(DNAGraph* graph, const char* reference, con
     // Set the return values
     *num_repeats = repeat_count;
     return repeats;
-}
\ No newline at end of file
+}
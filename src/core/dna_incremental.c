@@ -0,0 +1,434 @@
+#include "../include/core/dna_incremental.h"
+
+// Identifies a state file and its layout version
+static const char STATE_MAGIC[8] = {'D', 'N', 'A', 'I', 'N', 'C', '2', '\0'};
+
+// FNV-1a hash of a sequence, used to notice that the reference changed
+uint64_t hash_sequence(const char* sequence, int length) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (int i = 0; i < length; i++) {
+        hash ^= (unsigned char)sequence[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static int compare_runs(const void* a, const void* b) {
+    const DiagonalSegment* x = (const DiagonalSegment*)a;
+    const DiagonalSegment* y = (const DiagonalSegment*)b;
+    if (x->diagonal != y->diagonal) return x->diagonal < y->diagonal ? -1 : 1;
+    if (x->ref_start != y->ref_start) return x->ref_start < y->ref_start ? -1 : 1;
+    return (x->length > y->length) - (x->length < y->length);
+}
+
+// Thread-unsafe growable run list used while one edit is applied
+typedef struct {
+    DiagonalSegment* runs;
+    int count;
+    int capacity;
+} RunList;
+
+static void push_run(RunList* list, int diagonal, int ref_start, int length) {
+    if (list->count >= list->capacity) {
+        list->capacity = list->capacity > 0 ? list->capacity * 2 : 16;
+        DiagonalSegment* new_runs = (DiagonalSegment*)realloc(list->runs,
+                                     list->capacity * sizeof(DiagonalSegment));
+        if (UNLIKELY(!new_runs)) {
+            fprintf(stderr, "Memory reallocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        list->runs = new_runs;
+    }
+    DiagonalSegment* run = &list->runs[list->count++];
+    run->diagonal = diagonal;
+    run->ref_start = ref_start;
+    run->length = length;
+}
+
+// Write a k-mer index as k, the sequence length, the bucket offsets and the positions
+static int write_kmer_index(const KmerIndex* index, FILE* file) {
+    size_t num_offsets = ((size_t)1 << (2 * index->k)) + 1;
+    size_t num_positions = index->offsets[num_offsets - 1];
+    return fwrite(&index->k, sizeof(int), 1, file) == 1 &&
+           fwrite(&index->seq_len, sizeof(int), 1, file) == 1 &&
+           fwrite(index->offsets, sizeof(unsigned int), num_offsets, file) == num_offsets &&
+           fwrite(index->positions, sizeof(int), num_positions, file) == num_positions;
+}
+
+// Read an index written by write_kmer_index, NULL if it is truncated or inconsistent
+static KmerIndex* read_kmer_index(FILE* file) {
+    KmerIndex* index = (KmerIndex*)calloc(1, sizeof(KmerIndex));
+    if (UNLIKELY(!index)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    int ok = fread(&index->k, sizeof(int), 1, file) == 1 && index->k >= 1 && index->k <= KMER_INDEX_MAX_K &&
+             fread(&index->seq_len, sizeof(int), 1, file) == 1 && index->seq_len >= 0;
+    size_t num_offsets = ok ? ((size_t)1 << (2 * index->k)) + 1 : 0;
+    if (ok) {
+        index->offsets = (unsigned int*)malloc(num_offsets * sizeof(unsigned int));
+        ok = index->offsets &&
+             fread(index->offsets, sizeof(unsigned int), num_offsets, file) == num_offsets &&
+             index->offsets[0] == 0 && index->offsets[num_offsets - 1] <= (unsigned int)index->seq_len;
+    }
+    for (size_t b = 1; ok && b < num_offsets; b++) {
+        ok = index->offsets[b - 1] <= index->offsets[b];
+    }
+    if (ok) {
+        size_t num_positions = index->offsets[num_offsets - 1];
+        index->positions = (int*)malloc((num_positions > 0 ? num_positions : 1) * sizeof(int));
+        ok = index->positions && fread(index->positions, sizeof(int), num_positions, file) == num_positions;
+    }
+    
+    if (!ok) {
+        free_kmer_index(index);
+        return NULL;
+    }
+    return index;
+}
+
+// Analyze the pair from scratch with the diagonal engine and keep everything an
+// update needs: the query, its runs of at least DIAGONAL_MIN_RUN bases and the
+// reference k-mer index
+IncrementalState* build_incremental_state(const char* reference, int ref_len, const char* query, int query_len) {
+    IncrementalState* state = (IncrementalState*)malloc(sizeof(IncrementalState));
+    if (UNLIKELY(!state)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    state->ref_len = ref_len;
+    state->ref_hash = hash_sequence(reference, ref_len);
+    state->ref_index = build_kmer_index(reference, ref_len, choose_kmer_size(ref_len, KMER_INDEX_MAX_K));
+    if (!state->ref_index) {
+        free(state);
+        return NULL;
+    }
+    state->query_len = query_len;
+    state->query = (char*)malloc(query_len + 1);
+    if (UNLIKELY(!state->query)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(state->query, query, query_len);
+    state->query[query_len] = '\0';
+    
+    state->runs = find_diagonal_runs(reference, ref_len, query, query_len, DIAGONAL_MIN_RUN, &state->num_runs);
+    state->run_capacity = state->num_runs;
+    return state;
+}
+
+// Read a state written by save_incremental_state, NULL if missing or malformed
+IncrementalState* load_incremental_state(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+    
+    char magic[8];
+    IncrementalState* state = (IncrementalState*)calloc(1, sizeof(IncrementalState));
+    if (UNLIKELY(!state)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    int ok = fread(magic, sizeof(magic), 1, file) == 1 && memcmp(magic, STATE_MAGIC, sizeof(magic)) == 0 &&
+             fread(&state->ref_len, sizeof(int), 1, file) == 1 &&
+             fread(&state->ref_hash, sizeof(uint64_t), 1, file) == 1 &&
+             (state->ref_index = read_kmer_index(file)) != NULL &&
+             state->ref_index->seq_len == state->ref_len &&
+             fread(&state->query_len, sizeof(int), 1, file) == 1 &&
+             state->query_len >= 0;
+    if (ok) {
+        state->query = (char*)malloc(state->query_len + 1);
+        ok = state->query && fread(state->query, 1, state->query_len, file) == (size_t)state->query_len &&
+             fread(&state->num_runs, sizeof(int), 1, file) == 1 && state->num_runs >= 0;
+    }
+    if (ok) {
+        state->query[state->query_len] = '\0';
+        state->run_capacity = state->num_runs;
+        state->runs = (DiagonalSegment*)malloc((state->num_runs > 0 ? state->num_runs : 1) * sizeof(DiagonalSegment));
+        ok = state->runs &&
+             fread(state->runs, sizeof(DiagonalSegment), state->num_runs, file) == (size_t)state->num_runs;
+    }
+    fclose(file);
+    
+    if (!ok) {
+        fprintf(stderr, "Ignoring unreadable incremental state: %s\n", path);
+        free_incremental_state(state);
+        return NULL;
+    }
+    return state;
+}
+
+// Write the state in one binary file, returns 1 on success
+int save_incremental_state(const IncrementalState* state, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to create state file: %s\n", path);
+        return 0;
+    }
+    
+    int ok = fwrite(STATE_MAGIC, sizeof(STATE_MAGIC), 1, file) == 1 &&
+             fwrite(&state->ref_len, sizeof(int), 1, file) == 1 &&
+             fwrite(&state->ref_hash, sizeof(uint64_t), 1, file) == 1 &&
+             write_kmer_index(state->ref_index, file) &&
+             fwrite(&state->query_len, sizeof(int), 1, file) == 1 &&
+             fwrite(state->query, 1, state->query_len, file) == (size_t)state->query_len &&
+             fwrite(&state->num_runs, sizeof(int), 1, file) == 1 &&
+             fwrite(state->runs, sizeof(DiagonalSegment), state->num_runs, file) == (size_t)state->num_runs;
+    if (fclose(file) != 0) ok = 0;
+    
+    if (!ok) {
+        fprintf(stderr, "Failed to write state file: %s\n", path);
+    }
+    return ok;
+}
+
+// Free an incremental state
+void free_incremental_state(IncrementalState* state) {
+    if (!state) return;
+    free_kmer_index(state->ref_index);
+    free(state->query);
+    free(state->runs);
+    free(state);
+}
+
+// Read an edit list. Every line is "<position> <deleted> <inserted>" with "-" for no
+// inserted bases; '#' starts a comment. Edits apply in order, each to the query left
+// by the previous one. Returns NULL with *num_edits = -1 on a malformed line.
+QueryEdit* read_query_edits(const char* path, int* num_edits) {
+    *num_edits = -1;
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Could not open edit list: %s\n", path);
+        return NULL;
+    }
+    
+    int capacity = 16, count = 0;
+    QueryEdit* edits = (QueryEdit*)malloc(capacity * sizeof(QueryEdit));
+    if (UNLIKELY(!edits)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    char line[4096];
+    char bases[4096];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        char* text = line;
+        while (isspace((unsigned char)*text)) text++;
+        if (*text == '\0' || *text == '#') continue;
+    
+        int position, deleted;
+        if (sscanf(text, "%d %d %4095s", &position, &deleted, bases) != 3 || position < 0 || deleted < 0) {
+            fprintf(stderr, "Malformed edit on line %d of %s\n", line_number, path);
+            free_query_edits(edits, count);
+            fclose(file);
+            return NULL;
+        }
+    
+        int inserted_len = strcmp(bases, "-") == 0 ? 0 : (int)strlen(bases);
+        for (int i = 0; i < inserted_len; i++) {
+            bases[i] = toupper((unsigned char)bases[i]);
+            if (dna_base_code(bases[i]) < 0) {
+                fprintf(stderr, "Invalid base '%c' on line %d of %s\n", bases[i], line_number, path);
+                free_query_edits(edits, count);
+                fclose(file);
+                return NULL;
+            }
+        }
+    
+        if (count >= capacity) {
+            capacity *= 2;
+            QueryEdit* new_edits = (QueryEdit*)realloc(edits, capacity * sizeof(QueryEdit));
+            if (UNLIKELY(!new_edits)) {
+                fprintf(stderr, "Memory reallocation failed\n");
+                exit(EXIT_FAILURE);
+            }
+            edits = new_edits;
+        }
+        QueryEdit* edit = &edits[count++];
+        edit->position = position;
+        edit->deleted = deleted;
+        edit->inserted = strndup(bases, inserted_len);
+        edit->inserted_len = inserted_len;
+    }
+    fclose(file);
+    
+    *num_edits = count;
+    return edits;
+}
+
+// Describe new_query as one edit of old_query: everything between the common prefix
+// and the common suffix is replaced. No edits when the queries are equal.
+QueryEdit* diff_query(const char* old_query, int old_len, const char* new_query, int new_len, int* num_edits) {
+    int shorter = old_len < new_len ? old_len : new_len;
+    int prefix = match_forward(old_query, new_query, shorter);
+    if (prefix == old_len && prefix == new_len) {
+        *num_edits = 0;
+        return NULL;
+    }
+    int suffix = match_backward(old_query + old_len, new_query + new_len, shorter - prefix);
+    
+    QueryEdit* edit = (QueryEdit*)malloc(sizeof(QueryEdit));
+    if (UNLIKELY(!edit)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    edit->position = prefix;
+    edit->deleted = old_len - prefix - suffix;
+    edit->inserted_len = new_len - prefix - suffix;
+    edit->inserted = strndup(new_query + prefix, edit->inserted_len);
+    *num_edits = 1;
+    return edit;
+}
+
+// Free an edit list
+void free_query_edits(QueryEdit* edits, int num_edits) {
+    if (!edits) return;
+    for (int i = 0; i < num_edits; i++) {
+        free(edits[i].inserted);
+    }
+    free(edits);
+}
+
+static void write_delta(FILE* delta, int edit_id, char change, const DiagonalSegment* run) {
+    fprintf(delta, "%d\t%c\t%d\t%d\t%d\n", edit_id, change,
+            run->ref_start - run->diagonal, run->ref_start, run->length);
+}
+
+// Apply one edit to the state and write the runs it removed ('-', query coordinates
+// before the edit) and added ('+', coordinates after it) to delta.
+//
+// Only runs that touch the edited bases can change: a run ending right before the edit
+// may now extend into it and one starting right after it may extend back, so the window
+// is the edit plus one base on each side. Runs further right keep their bases and only
+// move to another diagonal by the length change. New runs through the window are found
+// from the saved reference k-mer index: a run of at least DIAGONAL_MIN_RUN bases that reaches
+// the window contains a k-mer starting within k - 1 bases of it, so only those query
+// k-mers are looked up, and each hit is extended to a maximal run in both directions.
+// As in the diagonal scan, only A/C/G/T match, so a run never extends over an N.
+// Returns the number of delta records, -1 if the edit does not fit the query.
+int apply_query_edit(IncrementalState* state, const char* reference, const QueryEdit* edit, int edit_id,
+                     FILE* delta) {
+    const KmerIndex* ref_index = state->ref_index;
+    int start = edit->position;
+    int old_end = start + edit->deleted;
+    if (start < 0 || edit->deleted < 0 || old_end > state->query_len) {
+        fprintf(stderr, "Edit %d (position %d, %d deleted) is outside the query of %d bases\n",
+                edit_id, edit->position, edit->deleted, state->query_len);
+        return -1;
+    }
+    int new_end = start + edit->inserted_len;
+    int shift = edit->inserted_len - edit->deleted;
+    int ref_len = state->ref_len;
+    
+    // Splice the edit into a new query buffer
+    int query_len = state->query_len + shift;
+    char* query = (char*)malloc(query_len + 1);
+    if (UNLIKELY(!query)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(query, state->query, start);
+    memcpy(query + start, edit->inserted, edit->inserted_len);
+    memcpy(query + new_end, state->query + old_end, state->query_len - old_end);
+    query[query_len] = '\0';
+    
+    // Drop runs that touch the edit and move the ones after it
+    RunList removed = {NULL, 0, 0};
+    int kept = 0;
+    for (int i = 0; i < state->num_runs; i++) {
+        DiagonalSegment run = state->runs[i];
+        int query_start = run.ref_start - run.diagonal;
+        int query_stop = query_start + run.length;
+        if (query_stop >= start && query_start <= old_end) {
+            push_run(&removed, run.diagonal, run.ref_start, run.length);
+            continue;
+        }
+        if (query_start > old_end) {
+            run.diagonal -= shift;
+        }
+        state->runs[kept++] = run;
+    }
+    state->num_runs = kept;
+    
+    // Cells [window_start, window_stop) of the new query touch the edit
+    int window_start = start > 0 ? start - 1 : 0;
+    int window_stop = new_end + 1 < query_len ? new_end + 1 : query_len;
+    int k = ref_index->k;
+    int probe_start = window_start - k + 1 > 0 ? window_start - k + 1 : 0;
+    int probe_stop = window_stop - 1 < query_len - k ? window_stop - 1 : query_len - k;
+    
+    RunList added = {NULL, 0, 0};
+    for (int p = probe_start; p <= probe_stop; p++) {
+        const int* hits;
+        int num_hits = kmer_index_lookup(ref_index, query + p, &hits);
+        for (int h = 0; h < num_hits; h++) {
+            int r = hits[h];
+    
+            // The k-mer one base to the left hit the same diagonal, so this run is already done
+            if (p > probe_start && r > 0 && cells_match(query[p - 1], reference[r - 1])) continue;
+    
+            int left_limit = r < p ? r : p;
+            int right_limit = (ref_len - r < query_len - p ? ref_len - r : query_len - p) - k;
+            int left = match_bases_backward(reference + r, query + p, left_limit);
+            int right = k + match_bases_forward(reference + r + k, query + p + k, right_limit);
+            int query_start = p - left;
+            int length = left + right;
+            if (length >= DIAGONAL_MIN_RUN && query_start < window_stop && query_start + length > window_start) {
+                push_run(&added, r - p, r - left, length);
+            }
+        }
+    }
+    
+    // A run that only touched the edit and survived unchanged is neither removed nor added;
+    // matched added runs are marked with a negative length until they are merged
+    qsort(added.runs, added.count, sizeof(DiagonalSegment), compare_runs);
+    int records = 0;
+    for (int i = 0; i < removed.count; i++) {
+        DiagonalSegment moved = removed.runs[i];
+        if (moved.ref_start - moved.diagonal >= old_end) {
+            moved.diagonal -= shift;
+        }
+        DiagonalSegment* same = (DiagonalSegment*)bsearch(&moved, added.runs, added.count,
+                                                          sizeof(DiagonalSegment), compare_runs);
+        if (same) {
+            same->length = -same->length;
+        } else {
+            if (delta) write_delta(delta, edit_id, '-', &removed.runs[i]);
+            records++;
+        }
+    }
+    for (int i = 0; i < added.count; i++) {
+        if (added.runs[i].length < 0) {
+            added.runs[i].length = -added.runs[i].length;
+        } else {
+            if (delta) write_delta(delta, edit_id, '+', &added.runs[i]);
+            records++;
+        }
+    }
+    
+    // Merge the new runs back into the sorted run list
+    if (state->num_runs + added.count > state->run_capacity) {
+        state->run_capacity = state->num_runs + added.count;
+        DiagonalSegment* new_runs = (DiagonalSegment*)realloc(state->runs,
+                                     state->run_capacity * sizeof(DiagonalSegment));
+        if (UNLIKELY(!new_runs)) {
+            fprintf(stderr, "Memory reallocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        state->runs = new_runs;
+    }
+    memcpy(state->runs + state->num_runs, added.runs, added.count * sizeof(DiagonalSegment));
+    state->num_runs += added.count;
+    qsort(state->runs, state->num_runs, sizeof(DiagonalSegment), compare_runs);
+    
+    free(removed.runs);
+    free(added.runs);
+    free(state->query);
+    state->query = query;
+    state->query_len = query_len;
+    return records;
+}
@@ -0,0 +1,104 @@
+#include "../include/core/dna_index.h"
+
+#define INVALID_KMER 0xFFFFFFFFu
+
+// Smallest k (capped by max_k) whose bucket count reaches the sequence length,
+// which keeps the expected bucket occupancy around one for random sequence
+int choose_kmer_size(int seq_len, int max_k) {
+    if (max_k > KMER_INDEX_MAX_K) max_k = KMER_INDEX_MAX_K;
+    int k = 1;
+    while (k < max_k && ((size_t)1 << (2 * k)) < (size_t)seq_len) {
+        k++;
+    }
+    return k;
+}
+
+// Pack k bases into a 2-bit code, returns 0 if the k-mer contains a non-ACGT base
+int encode_kmer(const char* kmer, int k, unsigned int* code) {
+    unsigned int value = 0;
+    for (int i = 0; i < k; i++) {
+        int base = dna_base_code(kmer[i]);
+        if (UNLIKELY(base < 0)) return 0;
+        value = (value << 2) | (unsigned int)base;
+    }
+    *code = value;
+    return 1;
+}
+
+// Build the k-mer index of a sequence with a counting sort over packed k-mers
+KmerIndex* build_kmer_index(const char* sequence, int seq_len, int k) {
+    if (!sequence || k < 1 || k > KMER_INDEX_MAX_K) {
+        fprintf(stderr, "Invalid parameters for k-mer index (k=%d)\n", k);
+        return NULL;
+    }
+    
+    KmerIndex* index = (KmerIndex*)malloc(sizeof(KmerIndex));
+    if (UNLIKELY(!index)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    size_t num_buckets = (size_t)1 << (2 * k);
+    int num_kmers = seq_len >= k ? seq_len - k + 1 : 0;
+    
+    index->k = k;
+    index->seq_len = seq_len;
+    index->offsets = (unsigned int*)calloc(num_buckets + 1, sizeof(unsigned int));
+    index->positions = (int*)malloc((num_kmers > 0 ? num_kmers : 1) * sizeof(int));
+    unsigned int* codes = (unsigned int*)malloc((num_kmers > 0 ? num_kmers : 1) * sizeof(unsigned int));
+    if (UNLIKELY(!index->offsets || !index->positions || !codes)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    // Encode every k-mer independently so the pass parallelizes cleanly
+    #pragma omp parallel for schedule(static) if (num_kmers > PARALLEL_THRESHOLD)
+    for (int i = 0; i < num_kmers; i++) {
+        unsigned int code;
+        codes[i] = encode_kmer(sequence + i, k, &code) ? code : INVALID_KMER;
+    }
+    
+    // Count bucket sizes, shifted by one so the prefix sum yields bucket starts
+    for (int i = 0; i < num_kmers; i++) {
+        if (codes[i] != INVALID_KMER) {
+            index->offsets[codes[i] + 1]++;
+        }
+    }
+    for (size_t b = 0; b < num_buckets; b++) {
+        index->offsets[b + 1] += index->offsets[b];
+    }
+    
+    // Scatter in sequence order so every bucket ends up sorted by position;
+    // offsets[b] is used as the write cursor and ends at the start of bucket b + 1
+    for (int i = 0; i < num_kmers; i++) {
+        if (codes[i] != INVALID_KMER) {
+            index->positions[index->offsets[codes[i]]++] = i;
+        }
+    }
+    memmove(index->offsets + 1, index->offsets, num_buckets * sizeof(unsigned int));
+    index->offsets[0] = 0;
+    
+    free(codes);
+    return index;
+}
+
+// Return the number of occurrences of a k-mer and point positions at them
+int kmer_index_lookup(const KmerIndex* index, const char* kmer, const int** positions) {
+    unsigned int code;
+    if (!encode_kmer(kmer, index->k, &code)) {
+        *positions = NULL;
+        return 0;
+    }
+    
+    *positions = index->positions + index->offsets[code];
+    return (int)(index->offsets[code + 1] - index->offsets[code]);
+}
+
+// Free memory used by the k-mer index
+void free_kmer_index(KmerIndex* index) {
+    if (!index) return;
+    
+    free(index->offsets);
+    free(index->positions);
+    free(index);
+}
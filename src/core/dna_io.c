@@ -31,41 +31,53 @@ char* read_sequence_from_file(const char* filename, int* length) {
     raw_buffer[file_size] = '\0';
     close(fd);
     
-    // Pre-allocate output buffer based on file size estimate
-    // Typically DNA files are mostly valid characters, so allocate at 90% of file size
-    size_t estimated_seq_length = file_size * 0.9;
-    char* sequence = allocate_dna_sequence(estimated_seq_length);
+    // Keep only A/C/G/T, in file order. Each thread counts the bases in its block of the
+    // file, the counts give every block its offset in the output, and each thread then
+    // copies its bases there, so the result never depends on the thread count.
+    char* sequence = allocate_dna_sequence(file_size);
+    int max_threads = omp_get_max_threads();
+    long* block_starts = (long*)calloc(max_threads + 1, sizeof(long));
+    if (UNLIKELY(!block_starts)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
     
-    // Process the sequence with optimized filtering
-    int seq_length = 0;
+    long seq_length = 0;
     #pragma omp parallel if (file_size > 1024*1024) // Only parallelize for large files
     {
-        #pragma omp for reduction(+:seq_length) schedule(static)
-        for (long i = 0; i < file_size; i++) {
-            char c = toupper(raw_buffer[i]);
-            // Use branchless approach for character filtering
-            int is_valid = (c == 'A' || c == 'T' || c == 'G' || c == 'C');
-            if (is_valid) {
-                // Each thread computes its local index
-                int local_idx = seq_length++;
-                if ((size_t)local_idx < estimated_seq_length) {
-                    sequence[local_idx] = c;
-                }
+        int t = omp_get_thread_num();
+        int threads = omp_get_num_threads();
+        long begin = (long)((long long)file_size * t / threads);
+        long end = (long)((long long)file_size * (t + 1) / threads);
+    
+        long count = 0;
+        for (long i = begin; i < end; i++) {
+            count += dna_base_code(toupper(raw_buffer[i])) >= 0;
+        }
+        block_starts[t + 1] = count;
+    
+        #pragma omp barrier
+        #pragma omp single
+        {
+            for (int b = 0; b < threads; b++) {
+                block_starts[b + 1] += block_starts[b];
             }
+            seq_length = block_starts[threads];
         }
-    }
     
-    // Ensure proper null termination
-    if ((size_t)seq_length < estimated_seq_length) {
-        sequence[seq_length] = '\0';
-    } else {
-        // Unlikely case: resize if our estimate was too small
-        sequence = realloc(sequence, seq_length + 1);
-        sequence[seq_length] = '\0';
+        long out = block_starts[t];
+        for (long i = begin; i < end; i++) {
+            char c = toupper(raw_buffer[i]);
+            if (dna_base_code(c) >= 0) {
+                sequence[out++] = c;
+            }
+        }
     }
+    sequence[seq_length] = '\0';
+    free(block_starts);
     
     // Set the output length and free the raw buffer
-    *length = seq_length;
+    *length = (int)seq_length;
     free(raw_buffer);
     
     return sequence;
@@ -102,7 +114,7 @@ void save_results(RepeatPattern* repeats, int count, int total_repeats) {
     // Save detailed results
     FILE* detail_file = fopen("repeat_details.txt", "w");
     if (detail_file) {
-        fprintf(detail_file, "Position,Length,RepeatCount,ReverseComplement,OriginalSequence,RepeatInstances\n");
+        fprintf(detail_file, "Position,Length,RepeatCount,ReverseComplement,OriginalSequence,InstanceOffsets\n");
         
         if (repeats) {
             for (int i = 0; i < count; i++) {
@@ -113,10 +125,10 @@ void save_results(RepeatPattern* repeats, int count, int total_repeats) {
                        repeats[i].is_reverse ? "Yes" : "No",
                        repeats[i].orig_seq);
                 
-                // Add repeat examples
+                // Add query offsets of the repeat instances
                 if (repeats[i].num_examples > 0) {
                     for (int j = 0; j < repeats[i].num_examples; j++) {
-                        fprintf(detail_file, "%s", repeats[i].repeat_examples[j]);
+                        fprintf(detail_file, "%d", repeats[i].example_positions[j]);
                         if (j < repeats[i].num_examples - 1) {
                             fprintf(detail_file, ";");
                         }
@@ -0,0 +1,388 @@
+#include "../include/core/dna_matrix.h"
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// 64-bit words in one cache line, the row stride granularity
+#define WORDS_PER_LINE (CACHE_LINE_SIZE / (int)sizeof(uint64_t))
+
+// Create a rows x cols int matrix in a single allocation. Contents are left untouched so
+// the first writer of each row decides which NUMA node and cache it lands in; large
+// matrices are mapped with a huge-page hint to cut TLB misses on column walks.
+IntMatrix* create_int_matrix(int rows, int cols, int allow_huge_pages) {
+    IntMatrix* matrix = (IntMatrix*)malloc(sizeof(IntMatrix));
+    if (UNLIKELY(!matrix)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    int ints_per_line = CACHE_LINE_SIZE / (int)sizeof(int);
+    matrix->rows = rows;
+    matrix->cols = cols;
+    matrix->stride = (cols + ints_per_line - 1) / ints_per_line * ints_per_line;
+    if (matrix->stride == 0) matrix->stride = ints_per_line;
+    matrix->bytes = (size_t)(rows > 0 ? rows : 1) * matrix->stride * sizeof(int);
+    matrix->huge_pages = 0;
+    matrix->data = NULL;
+    
+    #if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (allow_huge_pages && matrix->bytes >= MATRIX_HUGE_PAGE_BYTES) {
+        void* region = mmap(NULL, matrix->bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region != MAP_FAILED) {
+            madvise(region, matrix->bytes, MADV_HUGEPAGE);
+            matrix->data = (int*)region;
+            matrix->huge_pages = 1;
+        }
+    }
+    #else
+    (void)allow_huge_pages;
+    #endif
+    
+    if (!matrix->data) {
+        matrix->data = (int*)aligned_alloc_cache(matrix->bytes);
+        if (UNLIKELY(!matrix->data)) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    return matrix;
+}
+
+// Free an int matrix, unmapping it if it was huge-page backed
+void free_int_matrix(IntMatrix* matrix) {
+    if (!matrix) return;
+    #ifdef __linux__
+    if (matrix->huge_pages) {
+        munmap(matrix->data, matrix->bytes);
+        free(matrix);
+        return;
+    }
+    #endif
+    free(matrix->data);
+    free(matrix);
+}
+
+// Fill one row: bit j is set where query[j] equals the reference base
+static void build_bit_row(uint64_t* row, char base, const char* query, int query_len, int words_per_row) {
+    int j = 0;
+    
+    #ifdef __AVX2__
+    // Two 32-byte compares give one 64-cell word
+    __m256i ref_char = _mm256_set1_epi8(base);
+    for (; j + 64 <= query_len; j += 64) {
+        __m256i lo = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)&query[j]), ref_char);
+        __m256i hi = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)&query[j + 32]), ref_char);
+        row[j >> 6] = (uint64_t)(uint32_t)_mm256_movemask_epi8(lo) |
+                      ((uint64_t)(uint32_t)_mm256_movemask_epi8(hi) << 32);
+    }
+    #endif
+    
+    // Remaining cells of the last partial word, then zero padding
+    for (; j < query_len; j += 64) {
+        uint64_t word = 0;
+        int end = query_len - j < 64 ? query_len - j : 64;
+        for (int k = 0; k < end; k++) {
+            word |= (uint64_t)(query[j + k] == base) << k;
+        }
+        row[j >> 6] = word;
+    }
+    for (int w = (query_len + 63) >> 6; w < words_per_row; w++) {
+        row[w] = 0;
+    }
+}
+
+// Build the similarity matrix at one bit per cell. A 50k x 50k comparison takes 300 MB
+// instead of 10 GB, and each row is written straight from the compare masks.
+BitMatrix* build_bit_matrix(const char* reference, int ref_len, const char* query, int query_len) {
+    BitMatrix* matrix = (BitMatrix*)malloc(sizeof(BitMatrix));
+    if (UNLIKELY(!matrix)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    int words = (query_len + 63) >> 6;
+    matrix->rows = ref_len;
+    matrix->cols = query_len;
+    matrix->words_per_row = (words + WORDS_PER_LINE - 1) / WORDS_PER_LINE * WORDS_PER_LINE;
+    if (matrix->words_per_row == 0) matrix->words_per_row = WORDS_PER_LINE;
+    
+    size_t total = (size_t)(ref_len > 0 ? ref_len : 1) * matrix->words_per_row * sizeof(uint64_t);
+    matrix->bits = (uint64_t*)aligned_alloc_cache(total);
+    if (UNLIKELY(!matrix->bits)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    // Each thread writes, and so first touches, the rows it will own in later passes
+    #pragma omp parallel for schedule(static) if (ref_len > PARALLEL_THRESHOLD)
+    for (int i = 0; i < ref_len; i++) {
+        build_bit_row(matrix->bits + (size_t)i * matrix->words_per_row, reference[i], query, query_len,
+                      matrix->words_per_row);
+    }
+    
+    return matrix;
+}
+
+// Free a bit matrix
+void free_bit_matrix(BitMatrix* matrix) {
+    if (!matrix) return;
+    free(matrix->bits);
+    free(matrix);
+}
+
+// Lookup bucket of a tile coordinate
+static inline int tile_bucket(const TiledMatrix* matrix, int tile_row, int tile_col) {
+    unsigned int h = (unsigned int)tile_row * 0x9E3779B1u ^ (unsigned int)tile_col * 0x85EBCA77u;
+    return (int)((h ^ (h >> 15)) & (unsigned int)(matrix->num_buckets - 1));
+}
+
+// Create a tiled view of the similarity matrix. tile_size is rounded up to a multiple of 64
+// (0 picks MATRIX_TILE_DEFAULT); memory stays under max_tiles tiles however large the pair is.
+TiledMatrix* create_tiled_matrix(const char* reference, int ref_len, const char* query, int query_len,
+                                 int tile_size, int max_tiles) {
+    TiledMatrix* matrix = (TiledMatrix*)malloc(sizeof(TiledMatrix));
+    if (UNLIKELY(!matrix)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    if (tile_size <= 0) tile_size = MATRIX_TILE_DEFAULT;
+    matrix->reference = reference;
+    matrix->query = query;
+    matrix->rows = ref_len;
+    matrix->cols = query_len;
+    matrix->tile_size = (tile_size + 63) & ~63;
+    matrix->tile_words = matrix->tile_size >> 6;
+    matrix->tiles_down = (ref_len + matrix->tile_size - 1) / matrix->tile_size;
+    matrix->tiles_across = (query_len + matrix->tile_size - 1) / matrix->tile_size;
+    matrix->max_tiles = max_tiles > 0 ? max_tiles : 1;
+    matrix->num_used = 0;
+    matrix->lru_head = -1;
+    matrix->lru_tail = -1;
+    matrix->hits = 0;
+    matrix->misses = 0;
+    
+    matrix->num_buckets = 1;
+    while (matrix->num_buckets < 2 * matrix->max_tiles) matrix->num_buckets <<= 1;
+    
+    // Tile storage is allocated as slots come into use, so small inputs do not pay the budget
+    matrix->slots = (MatrixTile*)calloc(matrix->max_tiles, sizeof(MatrixTile));
+    matrix->buckets = (int*)malloc(matrix->num_buckets * sizeof(int));
+    if (UNLIKELY(!matrix->slots || !matrix->buckets)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int b = 0; b < matrix->num_buckets; b++) {
+        matrix->buckets[b] = -1;
+    }
+    
+    return matrix;
+}
+
+// Free a tiled matrix and every cached tile (the sequences are not owned)
+void free_tiled_matrix(TiledMatrix* matrix) {
+    if (!matrix) return;
+    for (int s = 0; s < matrix->num_used; s++) {
+        free(matrix->slots[s].bits);
+    }
+    free(matrix->slots);
+    free(matrix->buckets);
+    free(matrix);
+}
+
+static void lru_unlink(TiledMatrix* matrix, int slot) {
+    MatrixTile* tile = &matrix->slots[slot];
+    if (tile->lru_prev >= 0) matrix->slots[tile->lru_prev].lru_next = tile->lru_next;
+    else matrix->lru_head = tile->lru_next;
+    if (tile->lru_next >= 0) matrix->slots[tile->lru_next].lru_prev = tile->lru_prev;
+    else matrix->lru_tail = tile->lru_prev;
+}
+
+static void lru_push_front(TiledMatrix* matrix, int slot) {
+    MatrixTile* tile = &matrix->slots[slot];
+    tile->lru_prev = -1;
+    tile->lru_next = matrix->lru_head;
+    if (matrix->lru_head >= 0) matrix->slots[matrix->lru_head].lru_prev = slot;
+    matrix->lru_head = slot;
+    if (matrix->lru_tail < 0) matrix->lru_tail = slot;
+}
+
+// Take the least recently used slot out of its lookup chain so it can be refilled
+static void evict_slot(TiledMatrix* matrix, int slot) {
+    MatrixTile* tile = &matrix->slots[slot];
+    int* link = &matrix->buckets[tile_bucket(matrix, tile->tile_row, tile->tile_col)];
+    while (*link != slot) {
+        link = &matrix->slots[*link].hash_next;
+    }
+    *link = tile->hash_next;
+    lru_unlink(matrix, slot);
+}
+
+// Slot holding tile (tile_row, tile_col), computing the tile if it is not cached
+static int fetch_tile_slot(TiledMatrix* matrix, int tile_row, int tile_col) {
+    int bucket = tile_bucket(matrix, tile_row, tile_col);
+    for (int s = matrix->buckets[bucket]; s >= 0; s = matrix->slots[s].hash_next) {
+        if (matrix->slots[s].tile_row == tile_row && matrix->slots[s].tile_col == tile_col) {
+            matrix->hits++;
+            if (matrix->lru_head != s) {
+                lru_unlink(matrix, s);
+                lru_push_front(matrix, s);
+            }
+            return s;
+        }
+    }
+    
+    matrix->misses++;
+    int slot;
+    if (matrix->num_used < matrix->max_tiles) {
+        slot = matrix->num_used++;
+        matrix->slots[slot].bits = (uint64_t*)aligned_alloc_cache((size_t)matrix->tile_size * matrix->tile_words *
+                                                                   sizeof(uint64_t));
+        if (UNLIKELY(!matrix->slots[slot].bits)) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        slot = matrix->lru_tail;
+        evict_slot(matrix, slot);
+    }
+    
+    // Same row kernel as the full matrix, on the tile's slice of the query
+    MatrixTile* tile = &matrix->slots[slot];
+    int first_row = tile_row * matrix->tile_size;
+    int first_col = tile_col * matrix->tile_size;
+    int width = matrix->cols - first_col < matrix->tile_size ? matrix->cols - first_col : matrix->tile_size;
+    for (int r = 0; r < matrix->tile_size; r++) {
+        uint64_t* row = tile->bits + (size_t)r * matrix->tile_words;
+        if (first_row + r < matrix->rows) {
+            build_bit_row(row, matrix->reference[first_row + r], matrix->query + first_col, width,
+                          matrix->tile_words);
+        } else {
+            memset(row, 0, matrix->tile_words * sizeof(uint64_t));
+        }
+    }
+    
+    tile->tile_row = tile_row;
+    tile->tile_col = tile_col;
+    tile->hash_next = matrix->buckets[bucket];
+    matrix->buckets[bucket] = slot;
+    lru_push_front(matrix, slot);
+    return slot;
+}
+
+// Words of one tile, row r of the tile at r * tile_words. The pointer stays valid until
+// max_tiles other tiles have been fetched.
+const uint64_t* tiled_matrix_tile(TiledMatrix* matrix, int tile_row, int tile_col) {
+    return matrix->slots[fetch_tile_slot(matrix, tile_row, tile_col)].bits;
+}
+
+// 1 if reference[i] == query[j], 0 otherwise
+int tiled_matrix_get(TiledMatrix* matrix, int i, int j) {
+    int size = matrix->tile_size;
+    const uint64_t* tile = tiled_matrix_tile(matrix, i / size, j / size);
+    int c = j % size;
+    return (int)((tile[(size_t)(i % size) * matrix->tile_words + (c >> 6)] >> (c & 63)) & 1);
+}
+
+// Iterate the matching columns of row in [first_col, end_col)
+void matrix_row_iterator_init(MatrixRowIterator* it, TiledMatrix* matrix, int row, int first_col, int end_col) {
+    it->matrix = matrix;
+    it->row = row;
+    it->col = first_col > 0 ? first_col : 0;
+    it->end = end_col < matrix->cols ? end_col : matrix->cols;
+    if (row < 0 || row >= matrix->rows) it->end = it->col;
+}
+
+// Next matching column; returns 0 when the row is exhausted. Whole words without a
+// match are skipped, and tile boundaries fall on word boundaries.
+int matrix_row_iterator_next(MatrixRowIterator* it, int* col) {
+    TiledMatrix* matrix = it->matrix;
+    int size = matrix->tile_size;
+    while (it->col < it->end) {
+        const uint64_t* tile = tiled_matrix_tile(matrix, it->row / size, it->col / size);
+        int c = it->col % size;
+        int word_end = (it->col & ~63) + 64;
+        if (word_end > it->end) word_end = it->end;
+    
+        uint64_t word = tile[(size_t)(it->row % size) * matrix->tile_words + (c >> 6)] >> (c & 63);
+        if (word_end - it->col < 64) word &= (1ULL << (word_end - it->col)) - 1;
+        if (word) {
+            *col = it->col + __builtin_ctzll(word);
+            it->col = *col + 1;
+            return 1;
+        }
+        it->col = word_end;
+    }
+    return 0;
+}
+
+// Iterate the cells of a diagonal with reference positions in [first_ref, end_ref)
+void matrix_diagonal_iterator_init(MatrixDiagonalIterator* it, TiledMatrix* matrix, int diagonal,
+                                   int first_ref, int end_ref) {
+    int lo = diagonal > 0 ? diagonal : 0;
+    int hi = matrix->cols + diagonal < matrix->rows ? matrix->cols + diagonal : matrix->rows;
+    it->matrix = matrix;
+    it->diagonal = diagonal;
+    it->i = first_ref > lo ? first_ref : lo;
+    it->end = end_ref < hi ? end_ref : hi;
+    it->slot = -1;
+    it->tile_row = -1;
+    it->tile_col = -1;
+}
+
+// Next cell of the diagonal: *i is the reference position, *match its 0/1 value.
+// Returns 0 at the end. The current tile is re-fetched only when the walk leaves it
+// or another fetch has recycled its slot.
+int matrix_diagonal_iterator_next(MatrixDiagonalIterator* it, int* i, int* match) {
+    if (it->i >= it->end) return 0;
+    
+    TiledMatrix* matrix = it->matrix;
+    int size = matrix->tile_size;
+    int j = it->i - it->diagonal;
+    int tile_row = it->i / size, tile_col = j / size;
+    if (tile_row != it->tile_row || tile_col != it->tile_col || it->slot < 0 ||
+        matrix->slots[it->slot].tile_row != tile_row || matrix->slots[it->slot].tile_col != tile_col) {
+        it->slot = fetch_tile_slot(matrix, tile_row, tile_col);
+        it->tile_row = tile_row;
+        it->tile_col = tile_col;
+    }
+    
+    const uint64_t* tile = matrix->slots[it->slot].bits;
+    int c = j % size;
+    *i = it->i;
+    *match = (int)((tile[(size_t)(it->i % size) * matrix->tile_words + (c >> 6)] >> (c & 63)) & 1);
+    it->i++;
+    return 1;
+}
+
+// Iterate the tiles covering cells [first_row, end_row) x [first_col, end_col)
+void matrix_tile_iterator_init(MatrixTileIterator* it, TiledMatrix* matrix, int first_row, int first_col,
+                               int end_row, int end_col) {
+    int size = matrix->tile_size;
+    if (first_row < 0) first_row = 0;
+    if (first_col < 0) first_col = 0;
+    if (end_row > matrix->rows) end_row = matrix->rows;
+    if (end_col > matrix->cols) end_col = matrix->cols;
+    
+    it->matrix = matrix;
+    it->tile_row = first_row / size;
+    it->tile_col = first_col / size;
+    it->first_col = it->tile_col;
+    it->last_row = end_row > first_row ? (end_row - 1) / size : -1;
+    it->last_col = end_col > first_col ? (end_col - 1) / size : -1;
+    if (it->last_col < 0) it->last_row = -1;
+}
+
+// Next tile and its coordinates, NULL once the rectangle is covered
+const uint64_t* matrix_tile_iterator_next(MatrixTileIterator* it, int* tile_row, int* tile_col) {
+    if (it->tile_row > it->last_row) return NULL;
+    
+    *tile_row = it->tile_row;
+    *tile_col = it->tile_col;
+    if (++it->tile_col > it->last_col) {
+        it->tile_col = it->first_col;
+        it->tile_row++;
+    }
+    return tiled_matrix_tile(it->matrix, *tile_row, *tile_col);
+}
@@ -0,0 +1,436 @@
+#include "../include/core/dna_mem.h"
+#include "../include/core/dna_index.h"
+#include "../include/core/dna_topk.h"
+
+// Records collected by a thread before they are flushed to the shared stream
+#define MEM_FLUSH_THRESHOLD 4096
+
+// Rank of a character for the initial suffix sort (A < C < G < T, others in between as in ASCII)
+static inline int char_rank(char c) {
+    return (unsigned char)c + 1;
+}
+
+// Stable counting sort of suffix ids by key(id), keys in [0, num_keys)
+static void counting_sort(const int* in, int* out, const int* key, int n, int num_keys, int* counts) {
+    memset(counts, 0, (num_keys + 1) * sizeof(int));
+    for (int i = 0; i < n; i++) counts[key[in[i]] + 1]++;
+    for (int k = 0; k < num_keys; k++) counts[k + 1] += counts[k];
+    for (int i = 0; i < n; i++) out[counts[key[in[i]]]++] = in[i];
+}
+
+// Prefix-doubling suffix array construction: each round sorts by (rank[i], rank[i + h])
+// with two stable counting sorts, O(n log n) overall
+static int* build_suffix_array(const char* text, int n) {
+    int num_keys = (n > 257 ? n : 257) + 1;
+    int* sa = (int*)malloc(n * sizeof(int));
+    int* tmp = (int*)malloc(n * sizeof(int));
+    int* rank = (int*)malloc(n * sizeof(int));
+    int* second = (int*)malloc(n * sizeof(int));
+    int* new_rank = (int*)malloc(n * sizeof(int));
+    int* counts = (int*)malloc((num_keys + 1) * sizeof(int));
+    if (UNLIKELY(!sa || !tmp || !rank || !second || !new_rank || !counts)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    for (int i = 0; i < n; i++) {
+        sa[i] = i;
+        rank[i] = char_rank(text[i]);
+    }
+    
+    for (int h = 1; ; h <<= 1) {
+        // Suffixes shorter than h sort before every longer suffix with the same prefix
+        #pragma omp parallel for schedule(static) if (n > PARALLEL_THRESHOLD)
+        for (int i = 0; i < n; i++) {
+            second[i] = i + h < n ? rank[i + h] : 0;
+        }
+        
+        counting_sort(sa, tmp, second, n, num_keys, counts);
+        counting_sort(tmp, sa, rank, n, num_keys, counts);
+        
+        new_rank[sa[0]] = 1;
+        for (int i = 1; i < n; i++) {
+            int a = sa[i - 1], b = sa[i];
+            new_rank[b] = new_rank[a] + (rank[a] != rank[b] || second[a] != second[b]);
+        }
+        int* swap = rank; rank = new_rank; new_rank = swap;
+        
+        if (rank[sa[n - 1]] == n || h >= n) break;
+    }
+    
+    free(tmp);
+    free(rank);
+    free(second);
+    free(new_rank);
+    free(counts);
+    return sa;
+}
+
+// Build the suffix array of the reference and the bucket table over its first bases
+SuffixIndex* build_suffix_index(const char* reference, int ref_len) {
+    if (!reference || ref_len <= 0) {
+        fprintf(stderr, "Invalid parameters for suffix index\n");
+        return NULL;
+    }
+    
+    SuffixIndex* index = (SuffixIndex*)malloc(sizeof(SuffixIndex));
+    if (UNLIKELY(!index)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    double start = omp_get_wtime();
+    index->text = reference;
+    index->length = ref_len;
+    index->sa = build_suffix_array(reference, ref_len);
+    index->bucket_k = MEM_BUCKET_K;
+    
+    // Suffixes sharing a k-base prefix are contiguous in the suffix array
+    size_t num_buckets = (size_t)1 << (2 * index->bucket_k);
+    index->bucket_start = (int*)malloc(num_buckets * sizeof(int));
+    index->bucket_end = (int*)malloc(num_buckets * sizeof(int));
+    if (UNLIKELY(!index->bucket_start || !index->bucket_end)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t b = 0; b < num_buckets; b++) {
+        index->bucket_start[b] = 0;
+        index->bucket_end[b] = 0;
+    }
+    for (int i = 0; i < ref_len; i++) {
+        int pos = index->sa[i];
+        unsigned int code;
+        if (pos + index->bucket_k <= ref_len && encode_kmer(reference + pos, index->bucket_k, &code)) {
+            if (index->bucket_end[code] == 0) index->bucket_start[code] = i;
+            index->bucket_end[code] = i + 1;
+        }
+    }
+    
+    printf("Suffix index built for %d bases in %.3f s\n", ref_len, omp_get_wtime() - start);
+    return index;
+}
+
+// Free a suffix index (the indexed text is not owned)
+void free_suffix_index(SuffixIndex* index) {
+    if (!index) return;
+    free(index->sa);
+    free(index->bucket_start);
+    free(index->bucket_end);
+    free(index);
+}
+
+// Compare pattern[0, len) with the suffix at pos, a suffix that ends early sorts first
+static inline int compare_suffix(const SuffixIndex* index, int pos, const char* pattern, int len) {
+    int avail = index->length - pos;
+    int n = avail < len ? avail : len;
+    int c = memcmp(index->text + pos, pattern, n);
+    if (c != 0) return c;
+    return avail < len ? -1 : 0;
+}
+
+// SA interval [*lo, *hi) of suffixes starting with pattern[0, len), len >= bucket_k
+static void find_interval(const SuffixIndex* index, const char* pattern, int len, int* lo, int* hi) {
+    unsigned int code;
+    *lo = *hi = 0;
+    if (!encode_kmer(pattern, index->bucket_k, &code)) return;
+    
+    int left = index->bucket_start[code];
+    int right = index->bucket_end[code];
+    
+    // Lower bound
+    int a = left, b = right;
+    while (a < b) {
+        int mid = a + (b - a) / 2;
+        if (compare_suffix(index, index->sa[mid], pattern, len) < 0) a = mid + 1;
+        else b = mid;
+    }
+    *lo = a;
+    
+    // Upper bound
+    b = right;
+    while (a < b) {
+        int mid = a + (b - a) / 2;
+        if (compare_suffix(index, index->sa[mid], pattern, len) <= 0) a = mid + 1;
+        else b = mid;
+    }
+    *hi = a;
+}
+
+typedef struct {
+    MemRecord* records;
+    int count;
+    int capacity;
+} MemBuffer;
+
+static void push_mem(MemBuffer* buffer, int query_pos, int ref_pos, int length, int strand) {
+    if (buffer->count >= buffer->capacity) {
+        buffer->capacity *= 2;
+        MemRecord* new_records = (MemRecord*)realloc(buffer->records, buffer->capacity * sizeof(MemRecord));
+        if (UNLIKELY(!new_records)) {
+            fprintf(stderr, "Memory reallocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        buffer->records = new_records;
+    }
+    MemRecord* record = &buffer->records[buffer->count++];
+    record->query_pos = query_pos;
+    record->ref_pos = ref_pos;
+    record->length = length;
+    record->strand = strand;
+}
+
+static void write_mems(FILE* stream, const MemRecord* records, int count) {
+    for (int i = 0; i < count; i++) {
+        fprintf(stream, "%d\t%d\t%d\t%c\n", records[i].query_pos, records[i].ref_pos, 
+                records[i].length, records[i].strand ? '-' : '+');
+    }
+}
+
+// Keep MEMs whose query interval is not inside another MEM's interval on the same strand
+static int keep_supermaximal(MemRecord* records, int count) {
+    int kept = 0;
+    for (int strand = 0; strand < 2; strand++) {
+        // Records are sorted by strand, query start, then longest first
+        int best_end = -1;
+        for (int i = 0; i < count; i++) {
+            if (records[i].strand != strand) continue;
+            int end = records[i].query_pos + records[i].length;
+            if (end > best_end) {
+                records[kept++] = records[i];
+                best_end = end;
+            } else if (end == best_end && kept > 0 && 
+                       records[kept - 1].strand == strand &&
+                       records[kept - 1].query_pos == records[i].query_pos) {
+                // Same interval matched at another reference position
+                records[kept++] = records[i];
+            }
+        }
+    }
+    return kept;
+}
+
+static int compare_mems(const void* a, const void* b) {
+    const MemRecord* x = (const MemRecord*)a;
+    const MemRecord* y = (const MemRecord*)b;
+    if (x->strand != y->strand) return x->strand - y->strand;
+    if (x->query_pos != y->query_pos) return x->query_pos < y->query_pos ? -1 : 1;
+    if (x->length != y->length) return x->length > y->length ? -1 : 1;
+    return (x->ref_pos > y->ref_pos) - (x->ref_pos < y->ref_pos);
+}
+
+// Enumerate every maximal exact match of at least min_length bases between the query and
+// the indexed reference on both strands. A MEM is reported once, from its left end:
+// for every query position the SA interval of its first min_length bases is searched and
+// only left-maximal hits are extended to the right. The reverse strand is the same scan
+// over the reverse complemented query. Query chunks run in parallel; records are written
+// to stream as each thread's buffer fills unless smem_only needs the whole set first.
+// Only A/C/G/T match, as in the diagonal engine: an N ends a match like any mismatch.
+MemRecord* find_mems(const SuffixIndex* index, const char* query, int query_len, int min_length,
+                     int smem_only, FILE* stream, int* num_mems) {
+    *num_mems = 0;
+    if (!index || !query || min_length < index->bucket_k || query_len < min_length) {
+        return NULL;
+    }
+    
+    char* query_rc = get_reverse_complement(query, query_len);
+    const char* reference = index->text;
+    int ref_len = index->length;
+    
+    // Searching the indexed sequence itself: every match appears once from each copy,
+    // so keep forward hits right of the query copy and reverse hits not right of it
+    int self = finder_options.self_mode && reference == query && ref_len == query_len;
+    
+    // invalid_before[i] counts the non-ACGT bases of query[0, i): a seed window holding
+    // one is skipped, since N matches nothing
+    int* invalid_before = (int*)malloc((query_len + 1) * sizeof(int));
+    if (UNLIKELY(!invalid_before)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    invalid_before[0] = 0;
+    for (int i = 0; i < query_len; i++) {
+        invalid_before[i + 1] = invalid_before[i] + (dna_base_code(query[i]) < 0);
+    }
+    
+    int capacity = 1000;
+    MemRecord* mems = (MemRecord*)malloc(capacity * sizeof(MemRecord));
+    if (UNLIKELY(!mems)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    int mem_count = 0;
+    
+    omp_lock_t mem_lock;
+    omp_init_lock(&mem_lock);
+    
+    int positions_checked = 0;
+    double scan_start = omp_get_wtime();
+    int num_positions = query_len - min_length + 1;
+    
+    #pragma omp parallel reduction(+:positions_checked)
+    {
+        MemBuffer local = {NULL, 0, 256};
+        local.records = (MemRecord*)malloc(local.capacity * sizeof(MemRecord));
+        if (UNLIKELY(!local.records)) {
+            fprintf(stderr, "Memory allocation failed in thread %d\n", omp_get_thread_num());
+            exit(EXIT_FAILURE);
+        }
+        int flushed = 0;
+        
+        #pragma omp for schedule(dynamic, 1024)
+        for (int q = 0; q < 2 * num_positions; q++) {
+            int strand = q >= num_positions;
+            int pos = strand ? q - num_positions : q;
+            const char* text = strand ? query_rc : query;
+            positions_checked++;
+            
+            // The reverse complement window [pos, pos + min_length) is this query window
+            int window = strand ? query_len - pos - min_length : pos;
+            if (invalid_before[window + min_length] != invalid_before[window]) continue;
+            
+            int lo, hi;
+            find_interval(index, text + pos, min_length, &lo, &hi);
+            for (int s = lo; s < hi; s++) {
+                int r = index->sa[s];
+                if (self && !strand && r <= pos) continue;
+                
+                // Not left-maximal: the same match is reported from an earlier query position
+                if (pos > 0 && r > 0 && cells_match(text[pos - 1], reference[r - 1])) continue;
+                
+                int limit = query_len - pos - min_length;
+                if (ref_len - r - min_length < limit) limit = ref_len - r - min_length;
+                int length = min_length + match_bases_forward(text + pos + min_length, 
+                                                              reference + r + min_length, limit);
+                
+                // Reverse strand hits are reported in forward query coordinates
+                int query_start = strand ? query_len - pos - length : pos;
+                if (self && strand && r > query_start) continue;
+                push_mem(&local, query_start, r, length, strand);
+            }
+            
+            // Stream the records collected since the last flush
+            if (!smem_only && stream && local.count - flushed >= MEM_FLUSH_THRESHOLD) {
+                omp_set_lock(&mem_lock);
+                write_mems(stream, local.records + flushed, local.count - flushed);
+                omp_unset_lock(&mem_lock);
+                flushed = local.count;
+            }
+        }
+        
+        // Merge thread-local results into global array
+        omp_set_lock(&mem_lock);
+        if (!smem_only && stream) {
+            write_mems(stream, local.records + flushed, local.count - flushed);
+        }
+        if (mem_count + local.count > capacity) {
+            while (mem_count + local.count > capacity) capacity *= 2;
+            MemRecord* new_mems = (MemRecord*)realloc(mems, capacity * sizeof(MemRecord));
+            if (UNLIKELY(!new_mems)) {
+                fprintf(stderr, "Memory reallocation failed during merge\n");
+                omp_unset_lock(&mem_lock);
+                exit(EXIT_FAILURE);
+            }
+            mems = new_mems;
+        }
+        memcpy(mems + mem_count, local.records, local.count * sizeof(MemRecord));
+        mem_count += local.count;
+        omp_unset_lock(&mem_lock);
+        
+        free(local.records);
+    }
+    
+    omp_destroy_lock(&mem_lock);
+    report_scan_throughput("MEM scan", positions_checked, omp_get_wtime() - scan_start);
+    free(query_rc);
+    free(invalid_before);
+    
+    qsort(mems, mem_count, sizeof(MemRecord), compare_mems);
+    if (smem_only) {
+        mem_count = keep_supermaximal(mems, mem_count);
+        if (stream) {
+            write_mems(stream, mems, mem_count);
+        }
+    }
+    
+    *num_mems = mem_count;
+    return mems;
+}
+
+// Enumerate MEMs (or SMEMs with finder_options.smem_only) and convert every record
+// into a RepeatPattern whose single instance is the matching query interval
+RepeatPattern* find_repeats_mem(const char* reference, int ref_len, const char* query, int query_len,
+                                FILE* stream, int* num_repeats) {
+    *num_repeats = 0;
+    int min_length = finder_options.min_mem_length > 0 ? finder_options.min_mem_length 
+                                                        : MEM_DEFAULT_MIN_LENGTH;
+    if (min_length < MEM_BUCKET_K) min_length = MEM_BUCKET_K;
+    
+    printf("Enumerating %s of at least %d bases...\n", 
+           finder_options.smem_only ? "super-maximal exact matches" : "maximal exact matches", min_length);
+    
+    SuffixIndex* index = build_suffix_index(reference, ref_len);
+    if (!index) return NULL;
+    
+    if (stream) {
+        fprintf(stream, "query_pos\tref_pos\tlength\tstrand\n");
+    }
+    
+    int num_mems = 0;
+    MemRecord* mems = find_mems(index, query, query_len, min_length, finder_options.smem_only, 
+                                stream, &num_mems);
+    free_suffix_index(index);
+    
+    printf("Found %d %s\n", num_mems, finder_options.smem_only ? "SMEMs" : "MEMs");
+    if (num_mems == 0) {
+        free(mems);
+        return NULL;
+    }
+    
+    // The MEM file keeps every record; with --top only the best K become patterns. A MEM is
+    // a single match that main neither counts nor filters, and the heap keeps MEMs of one
+    // reference segment at different query positions apart, so K candidates are enough.
+    RepeatPattern* repeats;
+    int num_kept = num_mems;
+    if (finder_options.top_k > 0) {
+        TopKHeap* top = create_topk_heap(finder_options.top_k);
+        for (int i = 0; i < num_mems; i++) {
+            RepeatPattern candidate = {0};
+            candidate.position = mems[i].ref_pos;
+            candidate.length = mems[i].length;
+            candidate.count = 1;
+            candidate.is_reverse = mems[i].strand;
+            candidate.query_position = mems[i].query_pos;
+            topk_offer(top, &candidate);
+        }
+        repeats = topk_release(top, &num_kept);
+        printf("Kept the %d longest matches (top %d)\n", num_kept, finder_options.top_k);
+    } else {
+        repeats = allocate_repeat_patterns(num_mems);
+        if (UNLIKELY(!repeats)) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < num_mems; i++) {
+            repeats[i].position = mems[i].ref_pos;
+            repeats[i].length = mems[i].length;
+            repeats[i].count = 1;
+            repeats[i].is_reverse = mems[i].strand;
+            repeats[i].query_position = mems[i].query_pos;
+            repeats[i].orig_seq = NULL;
+        }
+    }
+    free(mems);
+    
+    for (int i = 0; i < num_kept; i++) {
+        repeats[i].example_positions = (int*)malloc(sizeof(int));
+        if (UNLIKELY(!repeats[i].example_positions)) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        repeats[i].example_positions[0] = repeats[i].query_position;
+        repeats[i].num_examples = 1;
+    }
+    
+    *num_repeats = num_kept;
+    return repeats;
+}
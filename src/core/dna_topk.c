@@ -0,0 +1,320 @@
+#include "../include/core/dna_topk.h"
+
+// Free what a repeat owns once it drops out of the selection
+static void release_repeat(RepeatPattern* repeat) {
+    free(repeat->orig_seq);
+    free(repeat->example_positions);
+}
+
+// Best score first; equal scores fall back to reference order so output is stable
+static int compare_by_score(const void* a, const void* b) {
+    const RepeatPattern* x = (const RepeatPattern*)a;
+    const RepeatPattern* y = (const RepeatPattern*)b;
+    long long sx = repeat_score(x), sy = repeat_score(y);
+    if (sx != sy) return sx > sy ? -1 : 1;
+    if (x->position != y->position) return x->position < y->position ? -1 : 1;
+    if (x->length != y->length) return x->length > y->length ? -1 : 1;
+    if (x->is_reverse != y->is_reverse) return x->is_reverse - y->is_reverse;
+    return (x->query_position > y->query_position) - (x->query_position < y->query_position);
+}
+
+// Whether x ranks after y, so the heap keeps y over x
+static inline int ranks_below(const RepeatPattern* x, const RepeatPattern* y) {
+    return compare_by_score(x, y) > 0;
+}
+
+// Identity of a kept repeat: its reference position, query position and strand, so
+// distinct matches of one reference segment (MEMs) are kept apart
+static inline long long repeat_key(const RepeatPattern* repeat) {
+    return (long long)(((unsigned long long)repeat->position << 32) | 
+                       ((unsigned long long)repeat->query_position << 1) | (repeat->is_reverse ? 1 : 0));
+}
+
+static inline int key_home(const TopKHeap* heap, long long key) {
+    return (int)(((unsigned long long)key * 0x9E3779B97F4A7C15ULL) >> 32) & heap->slot_mask;
+}
+
+// Slot holding key, or the empty slot where it would go
+static int find_slot(const TopKHeap* heap, long long key) {
+    int s = key_home(heap, key);
+    while (heap->slots[s] && heap->slot_keys[s] != key) {
+        s = (s + 1) & heap->slot_mask;
+    }
+    return s;
+}
+
+// Empty a slot and pull later entries of the probe run back so every key stays reachable
+static void remove_slot(TopKHeap* heap, int s) {
+    int mask = heap->slot_mask;
+    for (;;) {
+        heap->slots[s] = 0;
+        int j = s;
+        for (;;) {
+            j = (j + 1) & mask;
+            if (!heap->slots[j]) return;
+            int home = key_home(heap, heap->slot_keys[j]);
+            // Entries whose home lies cyclically in (s, j] are still reachable
+            int reachable = s <= j ? (s < home && home <= j) : (s < home || home <= j);
+            if (!reachable) break;
+        }
+        heap->slots[s] = heap->slots[j];
+        heap->slot_keys[s] = heap->slot_keys[j];
+        s = j;
+    }
+}
+
+// Store item at heap index i and point its slot there
+static inline void place_item(TopKHeap* heap, int i, const RepeatPattern* item) {
+    heap->items[i] = *item;
+    heap->slots[find_slot(heap, repeat_key(item))] = i + 1;
+}
+
+static int sift_up(TopKHeap* heap, int i) {
+    RepeatPattern item = heap->items[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!ranks_below(&item, &heap->items[parent])) break;
+        place_item(heap, i, &heap->items[parent]);
+        i = parent;
+    }
+    place_item(heap, i, &item);
+    return i;
+}
+
+static void sift_down(TopKHeap* heap, int i) {
+    RepeatPattern item = heap->items[i];
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= heap->size) break;
+        if (child + 1 < heap->size && ranks_below(&heap->items[child + 1], &heap->items[child])) {
+            child++;
+        }
+        if (!ranks_below(&heap->items[child], &item)) break;
+        place_item(heap, i, &heap->items[child]);
+        i = child;
+    }
+    place_item(heap, i, &item);
+}
+
+// Create an empty heap that keeps at most k repeats
+TopKHeap* create_topk_heap(int k) {
+    TopKHeap* heap = (TopKHeap*)malloc(sizeof(TopKHeap));
+    if (UNLIKELY(!heap)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    heap->capacity = k > 0 ? k : 1;
+    heap->size = 0;
+    
+    int num_slots = 16;
+    while (num_slots < 2 * heap->capacity) num_slots *= 2;
+    heap->slot_mask = num_slots - 1;
+    
+    heap->items = allocate_repeat_patterns(heap->capacity);
+    heap->slots = (int*)calloc(num_slots, sizeof(int));
+    heap->slot_keys = (long long*)malloc(num_slots * sizeof(long long));
+    if (UNLIKELY(!heap->items || !heap->slots || !heap->slot_keys)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    return heap;
+}
+
+// Free a heap together with the repeats it still holds
+void free_topk_heap(TopKHeap* heap) {
+    if (!heap) return;
+    for (int i = 0; i < heap->size; i++) {
+        release_repeat(&heap->items[i]);
+    }
+    free(heap->items);
+    free(heap->slots);
+    free(heap->slot_keys);
+    free(heap);
+}
+
+// Keep a repeat if it ranks above the weakest kept one, evicting that one. A repeat
+// already kept is not taken twice. Returns 1 if the heap took ownership of the repeat's
+// buffers, 0 if it was rejected and the caller still owns them.
+int topk_offer(TopKHeap* heap, const RepeatPattern* repeat) {
+    int full = heap->size == heap->capacity;
+    if (full && !ranks_below(&heap->items[0], repeat)) {
+        return 0;
+    }
+    
+    long long key = repeat_key(repeat);
+    int slot = find_slot(heap, key);
+    if (heap->slots[slot]) {
+        return 0;
+    }
+    
+    if (!full) {
+        int i = heap->size++;
+        heap->slots[slot] = i + 1;
+        heap->slot_keys[slot] = key;
+        heap->items[i] = *repeat;
+        sift_up(heap, i);
+    } else {
+        // Removing the root's slot can move other slots, the new key's included
+        remove_slot(heap, find_slot(heap, repeat_key(&heap->items[0])));
+        release_repeat(&heap->items[0]);
+        slot = find_slot(heap, key);
+        heap->slots[slot] = 1;
+        heap->slot_keys[slot] = key;
+        heap->items[0] = *repeat;
+        sift_down(heap, 0);
+    }
+    return 1;
+}
+
+// Score a candidate has to reach to be kept (ties go by reference order): the weakest
+// kept score once the heap is full, raised to the floor other threads have published.
+// -1 while anything is accepted.
+long long topk_threshold(const TopKHeap* heap, const long long* shared_floor) {
+    long long threshold = heap->size == heap->capacity ? repeat_score(&heap->items[0]) : -1;
+    if (shared_floor) {
+        long long shared = __atomic_load_n(shared_floor, __ATOMIC_RELAXED);
+        if (shared > threshold) threshold = shared;
+    }
+    return threshold;
+}
+
+// Raise the shared floor to this heap's weakest score. Any full heap proves that k
+// repeats score at least that much, so every thread may prune against the maximum.
+void topk_publish_floor(const TopKHeap* heap, long long* shared_floor) {
+    if (heap->size < heap->capacity) return;
+    long long floor = repeat_score(&heap->items[0]);
+    long long current = __atomic_load_n(shared_floor, __ATOMIC_RELAXED);
+    while (floor > current &&
+           !__atomic_compare_exchange_n(shared_floor, &current, floor, 0,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Move every repeat of from into into and free from
+void topk_merge(TopKHeap* into, TopKHeap* from) {
+    for (int i = 0; i < from->size; i++) {
+        if (!topk_offer(into, &from->items[i])) {
+            release_repeat(&from->items[i]);
+        }
+    }
+    free(from->items);
+    free(from->slots);
+    free(from->slot_keys);
+    free(from);
+}
+
+// Free the heap and hand back its repeats, best score first (NULL when empty)
+RepeatPattern* topk_release(TopKHeap* heap, int* count) {
+    RepeatPattern* items = heap->items;
+    *count = heap->size;
+    free(heap->slots);
+    free(heap->slot_keys);
+    free(heap);
+    
+    if (*count == 0) {
+        free(items);
+        return NULL;
+    }
+    qsort(items, *count, sizeof(RepeatPattern), compare_by_score);
+    return items;
+}
+
+// Whether the search a scope describes reports the match at (position, target_pos)
+static int scope_reports(const RepeatScope* scope, int ref_len, int position, int target_pos, int length) {
+    if (length < scope->min_length || (scope->max_length > 0 && length > scope->max_length)) return 0;
+    switch (scope->self_rule) {
+        case SELF_TARGET_AFTER:  if (target_pos <= position) return 0; break;
+        case SELF_TARGET_BEFORE: if (target_pos >= position) return 0; break;
+        case SELF_MIRROR:        if (position > scope->target_len - target_pos - length) return 0; break;
+        default: break;
+    }
+    // The first seed at or after position has to lie inside both the match and the seeded range
+    int step = scope->seed_step > 0 ? scope->seed_step : 1;
+    int seed = (position + step - 1) / step * step;
+    return seed <= position + length - scope->seed_length && seed < ref_len - scope->seed_length;
+}
+
+// Highest score any repeat at position can reach: its longest allowed length times the
+// occurrences of its first k-mer in the target
+long long repeat_score_bound(const RepeatScope* scope, const char* reference, int ref_len, int position) {
+    int longest = ref_len - position;
+    if (scope->max_length > 0 && longest > scope->max_length) longest = scope->max_length;
+    if (longest < scope->min_length) return 0;
+    const int* hits;
+    return (long long)longest * kmer_index_lookup(scope->index, reference + position, &hits);
+}
+
+// Fill repeat with what a full search keeps at position on the scope's strand: the longest
+// reported match starting there (the first in target order among equals), counted over every
+// occurrence of its segment in the target. A segment holding a base other than A/C/G/T has
+// no instances and is filtered out later, so it is never the kept one. Returns 0 if the
+// search reports nothing at position.
+int resolve_repeat(const RepeatScope* scope, const char* reference, int ref_len, int position, 
+                   RepeatPattern* repeat) {
+    if (ref_len - position < scope->min_length) return 0;
+    const char* segment = reference + position;
+    const char* target = scope->target;
+    
+    int clean = ref_len - position;
+    if (!scope->bases_only) {
+        if (scope->max_length > 0 && clean > scope->max_length) clean = scope->max_length;
+        for (int i = 0; i < clean; i++) {
+            if (dna_base_code(segment[i]) < 0) {
+                clean = i;
+                break;
+            }
+        }
+    }
+    
+    // Every match of at least min_length bases starts with the segment's first k-mer
+    const int* hits;
+    int num_hits = kmer_index_lookup(scope->index, segment, &hits);
+    int best_length = 0, best_target = -1;
+    for (int h = 0; h < num_hits; h++) {
+        int q = hits[h];
+        int limit = ref_len - position < scope->target_len - q ? ref_len - position : scope->target_len - q;
+        int length = scope->bases_only ? match_bases_forward(segment, target + q, limit) 
+                                       : match_forward(segment, target + q, limit);
+        if (length <= best_length || length > clean) continue;
+        // A match that extends to the left starts at an earlier position
+        if (position > 0 && q > 0 && (scope->bases_only ? cells_match(segment[-1], target[q - 1]) 
+                                                         : segment[-1] == target[q - 1])) {
+            continue;
+        }
+        if (!scope_reports(scope, ref_len, position, q, length)) continue;
+        best_length = length;
+        best_target = q;
+    }
+    if (best_target < 0) return 0;
+    
+    int count = 0;
+    for (int h = 0; h < num_hits; h++) {
+        int q = hits[h];
+        if (q + best_length <= scope->target_len && memcmp(target + q, segment, best_length) == 0) {
+            count++;
+        }
+    }
+    
+    memset(repeat, 0, sizeof(RepeatPattern));
+    repeat->position = position;
+    repeat->length = best_length;
+    repeat->count = count;
+    repeat->is_reverse = scope->is_reverse;
+    repeat->query_position = scope->is_reverse ? scope->target_len - best_target - best_length : best_target;
+    return 1;
+}
+
+// Order a finished result array best score first and drop everything after the first k
+RepeatPattern* select_top_repeats(RepeatPattern* repeats, int num_repeats, int k, int* kept) {
+    *kept = num_repeats;
+    if (!repeats || num_repeats == 0) return repeats;
+    
+    qsort(repeats, num_repeats, sizeof(RepeatPattern), compare_by_score);
+    if (k > 0 && num_repeats > k) {
+        for (int i = k; i < num_repeats; i++) {
+            release_repeat(&repeats[i]);
+        }
+        *kept = k;
+    }
+    return repeats;
+}
@@ -1,28 +1,33 @@
 #include "../include/core/dna_traditional.h"
+#include "../include/core/dna_index.h"
+#include "../include/core/dna_bitmatch.h"
+#include "../include/core/dna_topk.h"
 #include "../include/core/cpu_optimize.h"
 
-// Build similarity matrix between reference and query - optimized with parallel processing and AVX2
-int** build_similarity_matrix(const char* reference, int ref_len, const char* query, int query_len) {
-    int** matrix = (int**)aligned_alloc(CACHE_LINE_SIZE, ref_len * sizeof(int*));
-    if (UNLIKELY(!matrix)) {
-        fprintf(stderr, "Memory allocation failed\n");
-        exit(EXIT_FAILURE);
-    }
+// Number of repeats whose instances are collected in one shared query scan
+#define INSTANCE_BATCH_SIZE 4
+
+#ifdef __AVX2__
+// Turn 8 compare bytes (-1 on match, 0 otherwise) into matrix cells: ~(2 * eq) is 1 or -1
+static inline __m256i match_bytes_to_cells(__m128i bytes) {
+    __m256i eq = _mm256_cvtepi8_epi32(bytes);
+    return _mm256_xor_si256(_mm256_add_epi32(eq, eq), _mm256_set1_epi32(-1));
+}
+#endif
+
+// Build similarity matrix between reference and query - optimized with parallel processing and AVX2.
+// Prefer build_bit_matrix (dna_matrix.h) for large inputs: it stores 1 bit per cell instead of 32.
+IntMatrix* build_similarity_matrix(const char* reference, int ref_len, const char* query, int query_len) {
+    // One allocation for the whole grid; rows are first touched by the thread that fills them
+    IntMatrix* matrix = create_int_matrix(ref_len, query_len, 1);
     
     // Determine optimal thread count for this workload
     int thread_count = get_optimal_thread_count((size_t)ref_len * query_len * sizeof(int));
     omp_set_num_threads(thread_count);
     
-    #pragma omp parallel for schedule(dynamic, 16)
+    #pragma omp parallel for schedule(static)
     for (int i = 0; i < ref_len; i++) {
-        // Cache line aligned allocation for better memory access
-        matrix[i] = (int*)aligned_alloc(CACHE_LINE_SIZE, ((query_len * sizeof(int) + CACHE_LINE_SIZE - 1) 
-                                                         & ~(CACHE_LINE_SIZE - 1)));
-        if (UNLIKELY(!matrix[i])) {
-            fprintf(stderr, "Memory allocation failed in thread %d\n", omp_get_thread_num());
-            // Cannot safely free memory here due to parallel context
-            exit(EXIT_FAILURE);
-        }
+        int* row = int_matrix_row(matrix, i);
         
         // Prefetch next rows to improve cache utilization
         if (i + 2 < ref_len) {
@@ -30,43 +35,30 @@ int** build_similarity_matrix(const char* reference, int ref_len, const char* qu
         }
 
         #ifdef __AVX2__
-        // Process 16 elements at a time using AVX2
-        for (int j = 0; j < query_len - 15; j += 16) {
-            // Load 16 characters from query
-            __m256i q_chars1 = _mm256_loadu_si256((__m256i*)&query[j]);
-            __m256i q_chars2 = _mm256_loadu_si256((__m256i*)&query[j+8]);
-            
-            // Compare with current reference character
-            __m256i ref_char1 = _mm256_set1_epi8(reference[i]);
-            __m256i ref_char2 = _mm256_set1_epi8(reference[i]);
+        // Process 32 elements at a time using AVX2: one compare of 32 query bytes
+        __m256i ref_char = _mm256_set1_epi8(reference[i]);
+        int j = 0;
+        for (; j + 32 <= query_len; j += 32) {
+            __m256i q_chars = _mm256_loadu_si256((const __m256i*)&query[j]);
+            __m256i match = _mm256_cmpeq_epi8(q_chars, ref_char);
             
-            __m256i match1 = _mm256_cmpeq_epi8(q_chars1, ref_char1);
-            __m256i match2 = _mm256_cmpeq_epi8(q_chars2, ref_char2);
-            
-            // Remove unused variables
-            // Convert to int (-1 for mismatch, 1 for match)
-            
-            // Process first 8 matches
-            int mask1 = _mm256_movemask_epi8(match1);
-            for (int k = 0; k < 8; k++) {
-                matrix[i][j+k] = (mask1 & (1 << k)) ? 1 : -1;
-            }
-            
-            // Process next 8 matches
-            int mask2 = _mm256_movemask_epi8(match2);
-            for (int k = 0; k < 8; k++) {
-                matrix[i][j+8+k] = (mask2 & (1 << k)) ? 1 : -1;
-            }
+            // Widen the compare bytes 8 at a time
+            __m128i lo = _mm256_castsi256_si128(match);
+            __m128i hi = _mm256_extracti128_si256(match, 1);
+            _mm256_storeu_si256((__m256i*)&row[j], match_bytes_to_cells(lo));
+            _mm256_storeu_si256((__m256i*)&row[j+8], match_bytes_to_cells(_mm_srli_si128(lo, 8)));
+            _mm256_storeu_si256((__m256i*)&row[j+16], match_bytes_to_cells(hi));
+            _mm256_storeu_si256((__m256i*)&row[j+24], match_bytes_to_cells(_mm_srli_si128(hi, 8)));
         }
         
         // Handle remaining elements
-        for (int j = (query_len & ~15); j < query_len; j++) {
-            matrix[i][j] = (reference[i] == query[j]) ? 1 : -1;
+        for (; j < query_len; j++) {
+            row[j] = (reference[i] == query[j]) ? 1 : -1;
         }
         #else
         // Fallback for non-AVX2 systems
         for (int j = 0; j < query_len; j++) {
-            matrix[i][j] = (reference[i] == query[j]) ? 1 : -1;
+            row[j] = (reference[i] == query[j]) ? 1 : -1;
         }
         #endif
     }
@@ -74,6 +66,67 @@ int** build_similarity_matrix(const char* reference, int ref_len, const char* qu
     return matrix;
 }
 
+// Append a repeat to a thread-local result array, growing it when full
+static void append_repeat(RepeatPattern** local_repeats, int* local_count, int* local_capacity,
+                          const char* segment, int position, int length, int count, int is_reverse,
+                          int query_position) {
+    if (*local_count >= *local_capacity) {
+        *local_capacity *= 2;
+        RepeatPattern* new_local = resize_repeat_patterns(*local_repeats, *local_count, *local_capacity);
+        if (UNLIKELY(!new_local)) {
+            fprintf(stderr, "Memory reallocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        *local_repeats = new_local;
+    }
+    
+    RepeatPattern* repeat = &(*local_repeats)[(*local_count)++];
+    repeat->position = position;
+    repeat->length = length;
+    repeat->count = count;
+    repeat->is_reverse = is_reverse;
+    repeat->query_position = query_position;
+    repeat->orig_seq = strndup(segment, length);
+    repeat->example_positions = NULL;
+    repeat->num_examples = 0;
+}
+
+// Record the repeat a full search keeps at a position and strand; the segment is copied
+// later by get_repeat_sequences
+static void set_kept_repeat(RepeatPattern* kept, int position, int length, int count, int is_reverse, 
+                            int query_position) {
+    kept->position = position;
+    kept->length = length;
+    kept->count = count;
+    kept->is_reverse = is_reverse;
+    kept->query_position = query_position;
+}
+
+// Count copies of pattern placed back to back in the query from current_pos on
+static int count_consecutive_copies(const char* query, int query_len, int current_pos, 
+                                    const char* pattern, int length) {
+    int consecutive_count = 0;
+    while (current_pos + length <= query_len && 
+           memcmp(query + current_pos, pattern, length) == 0) {
+        consecutive_count++;
+        current_pos += length;
+    }
+    return consecutive_count;
+}
+
+// Make sure a thread-local candidate buffer can hold needed entries
+static int* reserve_candidates(int* candidates, int* capacity, int needed) {
+    if (needed <= *capacity) return candidates;
+    
+    while (*capacity < needed) *capacity *= 2;
+    int* new_candidates = (int*)realloc(candidates, *capacity * sizeof(int));
+    if (UNLIKELY(!new_candidates)) {
+        fprintf(stderr, "Memory reallocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    return new_candidates;
+}
+
 // Find repeats in the query sequence compared to reference - optimized for R9 7940HX
 RepeatPattern* find_repeats(const char* reference, int ref_len, const char* query, int query_len, int* num_repeats) {
     // Dynamic parameters based on sequence length with optimized defaults for performance
@@ -84,14 +137,31 @@ RepeatPattern* find_repeats(const char* reference, int ref_len, const char* quer
     printf("Using parameters: min_length=%d, max_length=%d, step=%d\n", 
            min_length, max_length, step);
     
-    // Limit search space for very large sequences
+    // Limit search space for very large sequences unless exact mode asks for full coverage
     int max_positions_to_check = 10000;
     int positions_step = ref_len > max_positions_to_check ? (ref_len / max_positions_to_check) : 1;
+    if (finder_options.exact_mode) {
+        positions_step = 1;
+        printf("Exact mode: checking all %d reference positions\n", ref_len);
+    }
+    
+    // Index the query and its reverse complement once. Every reference segment is
+    // answered from the bucket of its first seed_k bases, so the query is never rescanned.
+    // An occurrence of rev_comp(segment) at query position q is an occurrence of segment
+    // in query_rc at query_len - q - length.
+    int seed_k = choose_kmer_size(query_len, min_length);
+    char* query_rc = get_reverse_complement(query, query_len);
+    KmerIndex* query_index = build_kmer_index(query, query_len, seed_k);
+    KmerIndex* query_rc_index = build_kmer_index(query_rc, query_len, seed_k);
+    if (UNLIKELY(!query_index || !query_rc_index)) {
+        fprintf(stderr, "Failed to build query index\n");
+        exit(EXIT_FAILURE);
+    }
+    printf("Query index built with k=%d\n", seed_k);
     
     // Allocate initial memory for repeats (aligned for better cache performance)
     int capacity = 1000;
-    RepeatPattern* repeats = (RepeatPattern*)aligned_alloc(CACHE_LINE_SIZE, 
-                                            capacity * sizeof(RepeatPattern));
+    RepeatPattern* repeats = allocate_repeat_patterns(capacity);
     if (UNLIKELY(!repeats)) {
         fprintf(stderr, "Memory allocation failed\n");
         exit(EXIT_FAILURE);
@@ -109,17 +179,35 @@ RepeatPattern* find_repeats(const char* reference, int ref_len, const char* quer
     omp_set_num_threads(thread_count);
     printf("Using %d threads for repeat finding\n", thread_count);
 
+    // Top-K mode keeps a bounded heap per thread. filter_nested_repeats keeps the first of
+    // the longest repeats at a position and strand, so only that one is counted and offered.
+    int top_k = finder_options.top_k;
+    TopKHeap* top = top_k > 0 ? create_topk_heap(top_k) : NULL;
+    
     // For thread-safe updates to repeats array
     omp_lock_t repeat_lock;
     omp_init_lock(&repeat_lock);
     
-    #pragma omp parallel
+    int positions_checked = 0;
+    double scan_start = omp_get_wtime();
+    
+    #pragma omp parallel reduction(+:positions_checked)
     {
         // Thread-local repeats for better performance
         int local_capacity = 100;
-        RepeatPattern* local_repeats = (RepeatPattern*)malloc(local_capacity * sizeof(RepeatPattern));
+        RepeatPattern* local_repeats = allocate_repeat_patterns(local_capacity);
         int local_count = 0;
         
+        // Thread-local candidate lists, narrowed in place as the length grows
+        int fwd_capacity = 64, rev_capacity = 64;
+        int* fwd_candidates = (int*)malloc(fwd_capacity * sizeof(int));
+        int* rev_candidates = (int*)malloc(rev_capacity * sizeof(int));
+        if (UNLIKELY(!local_repeats || !fwd_candidates || !rev_candidates)) {
+            fprintf(stderr, "Memory allocation failed in thread %d\n", omp_get_thread_num());
+            exit(EXIT_FAILURE);
+        }
+        TopKHeap* local_top = top ? create_topk_heap(top_k) : NULL;
+        
         #pragma omp for schedule(dynamic, 16) 
         for (int pos = 0; pos < ref_len - min_length; pos += positions_step) {
             // Report progress (only from thread 0)
@@ -132,172 +220,99 @@ RepeatPattern* find_repeats(const char* reference, int ref_len, const char* quer
                 }
             }
             
-            // Check different segment lengths
-            for (int length = min_length; length < (max_length < (ref_len - pos) ? max_length : (ref_len - pos)); length += step) {
-                // Extract segment from reference with cache alignment
-                char* segment = allocate_dna_sequence(length + 1);
-                strncpy(segment, reference + pos, length);
-                segment[length] = '\0';
-                
-                // Pre-compute hash for faster string matching
-                unsigned long segment_hash = 0;
-                for (int i = 0; i < length; i++) {
-                    segment_hash = segment_hash * 31 + segment[i];
+            positions_checked++;
+            const char* segment = reference + pos;
+            RepeatPattern longest[2] = {{0}, {0}};
+            const int* seeds;
+            
+            // Forward candidates in ascending query order
+            int num_fwd = kmer_index_lookup(query_index, segment, &seeds);
+            fwd_candidates = reserve_candidates(fwd_candidates, &fwd_capacity, num_fwd);
+            memcpy(fwd_candidates, seeds, num_fwd * sizeof(int));
+            
+            // Reverse complement candidates, flipped so query positions ascend
+            int num_rev = kmer_index_lookup(query_rc_index, segment, &seeds);
+            rev_candidates = reserve_candidates(rev_candidates, &rev_capacity, num_rev);
+            for (int c = 0; c < num_rev; c++) {
+                rev_candidates[c] = seeds[num_rev - 1 - c];
+            }
+            
+            // Check different segment lengths; candidates only ever shrink, so stop once none are left
+            int verified = seed_k;
+            int length_limit = max_length < (ref_len - pos) ? max_length : (ref_len - pos);
+            for (int length = min_length; length < length_limit && (num_fwd > 0 || num_rev > 0); length += step) {
+                // Keep candidates whose next length - verified bases still match
+                int kept = 0;
+                for (int c = 0; c < num_fwd; c++) {
+                    int q = fwd_candidates[c];
+                    if (q + length <= query_len && 
+                        memcmp(query + q + verified, segment + verified, length - verified) == 0) {
+                        fwd_candidates[kept++] = q;
+                    }
                 }
+                num_fwd = kept;
                 
-                // Check for forward repeats with optimized scanning
-                int start_idx = 0;
-                while (1) {
-                    // Find next occurrence of segment
-                    char* found = strstr(query + start_idx, segment);
-                    if (!found) break;
-                    
-                    int next_idx = found - query;
-                    int current_pos = next_idx + length;
-                    int consecutive_count = 0;
-                    
-                    // Prefetch ahead for better cache performance
-                    PREFETCH_READ(query + current_pos);
-                    
-                    // Check for consecutive repeats using vectorized comparison when available
-                    while (current_pos + length <= query_len) {
-                        int is_repeat;
-                        
-                        #ifdef __AVX2__
-                        if (length >= 32) {
-                            is_repeat = vectorized_dna_compare(query + current_pos, segment, length);
-                        } else {
-                        #endif
-                            is_repeat = 1;
-                            for (int k = 0; k < length; k++) {
-                                if (query[current_pos + k] != segment[k]) {
-                                    is_repeat = 0;
-                                    break;
-                                }
-                            }
-                        #ifdef __AVX2__
-                        }
-                        #endif
-                        
-                        if (is_repeat) {
-                            consecutive_count++;
-                            current_pos += length;
-                            // Prefetch next position for better performance
-                            if (current_pos + length <= query_len)
-                                PREFETCH_READ(query + current_pos);
-                        } else {
-                            break;
-                        }
+                kept = 0;
+                for (int c = 0; c < num_rev; c++) {
+                    int p = rev_candidates[c];
+                    if (p + length <= query_len && 
+                        memcmp(query_rc + p + verified, segment + verified, length - verified) == 0) {
+                        rev_candidates[kept++] = p;
                     }
-                    
-                    if (consecutive_count > 0) {
-                        // Add to local repeats array
-                        if (local_count >= local_capacity) {
-                            local_capacity *= 2;
-                            RepeatPattern* new_local = (RepeatPattern*)realloc(local_repeats, 
-                                                     local_capacity * sizeof(RepeatPattern));
-                            if (UNLIKELY(!new_local)) {
-                                fprintf(stderr, "Memory reallocation failed\n");
-                                free(segment);
-                                free(local_repeats);
-                                exit(EXIT_FAILURE);
-                            }
-                            local_repeats = new_local;
-                        }
-                        
-                        local_repeats[local_count].position = pos;
-                        local_repeats[local_count].length = length;
-                        local_repeats[local_count].count = consecutive_count;
-                        local_repeats[local_count].is_reverse = 0;
-                        local_repeats[local_count].orig_seq = strdup(segment);
-                        local_repeats[local_count].repeat_examples = NULL;
-                        local_repeats[local_count].num_examples = 0;
-                        local_count++;
-                    }
-                    
-                    start_idx = next_idx + 1;
-                    if (start_idx >= query_len) break;
                 }
+                num_rev = kept;
+                verified = length;
                 
-                // Check for reverse complement repeats
-                char* rev_comp = get_reverse_complement(segment, length);
-                start_idx = 0;
-                
-                while (1) {
-                    char* found = strstr(query + start_idx, rev_comp);
-                    if (!found) break;
-                    
-                    int next_idx = found - query;
-                    int current_pos = next_idx + length;
-                    int consecutive_count = 0;
-                    
-                    // Check for consecutive reverse repeats
-                    while (current_pos + length <= query_len) {
-                        int is_repeat;
-                        
-                        #ifdef __AVX2__
-                        if (length >= 32) {
-                            is_repeat = vectorized_dna_compare(query + current_pos, rev_comp, length);
-                        } else {
-                        #endif
-                            is_repeat = 1;
-                            for (int k = 0; k < length; k++) {
-                                if (query[current_pos + k] != rev_comp[k]) {
-                                    is_repeat = 0;
-                                    break;
-                                }
-                            }
-                        #ifdef __AVX2__
-                        }
-                        #endif
-                        
-                        if (is_repeat) {
-                            consecutive_count++;
-                            current_pos += length;
-                        } else {
-                            break;
-                        }
+                // Check for forward repeats following each occurrence; the first one found
+                // is the one kept at this length
+                for (int c = 0; c < num_fwd; c++) {
+                    int next_idx = fwd_candidates[c];
+                    int consecutive_count = count_consecutive_copies(query, query_len, next_idx + length, 
+                                                                     segment, length);
+                    if (consecutive_count > 0 && local_top) {
+                        set_kept_repeat(&longest[0], pos, length, consecutive_count, 0, next_idx);
+                        break;
+                    } else if (consecutive_count > 0) {
+                        append_repeat(&local_repeats, &local_count, &local_capacity, 
+                                      segment, pos, length, consecutive_count, 0, next_idx);
                     }
-                    
-                    // Add to local repeats array
-                    if (local_count >= local_capacity) {
-                        local_capacity *= 2;
-                        RepeatPattern* new_local = (RepeatPattern*)realloc(local_repeats, 
-                                                 local_capacity * sizeof(RepeatPattern));
-                        if (UNLIKELY(!new_local)) {
-                            fprintf(stderr, "Memory reallocation failed\n");
-                            free(segment);
-                            free(rev_comp);
-                            free(local_repeats);
-                            exit(EXIT_FAILURE);
-                        }
-                        local_repeats = new_local;
-                    }
-                    
-                    local_repeats[local_count].position = pos;
-                    local_repeats[local_count].length = length;
-                    local_repeats[local_count].count = consecutive_count > 0 ? consecutive_count : 1;
-                    local_repeats[local_count].is_reverse = 1;
-                    local_repeats[local_count].orig_seq = strdup(segment);
-                    local_repeats[local_count].repeat_examples = NULL;
-                    local_repeats[local_count].num_examples = 0;
-                    local_count++;
-                    
-                    start_idx = next_idx + 1;
-                    if (start_idx >= query_len) break;
                 }
                 
-                free(segment);
-                free(rev_comp);
+                // Check for reverse complement repeats; the occurrence itself is rev_comp(segment)
+                for (int c = 0; c < num_rev; c++) {
+                    int next_idx = query_len - rev_candidates[c] - length;
+                    int consecutive_count = count_consecutive_copies(query, query_len, next_idx + length, 
+                                                                     query + next_idx, length);
+                    if (local_top) {
+                        set_kept_repeat(&longest[1], pos, length, consecutive_count > 0 ? consecutive_count : 1, 
+                                        1, next_idx);
+                        break;
+                    }
+                    append_repeat(&local_repeats, &local_count, &local_capacity, segment, pos, length, 
+                                  consecutive_count > 0 ? consecutive_count : 1, 1, next_idx);
+                }
+            }
+            
+            // Lengths only grow, so what is recorded last is the longest at each strand
+            if (local_top) {
+                for (int strand = 0; strand <= 1; strand++) {
+                    if (longest[strand].length > 0) topk_offer(local_top, &longest[strand]);
+                }
             }
         }
         
+        free(fwd_candidates);
+        free(rev_candidates);
+        
         // Merge thread-local results into global array
         omp_set_lock(&repeat_lock);
+        if (local_top) {
+            topk_merge(top, local_top);
+        }
         if (repeat_count + local_count > capacity) {
             // Need to resize global array
             while(repeat_count + local_count > capacity) capacity *= 2;
-            RepeatPattern* new_repeats = (RepeatPattern*)realloc(repeats, capacity * sizeof(RepeatPattern));
+            RepeatPattern* new_repeats = resize_repeat_patterns(repeats, repeat_count, capacity);
             if (UNLIKELY(!new_repeats)) {
                 fprintf(stderr, "Memory reallocation failed during merge\n");
                 free(local_repeats);
@@ -317,6 +332,16 @@ RepeatPattern* find_repeats(const char* reference, int ref_len, const char* quer
     }
     
     omp_destroy_lock(&repeat_lock);
+    report_scan_throughput("Repeat scan", positions_checked, omp_get_wtime() - scan_start);
+    free_kmer_index(query_index);
+    free_kmer_index(query_rc_index);
+    free(query_rc);
+    
+    if (top) {
+        free(repeats);
+        repeats = topk_release(top, &repeat_count);
+        printf("Kept the %d best repeats (top %d)\n", repeat_count, top_k);
+    }
     
     printf("Found %d repeat patterns\n", repeat_count);
     *num_repeats = repeat_count;
@@ -330,88 +355,68 @@ RepeatPattern* find_repeats(const char* reference, int ref_len, const char* quer
     return repeats;
 }
 
-// Add sequence information to repeat patterns - vectorized and parallelized version
+// Add instance offsets to repeat patterns - repeats are searched in batches that share
+// one bit-parallel scan of the query
 RepeatPattern* get_repeat_sequences(RepeatPattern* repeats, int num_repeats, const char* reference, const char* query, int ref_len, int query_len, int* new_count) {
     // Remove unused parameter warning with attribute
     (void)ref_len; // Explicitly mark as unused
     
     *new_count = num_repeats;
     
+    // Encode the query once for every search
+    BitmatchText* query_text = prepare_bitmatch_text(query, query_len);
+    
     // Set optimal thread count based on workload
     int thread_count = get_optimal_thread_count(num_repeats * 100);
     omp_set_num_threads(thread_count);
     
-    #pragma omp parallel for schedule(dynamic, 8)
-    for (int i = 0; i < num_repeats; i++) {
-        int pos = repeats[i].position;
-        int length = repeats[i].length;
-        int is_reverse = repeats[i].is_reverse;
-        
-        // Get the original segment from reference
-        char* segment = allocate_dna_sequence(length + 1);
-        strncpy(segment, reference + pos, length);
-        segment[length] = '\0';
-        
-        // For reverse complement
-        char* search_seq;
-        if (is_reverse) {
-            search_seq = get_reverse_complement(segment, length);
-        } else {
-            search_seq = strdup(segment);
-        }
+    int num_batches = (num_repeats + INSTANCE_BATCH_SIZE - 1) / INSTANCE_BATCH_SIZE;
+    
+    #pragma omp parallel for schedule(dynamic, 2)
+    for (int b = 0; b < num_batches; b++) {
+        int first = b * INSTANCE_BATCH_SIZE;
+        int batch_count = num_repeats - first < INSTANCE_BATCH_SIZE ? num_repeats - first : INSTANCE_BATCH_SIZE;
         
-        // Find repeat instances in query with optimized search
-        int start_idx = 0;
-        int instances_count = 0;
-        int instances_capacity = 16; // Start with reasonable capacity
-        char** instances = (char**)malloc(instances_capacity * sizeof(char*));
+        char* rev_comps[INSTANCE_BATCH_SIZE];
+        const char* patterns[INSTANCE_BATCH_SIZE];
+        int pattern_lens[INSTANCE_BATCH_SIZE];
+        int* offsets[INSTANCE_BATCH_SIZE];
+        int max_offsets[INSTANCE_BATCH_SIZE];
+        int counts[INSTANCE_BATCH_SIZE];
         
-        while (1) {
-            // Optimize string search
-            char* found = strstr(query + start_idx, search_seq);
-            if (!found) break;
+        for (int r = 0; r < batch_count; r++) {
+            RepeatPattern* repeat = &repeats[first + r];
+            const char* segment = reference + repeat->position;
             
-            int next_idx = found - query;
-            
-            // Resize instances array if needed
-            if (instances_count >= instances_capacity) {
-                instances_capacity *= 2;
-                char** new_instances = (char**)realloc(instances, instances_capacity * sizeof(char*));
-                if (UNLIKELY(!new_instances)) {
-                    fprintf(stderr, "Memory reallocation failed in thread %d\n", omp_get_thread_num());
-                    free(segment);
-                    free(search_seq);
-                    for (int j = 0; j < instances_count; j++) {
-                        free(instances[j]);
-                    }
-                    free(instances);
-                    exit(EXIT_FAILURE);
-                }
-                instances = new_instances;
+            // Engines that do not copy the segment get it here
+            if (!repeat->orig_seq) {
+                repeat->orig_seq = strndup(segment, repeat->length);
             }
             
-            // Store the found instance
-            instances[instances_count] = allocate_dna_sequence(length + 1);
-            strncpy(instances[instances_count], query + next_idx, length);
-            instances[instances_count][length] = '\0';
-            instances_count++;
+            // Search the reverse complement for reverse repeats, the segment itself otherwise
+            rev_comps[r] = repeat->is_reverse ? get_reverse_complement(segment, repeat->length) : NULL;
+            patterns[r] = rev_comps[r] ? rev_comps[r] : segment;
+            pattern_lens[r] = repeat->length;
             
-            // Advance search position
-            start_idx = next_idx + 1;
-            if (start_idx >= query_len) break;
-            if (instances_count >= repeats[i].count) break; // Only collect up to count examples
+            // Only collect up to count examples
+            max_offsets[r] = repeat->count > 0 ? repeat->count : 1;
+            offsets[r] = (int*)malloc(max_offsets[r] * sizeof(int));
+            if (UNLIKELY(!offsets[r])) {
+                fprintf(stderr, "Memory allocation failed in thread %d\n", omp_get_thread_num());
+                exit(EXIT_FAILURE);
+            }
         }
         
-        #pragma omp critical
-        {
-            repeats[i].repeat_examples = instances;
-            repeats[i].num_examples = instances_count;
-        }
+        bitmatch_search_batch(query_text, patterns, pattern_lens, batch_count, offsets, max_offsets, counts);
         
-        // Free temporary memory
-        free(search_seq);
+        for (int r = 0; r < batch_count; r++) {
+            repeats[first + r].example_positions = offsets[r];
+            repeats[first + r].num_examples = counts[r];
+            free(rev_comps[r]);
+        }
     }
     
+    free_bitmatch_text(query_text);
     return repeats;
 }
 
@@ -535,22 +540,7 @@ RepeatPattern* filter_nested_repeats(RepeatPattern* repeats, int num_repeats, in
     return result;
 }
 
-// Free memory used by similarity matrix - optimized for large matrices
-void free_matrix(int** matrix, int rows) {
-    if (!matrix) return;
-    
-    // Use parallel processing for large matrices
-    if (rows > 1000) {
-        #pragma omp parallel for
-        for (int i = 0; i < rows; i++) {
-            if (matrix[i]) free(matrix[i]);
-        }
-    } else {
-        // Sequential for smaller matrices
-        for (int i = 0; i < rows; i++) {
-            if (matrix[i]) free(matrix[i]);
-        }
-    }
-    
-    free(matrix);
+// Free memory used by similarity matrix
+void free_matrix(IntMatrix* matrix) {
+    free_int_matrix(matrix);
 }
@@ -2,6 +2,13 @@
 #include "../include/core/dna_io.h"
 #include "../include/core/dna_traditional.h"
 #include "../include/core/dna_graph.h"
+#include "../include/core/dna_diagonal.h"
+#include "../include/core/dna_mem.h"
+#include "../include/core/dna_topk.h"
+#include "../include/core/dna_incremental.h"
+#include "../include/core/dna_cost.h"
+#include "../include/core/dna_dotplot.h"
+#include "../include/core/dna_family.h"
 #include <sys/stat.h>
 #include <time.h>
 
@@ -43,6 +50,86 @@ int get_next_file_number() {
     return file_num;
 }
 
+// Update a saved analysis for an edited query and write the changed runs to
+// OUTPUT_DIR/delta_N.tsv. The first run on a state file (or one whose reference
+// changed) analyzes everything and saves the state instead.
+static int run_incremental(const char* reference, int ref_len, const char* query, int query_len,
+                           int file_num, FILE* output_file) {
+    const char* state_path = finder_options.state_file;
+    IncrementalState* state = load_incremental_state(state_path);
+    if (state && (state->ref_len != ref_len || state->ref_hash != hash_sequence(reference, ref_len))) {
+        printf("Reference changed since %s was saved, rebuilding\n", state_path);
+        fprintf(output_file, "Reference changed since %s was saved, rebuilding\n", state_path);
+        free_incremental_state(state);
+        state = NULL;
+    }
+    
+    if (!state) {
+        double build_start = omp_get_wtime();
+        state = build_incremental_state(reference, ref_len, query, query_len);
+        if (!state) return -1;
+        int saved = save_incremental_state(state, state_path);
+        printf("Full analysis: %d diagonal runs in %.2f milliseconds, state saved to %s\n", 
+               state->num_runs, (omp_get_wtime() - build_start) * 1000.0, state_path);
+        fprintf(output_file, "Full analysis: %d diagonal runs in %.2f milliseconds, state saved to %s\n", 
+                state->num_runs, (omp_get_wtime() - build_start) * 1000.0, state_path);
+        free_incremental_state(state);
+        return saved ? 0 : -1;
+    }
+    
+    int num_edits = 0;
+    QueryEdit* edits;
+    if (finder_options.edits_file) {
+        edits = read_query_edits(finder_options.edits_file, &num_edits);
+    } else {
+        edits = diff_query(state->query, state->query_len, query, query_len, &num_edits);
+    }
+    if (num_edits < 0) {
+        free_incremental_state(state);
+        return -1;
+    }
+    
+    char delta_filepath[100];
+    snprintf(delta_filepath, sizeof(delta_filepath), "%s/delta_%d.tsv", OUTPUT_DIR, file_num);
+    FILE* delta = fopen(delta_filepath, "w");
+    if (!delta) {
+        fprintf(stderr, "Failed to create delta file: %s\n", delta_filepath);
+    } else {
+        fprintf(delta, "edit\tchange\tquery_pos\tref_pos\tlength\n");
+    }
+    
+    double update_start = omp_get_wtime();
+    int records = 0;
+    int status = 0;
+    for (int e = 0; e < num_edits; e++) {
+        int changed = apply_query_edit(state, reference, &edits[e], e + 1, delta);
+        if (changed < 0) {
+            status = -1;
+            break;
+        }
+        records += changed;
+    }
+    double update_ms = (omp_get_wtime() - update_start) * 1000.0;
+    
+    if (delta) fclose(delta);
+    free_query_edits(edits, num_edits);
+    
+    // A failed edit leaves the saved state untouched
+    if (status == 0) {
+        printf("Incremental update: %d edits, %d run changes in %.3f milliseconds (%d runs now)\n", 
+               num_edits, records, update_ms, state->num_runs);
+        fprintf(output_file, "Incremental update: %d edits, %d run changes in %.3f milliseconds (%d runs now)\n", 
+                num_edits, records, update_ms, state->num_runs);
+        if (delta) {
+            printf("Run changes saved to: %s\n", delta_filepath);
+            fprintf(output_file, "Run changes saved to: %s\n", delta_filepath);
+        }
+        if (!save_incremental_state(state, state_path)) status = -1;
+    }
+    free_incremental_state(state);
+    return status;
+}
+
 // The main function
 int main(int argc, char *argv[]) {
     // Ensure output directory exists
@@ -63,10 +150,101 @@ int main(int argc, char *argv[]) {
     char* reference_file;
     char* query_file;
     
+    // Separate option flags from positional file arguments
+    char* positional[2];
+    int num_positional = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--exact") == 0) {
+            finder_options.exact_mode = 1;
+        } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            const char* engine = argv[++i];
+            if (strcmp(engine, "graph") == 0) {
+                finder_options.engine = ENGINE_GRAPH;
+            } else if (strcmp(engine, "diagonal") == 0) {
+                finder_options.engine = ENGINE_DIAGONAL;
+            } else if (strcmp(engine, "mem") == 0) {
+                finder_options.engine = ENGINE_MEM;
+            } else if (strcmp(engine, "traditional") == 0) {
+                finder_options.engine = ENGINE_TRADITIONAL;
+            } else if (strcmp(engine, "auto") == 0) {
+                finder_options.engine = ENGINE_AUTO;
+            } else {
+                fprintf(stderr, "Unknown engine: %s\n", engine);
+                print_usage(argv[0]);
+                fclose(output_file);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--smem") == 0) {
+            finder_options.smem_only = 1;
+        } else if (strcmp(argv[i], "--min-mem") == 0 && i + 1 < argc) {
+            finder_options.min_mem_length = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            finder_options.top_k = atoi(argv[++i]);
+            if (finder_options.top_k <= 0) {
+                fprintf(stderr, "--top expects a positive count\n");
+                print_usage(argv[0]);
+                fclose(output_file);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--self") == 0) {
+            finder_options.self_mode = 1;
+        } else if (strcmp(argv[i], "--state") == 0 && i + 1 < argc) {
+            finder_options.state_file = argv[++i];
+        } else if (strcmp(argv[i], "--edits") == 0 && i + 1 < argc) {
+            finder_options.edits_file = argv[++i];
+        } else if (strcmp(argv[i], "--dotplot") == 0 && i + 1 < argc) {
+            finder_options.dotplot_file = argv[++i];
+        } else if (strcmp(argv[i], "--dotplot-size") == 0 && i + 1 < argc) {
+            finder_options.dotplot_size = atoi(argv[++i]);
+            if (finder_options.dotplot_size <= 0) {
+                fprintf(stderr, "--dotplot-size expects a positive pixel count\n");
+                print_usage(argv[0]);
+                fclose(output_file);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--families") == 0) {
+            finder_options.families_mode = 1;
+        } else if (strncmp(argv[i], "--", 2) == 0) {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            fclose(output_file);
+            return EXIT_FAILURE;
+        } else if (num_positional < 2) {
+            positional[num_positional++] = argv[i];
+        }
+    }
+    
+    if (finder_options.self_mode && finder_options.state_file) {
+        fprintf(stderr, "--self cannot be combined with --state\n");
+        print_usage(argv[0]);
+        fclose(output_file);
+        return EXIT_FAILURE;
+    }
+    
+    if (finder_options.self_mode && finder_options.engine == ENGINE_TRADITIONAL) {
+        fprintf(stderr, "--self is not supported by --engine traditional\n");
+        print_usage(argv[0]);
+        fclose(output_file);
+        return EXIT_FAILURE;
+    }
+    
+    if (finder_options.edits_file && !finder_options.state_file) {
+        fprintf(stderr, "--edits needs --state\n");
+        print_usage(argv[0]);
+        fclose(output_file);
+        return EXIT_FAILURE;
+    }
+    
     // Check if file paths are provided as arguments, otherwise use defaults
-    if (argc == 3) {
-        reference_file = argv[1];
-        query_file = argv[2];
+    if (finder_options.self_mode) {
+        // One sequence compared against itself, read once and used on both sides
+        reference_file = num_positional > 0 ? positional[0] : DEFAULT_QUERY_FILE;
+        query_file = reference_file;
+        printf("Self-comparison of one sequence:\n");
+        fprintf(output_file, "Self-comparison of one sequence:\n");
+    } else if (num_positional == 2) {
+        reference_file = positional[0];
+        query_file = positional[1];
         printf("Using provided file paths:\n");
         fprintf(output_file, "Using provided file paths:\n");
     } else {
@@ -86,6 +264,21 @@ int main(int argc, char *argv[]) {
     fprintf(output_file, "DNA Repeat Finder\n");
     fprintf(output_file, "Version: 2.0 with DAG-based approach\n\n");
     
+    if (finder_options.exact_mode) {
+        printf("Exact mode: every reference position will be checked\n");
+        fprintf(output_file, "Exact mode: every reference position will be checked\n");
+    }
+    
+    if (finder_options.top_k > 0) {
+        printf("Top-K mode: keeping the %d highest scoring repeats (length x count)\n", finder_options.top_k);
+        fprintf(output_file, "Top-K mode: keeping the %d highest scoring repeats (length x count)\n", finder_options.top_k);
+    }
+    
+    if (finder_options.self_mode) {
+        printf("Self mode: every pair of copies is reported once, identity matches are skipped\n");
+        fprintf(output_file, "Self mode: every pair of copies is reported once, identity matches are skipped\n");
+    }
+    
     // Thread handling (if OpenMP is enabled)
     #ifdef _OPENMP
     int max_threads = omp_get_max_threads();
@@ -113,9 +306,14 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
     
-    printf("Reading query sequence from %s...\n", query_file);
-    fprintf(output_file, "Reading query sequence from %s...\n", query_file);
-    query = read_sequence_from_file(query_file, &query_len);
+    if (finder_options.self_mode) {
+        query = reference;
+        query_len = ref_len;
+    } else {
+        printf("Reading query sequence from %s...\n", query_file);
+        fprintf(output_file, "Reading query sequence from %s...\n", query_file);
+        query = read_sequence_from_file(query_file, &query_len);
+    }
     if (!query) {
         fprintf(stderr, "Failed to read query file: %s\n", query_file);
         fprintf(output_file, "Failed to read query file: %s\n", query_file);
@@ -127,28 +325,134 @@ int main(int argc, char *argv[]) {
     printf("Successfully loaded sequences. Reference length: %d, Query length: %d\n", ref_len, query_len);
     fprintf(output_file, "Successfully loaded sequences. Reference length: %d, Query length: %d\n", ref_len, query_len);
     
-    // Record start time for graph approach
-    clock_t start_time = clock();
+    if (finder_options.state_file) {
+        printf("\n--- Incremental re-analysis ---\n");
+        fprintf(output_file, "\n--- Incremental re-analysis ---\n");
+        int status = run_incremental(reference, ref_len, query, query_len, file_num, output_file);
+        printf("\nResults have been saved to: %s\n", output_filepath);
+        fclose(output_file);
+        free(reference);
+        free(query);
+        return status == 0 ? 0 : EXIT_FAILURE;
+    }
     
-    // Build DNA graph and find repeats using graph-based approach
-    printf("\n--- Using DAG-based approach ---\n");
-    fprintf(output_file, "\n--- Using DAG-based approach ---\n");
-    DNAGraph* dna_graph = build_dna_graph(reference, ref_len, query, query_len);
+    if (finder_options.dotplot_file) {
+        printf("\n--- Dot plot ---\n");
+        fprintf(output_file, "\n--- Dot plot ---\n");
+        int rendered = render_dotplot(reference, ref_len, query, query_len, DOTPLOT_MIN_RUN,
+                                      finder_options.dotplot_size, finder_options.dotplot_file);
+        if (rendered) {
+            printf("Dot plot of runs of at least %d bases saved to: %s\n", DOTPLOT_MIN_RUN, finder_options.dotplot_file);
+            fprintf(output_file, "Dot plot of runs of at least %d bases saved to: %s\n", DOTPLOT_MIN_RUN, 
+                    finder_options.dotplot_file);
+        }
+        printf("\nResults have been saved to: %s\n", output_filepath);
+        fclose(output_file);
+        if (query != reference) free(query);
+        free(reference);
+        return rendered ? 0 : EXIT_FAILURE;
+    }
+    
+    if (finder_options.families_mode) {
+        printf("\n--- Repeat families ---\n");
+        fprintf(output_file, "\n--- Repeat families ---\n");
+        int reported = report_repeat_families(reference, ref_len, query, query_len, output_file);
+        printf("\nResults have been saved to: %s\n", output_filepath);
+        fclose(output_file);
+        if (query != reference) free(query);
+        free(reference);
+        return reported >= 0 ? 0 : EXIT_FAILURE;
+    }
+    
+    // Let the cost model pick the engine from the input sizes and measured kernel costs
+    int auto_selected = finder_options.engine == ENGINE_AUTO;
+    double predicted_ms = 0.0;
+    if (auto_selected) {
+        printf("\n--- Selecting engine ---\n");
+        MachineProfile profile;
+        measure_machine_profile(&profile, ref_len > query_len ? ref_len : query_len);
+        finder_options.engine = choose_engine(&profile, ref_len, query_len, &predicted_ms);
+        printf("Auto engine: %s (predicted %.2f milliseconds)\n", engine_name(finder_options.engine), predicted_ms);
+        fprintf(output_file, "Auto engine: %s (predicted %.2f milliseconds)\n", 
+                engine_name(finder_options.engine), predicted_ms);
+        printf("Auto engine results: %s\n", engine_result_set(finder_options.engine));
+        fprintf(output_file, "Auto engine results: %s\n", engine_result_set(finder_options.engine));
+    }
+    
+    // Record start time for the selected engine
+    clock_t start_time = clock();
+    double wall_start = omp_get_wtime();
     
     int num_graph_repeats = 0;
-    RepeatPattern* graph_repeats = find_repeats_in_graph(dna_graph, reference, query, &num_graph_repeats);
+    RepeatPattern* graph_repeats = NULL;
+    const char* engine_label;
     
-    // Free graph memory
-    free_dna_graph(dna_graph);
+    if (finder_options.engine == ENGINE_DIAGONAL) {
+        // Scan every diagonal of the virtual similarity matrix for exact match runs
+        engine_label = "Diagonal";
+        printf("\n--- Using diagonal run approach ---\n");
+        fprintf(output_file, "\n--- Using diagonal run approach ---\n");
+        graph_repeats = find_repeats_diagonal(reference, ref_len, query, query_len, &num_graph_repeats);
+    } else if (finder_options.engine == ENGINE_MEM) {
+        // Enumerate maximal exact matches and stream them as they are found
+        engine_label = "MEM";
+        printf("\n--- Using maximal exact match approach ---\n");
+        fprintf(output_file, "\n--- Using maximal exact match approach ---\n");
+        
+        char mem_filepath[100];
+        snprintf(mem_filepath, sizeof(mem_filepath), "%s/mems_%d.tsv", OUTPUT_DIR, file_num);
+        FILE* mem_file = fopen(mem_filepath, "w");
+        if (!mem_file) {
+            fprintf(stderr, "Failed to create MEM output file: %s\n", mem_filepath);
+        }
+        
+        graph_repeats = find_repeats_mem(reference, ref_len, query, query_len, mem_file, &num_graph_repeats);
+        
+        if (mem_file) {
+            fclose(mem_file);
+            printf("MEM records saved to: %s\n", mem_filepath);
+            fprintf(output_file, "MEM records saved to: %s\n", mem_filepath);
+        }
+    } else if (finder_options.engine == ENGINE_TRADITIONAL) {
+        // Look every segment length up in a query k-mer index and count the copies that follow
+        engine_label = "Traditional";
+        printf("\n--- Using query index approach ---\n");
+        fprintf(output_file, "\n--- Using query index approach ---\n");
+        graph_repeats = find_repeats(reference, ref_len, query, query_len, &num_graph_repeats);
+    } else {
+        // Build DNA graph and find repeats using graph-based approach
+        engine_label = "Graph";
+        printf("\n--- Using DAG-based approach ---\n");
+        fprintf(output_file, "\n--- Using DAG-based approach ---\n");
+        DNAGraph* dna_graph = build_dna_graph(reference, ref_len, query, query_len);
+        
+        graph_repeats = find_repeats_in_graph(dna_graph, reference, ref_len, query, query_len, 
+                                              &num_graph_repeats);
+        
+        // Free graph memory
+        free_dna_graph(dna_graph);
+    }
     
     clock_t graph_end_time = clock();
     double graph_time = ((double)(graph_end_time - start_time) * 1000.0) / CLOCKS_PER_SEC;
     
+    if (auto_selected) {
+        double actual_ms = (omp_get_wtime() - wall_start) * 1000.0;
+        printf("Auto engine: %s predicted %.2f milliseconds, actual %.2f milliseconds (wall clock)\n", 
+               engine_name(finder_options.engine), predicted_ms, actual_ms);
+        fprintf(output_file, "Auto engine: %s predicted %.2f milliseconds, actual %.2f milliseconds (wall clock)\n", 
+                engine_name(finder_options.engine), predicted_ms, actual_ms);
+    }
+    
     // Filter nested repeats for graph-based approach
     int filtered_graph_count = 0;
     RepeatPattern* filtered_graph_repeats = NULL;
     
-    if (graph_repeats) {
+    if (graph_repeats && finder_options.engine == ENGINE_MEM) {
+        // MEMs are already maximal and carry their query interval as the instance
+        filtered_graph_repeats = graph_repeats;
+        filtered_graph_count = num_graph_repeats;
+    } else if (graph_repeats) {
         // First get sequence information
         int seq_count = 0;
         RepeatPattern* repeats_with_seq = get_repeat_sequences(graph_repeats, num_graph_repeats, 
@@ -158,11 +462,17 @@ int main(int argc, char *argv[]) {
         filtered_graph_repeats = filter_nested_repeats(repeats_with_seq, seq_count, 1, &filtered_graph_count);
     }
     
-    // Display graph-based results
-    printf("\nGraph-based approach found %d unique repeat patterns\n", filtered_graph_count);
-    printf("Graph processing time: %.2f milliseconds\n", graph_time);
-    fprintf(output_file, "\nGraph-based approach found %d unique repeat patterns\n", filtered_graph_count);
-    fprintf(output_file, "Graph processing time: %.2f milliseconds\n", graph_time);
+    // Rank the counted, filtered candidates best first and keep the top K
+    if (filtered_graph_repeats && finder_options.top_k > 0) {
+        filtered_graph_repeats = select_top_repeats(filtered_graph_repeats, filtered_graph_count, 
+                                                    finder_options.top_k, &filtered_graph_count);
+    }
+    
+    // Display engine results
+    printf("\n%s-based approach found %d unique repeat patterns\n", engine_label, filtered_graph_count);
+    printf("%s processing time: %.2f milliseconds\n", engine_label, graph_time);
+    fprintf(output_file, "\n%s-based approach found %d unique repeat patterns\n", engine_label, filtered_graph_count);
+    fprintf(output_file, "%s processing time: %.2f milliseconds\n", engine_label, graph_time);
     
     // Save graph-based results to console and file
     if (filtered_graph_repeats) {
@@ -180,12 +490,12 @@ int main(int argc, char *argv[]) {
                 fprintf(output_file, "  Sequence: %s\n", filtered_graph_repeats[i].orig_seq);
             }
             
-            // Print repeat examples if available
+            // Print repeat examples if available, read from the query at their offsets
             for (int j = 0; j < filtered_graph_repeats[i].num_examples && j < 3; j++) {
-                if (filtered_graph_repeats[i].repeat_examples[j]) {
-                    printf("  Example %d: %s\n", j+1, filtered_graph_repeats[i].repeat_examples[j]);
-                    fprintf(output_file, "  Example %d: %s\n", j+1, filtered_graph_repeats[i].repeat_examples[j]);
-                }
+                int offset = filtered_graph_repeats[i].example_positions[j];
+                int length = filtered_graph_repeats[i].length;
+                printf("  Example %d (query %d): %.*s\n", j+1, offset, length, query + offset);
+                fprintf(output_file, "  Example %d (query %d): %.*s\n", j+1, offset, length, query + offset);
             }
         }
         free_repeat_patterns(filtered_graph_repeats, filtered_graph_count);
@@ -196,9 +506,9 @@ int main(int argc, char *argv[]) {
     // Close output file
     fclose(output_file);
     
-    // Free memory
+    // Free memory (self mode shares one buffer)
     free(reference);
-    free(query);
+    if (query != reference) free(query);
     
     return 0;
 }
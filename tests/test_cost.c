@@ -0,0 +1,85 @@
+// Brute-force checks for cost-model engine selection.
+// Build from the repository root:
+//   gcc -O2 -fopenmp -mavx2 -Isrc tests/test_cost.c src/core/dna_cost.c src/core/dna_diagonal.c src/core/dna_index.c src/core/dna_topk.c src/core/dna_bitmatch.c src/core/dna_common.c -o test_cost -lm
+#include "../include/core/dna_cost.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        failures++; \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+// The engines auto may return: the ones reporting both strands
+static const EngineKind both_strand_engines[] = {ENGINE_GRAPH, ENGINE_MEM};
+
+// choose_engine has to return the cheapest both-strand engine and its estimate
+static void check_choice(const MachineProfile* profile, int ref_len, int query_len) {
+    EngineKind best = ENGINE_AUTO;
+    double best_ms = 0.0;
+    for (int e = 0; e < 2; e++) {
+        double ms = estimate_engine_time(both_strand_engines[e], profile, ref_len, query_len);
+        if (best == ENGINE_AUTO || ms < best_ms) {
+            best = both_strand_engines[e];
+            best_ms = ms;
+        }
+    }
+    
+    double predicted_ms = -1.0;
+    EngineKind chosen = choose_engine(profile, ref_len, query_len, &predicted_ms);
+    CHECK(chosen == best, "%dx%d, %d threads: chose %s, cheapest is %s", 
+          ref_len, query_len, profile->threads, engine_name(chosen), engine_name(best));
+    CHECK(predicted_ms == best_ms, "%dx%d: predicted %.4f ms, cheapest costs %.4f ms", 
+          ref_len, query_len, predicted_ms, best_ms);
+    CHECK(chosen != ENGINE_DIAGONAL, "%dx%d: picked the forward-only diagonal engine", ref_len, query_len);
+}
+
+// Longer inputs never cost less. Not true of the graph engine: its seed length grows with
+// both inputs, so a longer sequence can mean far fewer seed hits.
+static void check_monotone(const MachineProfile* profile, EngineKind engine) {
+    for (int ref_len = 1000; ref_len <= 4000000; ref_len *= 4) {
+        for (int query_len = 1000; query_len <= 4000000; query_len *= 4) {
+            double ms = estimate_engine_time(engine, profile, ref_len, query_len);
+            double longer_query = estimate_engine_time(engine, profile, ref_len, query_len * 2);
+            double longer_ref = estimate_engine_time(engine, profile, ref_len * 2, query_len);
+            CHECK(ms > 0 && longer_query >= ms && longer_ref >= ms, 
+                  "%s: %dx%d costs %.4f ms, doubling the query %.4f ms, the reference %.4f ms", 
+                  engine_name(engine), ref_len, query_len, ms, longer_query, longer_ref);
+        }
+    }
+}
+
+int main(void) {
+    // Fixed profiles with very different kernel balances, and the measured one
+    MachineProfile profiles[4] = {
+        {1, 0.5, 20.0, 2.0, 6.0, 1.5},
+        {8, 0.1, 80.0, 1.0, 2.0, 0.5},
+        {32, 2.0, 5.0, 10.0, 40.0, 3.0},
+        {0}
+    };
+    measure_machine_profile(&profiles[3], 1 << 16);
+    
+    for (int exact = 0; exact <= 1; exact++) {
+        finder_options.exact_mode = exact;
+        for (int p = 0; p < 4; p++) {
+            for (int ref_len = 100; ref_len <= 50000000; ref_len *= 7) {
+                for (int query_len = 100; query_len <= 50000000; query_len *= 7) {
+                    check_choice(&profiles[p], ref_len, query_len);
+                }
+            }
+            check_monotone(&profiles[p], ENGINE_DIAGONAL);
+            check_monotone(&profiles[p], ENGINE_MEM);
+        }
+    }
+    
+    if (failures) {
+        printf("test_cost: %d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("test_cost: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,208 @@
+// Brute-force checks for the sparse dot plot and its range queries.
+// Build from the repository root:
+//   gcc -O2 -fopenmp -mavx2 -Isrc tests/test_dotplot.c src/core/dna_dotplot.c src/core/dna_index.c src/core/dna_common.c -o test_dotplot -lm
+#include "../include/core/dna_dotplot.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        failures++; \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+// Same order as the plot: diagonal, then reference start
+static int compare_segments(const void* a, const void* b) {
+    const DiagonalSegment* x = (const DiagonalSegment*)a;
+    const DiagonalSegment* y = (const DiagonalSegment*)b;
+    if (x->diagonal != y->diagonal) return x->diagonal < y->diagonal ? -1 : 1;
+    if (x->ref_start != y->ref_start) return x->ref_start < y->ref_start ? -1 : 1;
+    return (x->length > y->length) - (x->length < y->length);
+}
+
+static void random_bases(char* sequence, int length) {
+    const char* bases = "ACGT";
+    for (int i = 0; i < length; i++) sequence[i] = bases[rand() % 4];
+    sequence[length] = '\0';
+}
+
+// Every maximal run of at least min_length matching A/C/G/T cells between reference and sequence
+static DiagonalSegment* brute_force_runs(const char* reference, int ref_len, const char* sequence, int seq_len,
+                                         int min_length, int* num_runs) {
+    int capacity = 64, count = 0;
+    DiagonalSegment* runs = (DiagonalSegment*)malloc(capacity * sizeof(DiagonalSegment));
+    for (int r = 0; r < ref_len; r++) {
+        for (int p = 0; p < seq_len; p++) {
+            if (!cells_match(reference[r], sequence[p])) continue;
+            if (r > 0 && p > 0 && cells_match(reference[r - 1], sequence[p - 1])) continue;
+            int length = 0;
+            while (r + length < ref_len && p + length < seq_len &&
+                   cells_match(reference[r + length], sequence[p + length])) {
+                length++;
+            }
+            if (length < min_length) continue;
+            if (count == capacity) {
+                capacity *= 2;
+                runs = (DiagonalSegment*)realloc(runs, capacity * sizeof(DiagonalSegment));
+            }
+            runs[count].diagonal = r - p;
+            runs[count].ref_start = r;
+            runs[count].length = length;
+            count++;
+        }
+    }
+    qsort(runs, count, sizeof(DiagonalSegment), compare_segments);
+    *num_runs = count;
+    return runs;
+}
+
+// Whether any cell of the segment lies in the window, walking the cells one by one in
+// query coordinates
+static int segment_in_window(const DiagonalSegment* segment, int is_reverse, int query_len, int ref_start,
+                             int ref_end, int query_start, int query_end) {
+    for (int c = 0; c < segment->length; c++) {
+        int r = segment->ref_start + c;
+        int p = r - segment->diagonal;
+        if (is_reverse) p = query_len - 1 - p;
+        if (r >= ref_start && r < ref_end && p >= query_start && p < query_end) return 1;
+    }
+    return 0;
+}
+
+static void compare_lists(const char* label, unsigned int seed, const DiagonalSegment* found, int num_found,
+                          const DiagonalSegment* expected, int num_expected) {
+    CHECK(num_found == num_expected, "%s, seed %u: %d segments, expected %d", label, seed, num_found, num_expected);
+    for (int i = 0; i < num_found && i < num_expected; i++) {
+        CHECK(compare_segments(&found[i], &expected[i]) == 0,
+              "%s, seed %u: segment %d is (%d, %d, %d), expected (%d, %d, %d)", label, seed, i,
+              found[i].diagonal, found[i].ref_start, found[i].length,
+              expected[i].diagonal, expected[i].ref_start, expected[i].length);
+    }
+}
+
+// A random window, sometimes empty, a single cell, the whole plot or past its edges
+static void random_window(int ref_len, int query_len, int* ref_start, int* ref_end, int* query_start,
+                          int* query_end) {
+    switch (rand() % 6) {
+    case 0:
+        *ref_start = -5;
+        *ref_end = ref_len + 5;
+        *query_start = -5;
+        *query_end = query_len + 5;
+        return;
+    case 1:
+        *ref_start = rand() % ref_len;
+        *ref_end = *ref_start + 1;
+        *query_start = rand() % query_len;
+        *query_end = *query_start + 1;
+        return;
+    case 2:
+        *ref_start = rand() % ref_len;
+        *ref_end = *ref_start - rand() % 3;
+        *query_start = 0;
+        *query_end = query_len;
+        return;
+    default:
+        *ref_start = rand() % ref_len - 10;
+        *ref_end = *ref_start + 1 + rand() % (ref_len / 2);
+        *query_start = rand() % query_len - 10;
+        *query_end = *query_start + 1 + rand() % (query_len / 2);
+        return;
+    }
+}
+
+static void check_plot(unsigned int seed, int ref_len, int query_len, int min_length) {
+    srand(seed);
+    char* reference = (char*)malloc(ref_len + 1);
+    char* query = (char*)malloc(query_len + 1);
+    random_bases(reference, ref_len);
+    random_bases(query, query_len);
+    
+    // Copies of reference stretches on both strands, some cut by an N
+    for (int n = 0; n < 16; n++) {
+        int length = min_length / 2 + rand() % (4 * min_length);
+        int from = rand() % (ref_len - length);
+        int to = rand() % (query_len - length);
+        if (rand() % 2) {
+            char* rc = get_reverse_complement(reference + from, length);
+            memcpy(query + to, rc, length);
+            free(rc);
+        } else {
+            memcpy(query + to, reference + from, length);
+        }
+        if (rand() % 3 == 0) query[to + rand() % length] = 'N';
+    }
+    reference[rand() % ref_len] = 'N';
+    
+    SparseDotPlot* plot = build_sparse_dotplot(reference, ref_len, query, query_len, min_length);
+    
+    // The stored segments are exactly the maximal runs of each strand
+    char* query_rc = get_reverse_complement(query, query_len);
+    int num_forward = 0, num_reverse = 0;
+    DiagonalSegment* forward = brute_force_runs(reference, ref_len, query, query_len, min_length, &num_forward);
+    DiagonalSegment* reverse = brute_force_runs(reference, ref_len, query_rc, query_len, min_length, &num_reverse);
+    compare_lists("forward segments", seed, plot->forward, plot->num_forward, forward, num_forward);
+    compare_lists("reverse segments", seed, plot->reverse, plot->num_reverse, reverse, num_reverse);
+    free(forward);
+    free(reverse);
+    free(query_rc);
+    
+    DiagonalSegment* expected = (DiagonalSegment*)malloc((plot->num_forward + plot->num_reverse + 1) *
+                                                         sizeof(DiagonalSegment));
+    for (int trial = 0; trial < 200; trial++) {
+        for (int is_reverse = 0; is_reverse <= 1; is_reverse++) {
+            const DiagonalSegment* segments = is_reverse ? plot->reverse : plot->forward;
+            int total = is_reverse ? plot->num_reverse : plot->num_forward;
+    
+            // Diagonal range against a linear filter
+            int first = rand() % (ref_len + query_len) - query_len;
+            int last = first + rand() % 200 - 20;
+            int num_expected = 0;
+            for (int s = 0; s < total; s++) {
+                if (segments[s].diagonal >= first && segments[s].diagonal <= last) expected[num_expected++] = segments[s];
+            }
+            int num_found = 0;
+            const DiagonalSegment* range = dotplot_diagonal_range(plot, is_reverse, first, last, &num_found);
+            compare_lists(is_reverse ? "reverse diagonal range" : "forward diagonal range", seed,
+                          range, num_found, expected, num_expected);
+    
+            // Window against a cell-by-cell filter
+            int ref_start, ref_end, query_start, query_end;
+            random_window(ref_len, query_len, &ref_start, &ref_end, &query_start, &query_end);
+            num_expected = 0;
+            for (int s = 0; s < total; s++) {
+                if (segment_in_window(&segments[s], is_reverse, query_len, ref_start, ref_end, query_start,
+                                      query_end)) {
+                    expected[num_expected++] = segments[s];
+                }
+            }
+            DiagonalSegment* window = dotplot_window(plot, is_reverse, ref_start, ref_end, query_start, query_end,
+                                                     &num_found);
+            compare_lists(is_reverse ? "reverse window" : "forward window", seed,
+                          window, num_found, expected, num_expected);
+            free(window);
+        }
+    }
+    
+    free(expected);
+    free_sparse_dotplot(plot);
+    free(reference);
+    free(query);
+}
+
+int main(void) {
+    for (unsigned int seed = 1; seed <= 12; seed++) {
+        omp_set_num_threads(1 + seed % 4);
+        check_plot(seed, 600 + seed * 50, 800 + seed * 40, seed % 2 ? DOTPLOT_MIN_RUN : 12);
+    }
+    
+    if (failures) {
+        printf("test_dotplot: %d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("test_dotplot: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,121 @@
+// Brute-force checks for find_paths_dp in cpp/dna_repeat_finder.cpp: forward and
+// reverse complement runs and their back-to-back repeat counts.
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -pthread tests/test_dp_paths.cpp -o test_dp_paths
+#define main finder_main
+#include "../cpp/dna_repeat_finder.cpp"
+#undef main
+
+#include <random>
+#include <set>
+#include <tuple>
+
+namespace {
+
+int failures = 0;
+
+char complement(char base) {
+    switch (base) {
+        case 'A': return 'T';
+        case 'T': return 'A';
+        case 'G': return 'C';
+        case 'C': return 'G';
+    }
+    return 'N';
+}
+
+using PathKey = std::tuple<int, int, int, int, bool>;
+
+// Every maximal run of at least min_length matches on a diagonal (forward) or anti-diagonal
+// (reference against the reverse complemented query), and for each length L from
+// min_length up to the run length the copies of the length-L query piece that follow it
+// back to back
+std::set<PathKey> brute_force_paths(const std::string& reference, const std::string& query, int min_length) {
+    int n = reference.size(), m = query.size();
+    std::vector<PathSegment> runs;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < m; j++) {
+            if (reference[i] == query[j] && !(i > 0 && j > 0 && reference[i - 1] == query[j - 1])) {
+                int length = 0;
+                while (i + length < n && j + length < m && reference[i + length] == query[j + length]) length++;
+                if (length >= min_length) runs.push_back({i, j, length, 0, false});
+            }
+            if (reference[i] == complement(query[j]) &&
+                !(i > 0 && j + 1 < m && reference[i - 1] == complement(query[j + 1]))) {
+                int length = 0;
+                while (i + length < n && j - length >= 0 && reference[i + length] == complement(query[j - length])) {
+                    length++;
+                }
+                if (length >= min_length) runs.push_back({i, j - length + 1, length, 0, true});
+            }
+        }
+    }
+    
+    std::set<PathKey> paths;
+    for (const auto& run : runs) {
+        for (int length = min_length; length <= run.length; length++) {
+            int query_start = run.is_reverse ? run.query_start + run.length - length : run.query_start;
+            int copies = 0;
+            for (int next = query_start + length; next + length <= m && 
+                 query.compare(next, length, query, query_start, length) == 0; next += length) {
+                copies++;
+            }
+            if (copies > 0) paths.insert({run.ref_start, query_start, length, copies, run.is_reverse});
+        }
+    }
+    return paths;
+}
+
+void check_paths(unsigned int seed) {
+    std::mt19937 rng(seed);
+    int n = 200 + rng() % 900, m = 200 + rng() % 900;
+    int min_length = 3 + rng() % 12;
+    std::string reference(n, 'A'), query(m, 'A');
+    for (auto& base : reference) base = "ACGT"[rng() % 4];
+    for (auto& base : query) base = "ACGT"[rng() % 4];
+    
+    // A long reverse complement match, a periodic query, a forward tandem copy
+    if (seed % 2) {
+        int length = std::min(n, m) - 10;
+        int ref_start = rng() % (n - length + 1), query_start = rng() % (m - length + 1);
+        for (int t = 0; t < length; t++) reference[ref_start + t] = complement(query[query_start + length - 1 - t]);
+    }
+    if (seed % 5 == 4) {
+        int period = 20 + rng() % 30;
+        for (int t = period; t < m; t++) query[t] = query[t - period];
+        int length = std::min(n, m) - 10;
+        int ref_start = rng() % (n - length + 1), query_start = rng() % (m - length + 1);
+        for (int t = 0; t < length; t++) reference[ref_start + t] = complement(query[query_start + length - 1 - t]);
+    }
+    if (seed % 3 == 0) {
+        int length = std::min(n, m) / 3;
+        for (int t = 0; t < length; t++) query[t + length] = query[t];
+    }
+    
+    std::set<PathKey> expected = brute_force_paths(reference, query, min_length);
+    for (int threads : {1, 3, 8}) {
+        std::set<PathKey> found;
+        for (const auto& path : find_paths_dp(reference, query, min_length, threads)) {
+            found.insert({path.ref_start, path.query_start, path.length, path.repeat_count, path.is_reverse});
+        }
+        if (found != expected) {
+            failures++;
+            printf("FAIL seed %u, %d threads: %zu paths, expected %zu\n", seed, threads, found.size(), expected.size());
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    for (unsigned int seed = 1; seed <= 40; seed++) {
+        check_paths(seed);
+    }
+    
+    if (failures) {
+        printf("test_dp_paths: %d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("test_dp_paths: all checks passed\n");
+    return 0;
+}
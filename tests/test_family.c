@@ -0,0 +1,366 @@
+// Brute-force checks for the repeat family graph.
+// Build from the repository root:
+//   gcc -O2 -fopenmp -mavx2 -Isrc tests/test_family.c src/core/dna_family.c src/core/dna_common.c -o test_family -lm
+#include "../include/core/dna_family.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        failures++; \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+// 2-bit code of s[0, k) (A=0, C=1, G=2, T=3), 0 if it holds anything else
+static int encode(const char* s, int k, uint64_t* code) {
+    *code = 0;
+    for (int i = 0; i < k; i++) {
+        int base = dna_base_code(s[i]);
+        if (base < 0) return 0;
+        *code = (*code << 2) | (uint64_t)base;
+    }
+    return 1;
+}
+
+// Reverse complement of a code, base by base
+static uint64_t reverse_code(uint64_t x, int k) {
+    uint64_t rc = 0;
+    for (int i = 0; i < k; i++) {
+        rc = (rc << 2) | (3 - (x & 3));
+        x >>= 2;
+    }
+    return rc;
+}
+
+static uint64_t canonical(uint64_t x, int k) {
+    uint64_t rc = reverse_code(x, k);
+    return x < rc ? x : rc;
+}
+
+typedef struct {
+    uint64_t from;
+    uint64_t to;
+} Pair;
+
+static int compare_pairs(const void* a, const void* b) {
+    const Pair* x = (const Pair*)a;
+    const Pair* y = (const Pair*)b;
+    if (x->from != y->from) return x->from < y->from ? -1 : 1;
+    return (x->to > y->to) - (x->to < y->to);
+}
+
+// First pair of a sorted array with from >= key
+static int lower_bound(const Pair* pairs, int count, uint64_t key) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (pairs[mid].from < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Number of pairs from key, the first one's target in *to
+static int pairs_from(const Pair* pairs, int count, uint64_t key, uint64_t* to) {
+    int first = lower_bound(pairs, count, key);
+    int last = first;
+    while (last < count && pairs[last].from == key) last++;
+    if (last > first) *to = pairs[first].to;
+    return last - first;
+}
+
+// Sort and drop repeated pairs
+static int sort_unique(Pair* pairs, int count) {
+    qsort(pairs, count, sizeof(Pair), compare_pairs);
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        if (kept == 0 || compare_pairs(&pairs[kept - 1], &pairs[i]) != 0) pairs[kept++] = pairs[i];
+    }
+    return kept;
+}
+
+// Whether oriented k-mer x runs on into y inside one unitig: y is x's only successor, x is
+// y's only predecessor, and y is not x on the other strand
+static int continues(const Pair* edges, int num_edges, uint64_t x, uint64_t* y, int k) {
+    uint64_t back;
+    return pairs_from(edges, num_edges, x, y) == 1 &&
+           pairs_from(edges, num_edges, reverse_code(*y, k), &back) == 1 &&
+           canonical(*y, k) != canonical(x, k);
+}
+
+typedef struct {
+    int unitig;
+    int is_reverse;
+    int diagonal;
+    int position;
+} Hit;
+
+static int compare_hits(const void* a, const void* b) {
+    const Hit* x = (const Hit*)a;
+    const Hit* y = (const Hit*)b;
+    if (x->unitig != y->unitig) return x->unitig < y->unitig ? -1 : 1;
+    if (x->is_reverse != y->is_reverse) return x->is_reverse - y->is_reverse;
+    if (x->diagonal != y->diagonal) return x->diagonal < y->diagonal ? -1 : 1;
+    return (x->position > y->position) - (x->position < y->position);
+}
+
+// Same order as match_repeat_families: by unitig, most k-mers first, then by position
+static int compare_matches(const void* a, const void* b) {
+    const FamilyMatch* x = (const FamilyMatch*)a;
+    const FamilyMatch* y = (const FamilyMatch*)b;
+    if (x->unitig != y->unitig) return x->unitig < y->unitig ? -1 : 1;
+    if (x->kmers != y->kmers) return x->kmers > y->kmers ? -1 : 1;
+    if (x->first != y->first) return x->first < y->first ? -1 : 1;
+    return x->is_reverse - y->is_reverse;
+}
+
+// Every k-mer of the sequence that a family unitig spells, on either strand, with hits of
+// one unitig, strand and diagonal grouped into one match
+static FamilyMatch* brute_force_matches(const DeBruijnGraph* graph, const char* sequence, int seq_len,
+                                        int* num_matches) {
+    int k = graph->k;
+    
+    // Oriented k-mers of the families as spelled, each with its unitig and offset
+    int num_spelled = 0;
+    for (int u = 0; u < graph->num_unitigs; u++) {
+        if (graph->unitigs[u].multiplicity > 1.0) num_spelled += graph->unitigs[u].length - k + 1;
+    }
+    Pair* spelled = (Pair*)malloc((num_spelled > 0 ? num_spelled : 1) * sizeof(Pair));
+    num_spelled = 0;
+    for (int u = 0; u < graph->num_unitigs; u++) {
+        const Unitig* unitig = &graph->unitigs[u];
+        if (unitig->multiplicity <= 1.0) continue;
+        for (int o = 0; o + k <= unitig->length; o++) {
+            encode(graph->bases + unitig->start + o, k, &spelled[num_spelled].from);
+            spelled[num_spelled++].to = ((uint64_t)u << 32) | (uint64_t)o;
+        }
+    }
+    qsort(spelled, num_spelled, sizeof(Pair), compare_pairs);
+    
+    int num_hits = 0;
+    Hit* hits = (Hit*)malloc((seq_len > 0 ? seq_len : 1) * sizeof(Hit));
+    for (int p = 0; p + k <= seq_len; p++) {
+        uint64_t x, where;
+        if (!encode(sequence + p, k, &x)) continue;
+        for (int is_reverse = 0; is_reverse <= 1; is_reverse++) {
+            if (pairs_from(spelled, num_spelled, is_reverse ? reverse_code(x, k) : x, &where) == 0) continue;
+            int offset = (int)(where & 0xFFFFFFFF);
+            hits[num_hits].unitig = (int)(where >> 32);
+            hits[num_hits].is_reverse = is_reverse;
+            hits[num_hits].diagonal = is_reverse ? p + offset : p - offset;
+            hits[num_hits++].position = p;
+        }
+    }
+    qsort(hits, num_hits, sizeof(Hit), compare_hits);
+    
+    int count = 0;
+    FamilyMatch* matches = (FamilyMatch*)malloc((num_hits > 0 ? num_hits : 1) * sizeof(FamilyMatch));
+    for (int h = 0; h < num_hits; h++) {
+        if (h > 0 && hits[h].unitig == hits[h - 1].unitig && hits[h].is_reverse == hits[h - 1].is_reverse &&
+            hits[h].diagonal == hits[h - 1].diagonal) {
+            matches[count - 1].last = hits[h].position;
+            matches[count - 1].kmers++;
+            continue;
+        }
+        FamilyMatch* match = &matches[count++];
+        match->unitig = hits[h].unitig;
+        match->is_reverse = hits[h].is_reverse;
+        match->first = match->last = hits[h].position;
+        match->kmers = 1;
+    }
+    qsort(matches, count, sizeof(FamilyMatch), compare_matches);
+    
+    free(spelled);
+    free(hits);
+    *num_matches = count;
+    return matches;
+}
+
+static void random_bases(char* sequence, int length) {
+    const char* bases = "ACGT";
+    for (int i = 0; i < length; i++) sequence[i] = bases[rand() % 4];
+    sequence[length] = '\0';
+}
+
+// Copy sequence[from, from + length) to to, reverse complemented if asked
+static void plant(char* sequence, int from, int length, int to, int is_reverse) {
+    char* copy = is_reverse ? get_reverse_complement(sequence + from, length) : strndup(sequence + from, length);
+    memcpy(sequence + to, copy, length);
+    free(copy);
+}
+
+static void check_families(unsigned int seed, int query_len, int k) {
+    srand(seed);
+    char* query = (char*)malloc(query_len + 1);
+    random_bases(query, query_len);
+    for (int n = 0; n < query_len / 150; n++) {
+        int length = k + rand() % 200;
+        if (length > query_len / 4) length = query_len / 4;
+        plant(query, rand() % (query_len - length), length, rand() % (query_len - length), rand() % 2);
+    }
+    for (int n = 0; n < 4; n++) query[rand() % query_len] = 'N';
+    
+    // The reference: a shifted copy of the query with substitutions and a few Ns
+    int ref_len = query_len + 100;
+    char* reference = (char*)malloc(ref_len + 1);
+    for (int i = 0; i < ref_len; i++) {
+        reference[i] = rand() % 40 == 0 ? "ACGTN"[rand() % 5] : query[(i + query_len / 3) % query_len];
+    }
+    reference[ref_len] = '\0';
+    
+    // Occurrences of every canonical k-mer and the links between oriented k-mers
+    int num_kmers = 0, num_edges = 0;
+    Pair* kmers = (Pair*)malloc(query_len * sizeof(Pair));
+    Pair* edges = (Pair*)malloc(2 * query_len * sizeof(Pair));
+    for (int i = 0; i + k <= query_len; i++) {
+        uint64_t x, y;
+        if (!encode(query + i, k, &x)) continue;
+        kmers[num_kmers].from = canonical(x, k);
+        kmers[num_kmers++].to = 0;
+        if (i + k < query_len && encode(query + i + 1, k, &y)) {
+            edges[num_edges++] = (Pair){x, y};
+            edges[num_edges++] = (Pair){reverse_code(y, k), reverse_code(x, k)};
+        }
+    }
+    qsort(kmers, num_kmers, sizeof(Pair), compare_pairs);
+    int distinct = 0;
+    for (int i = 0; i < num_kmers; i++) {
+        if (distinct > 0 && kmers[distinct - 1].from == kmers[i].from) {
+            kmers[distinct - 1].to++;
+        } else {
+            kmers[distinct].from = kmers[i].from;
+            kmers[distinct++].to = 1;
+        }
+    }
+    num_edges = sort_unique(edges, num_edges);
+    
+    for (int threads = 1; threads <= 4; threads *= 4) {
+        omp_set_num_threads(threads);
+        DeBruijnGraph* graph = build_debruijn_graph(query, query_len, k);
+        CHECK(graph->k == k && graph->num_kmers == distinct, "seed %u, k %d, %d threads: %d k-mers, expected %d",
+              seed, k, threads, graph->num_kmers, distinct);
+    
+        // Every slot: a query k-mer, its count and the bases it links to on each strand
+        Pair* slots = (Pair*)malloc((graph->num_kmers > 0 ? graph->num_kmers : 1) * sizeof(Pair));
+        int num_slots = 0;
+        for (int s = 0; s < graph->capacity; s++) {
+            if (graph->keys[s] == 0) continue;
+            uint64_t key = graph->keys[s] - 1, count = 0;
+            CHECK(pairs_from(kmers, distinct, key, &count) == 1 && (int)count == graph->counts[s],
+                  "seed %u, k %d, %d threads: slot %d counted %d times, expected %d",
+                  seed, k, threads, s, graph->counts[s], (int)count);
+    
+            // Bit b: the k-mer is followed by base b; bit 4 + b: its reverse complement is
+            int links = 0;
+            for (int strand = 0; strand <= 1; strand++) {
+                uint64_t x = strand ? reverse_code(key, k) : key;
+                for (int e = lower_bound(edges, num_edges, x); e < num_edges && edges[e].from == x; e++) {
+                    links |= 1 << (4 * strand + (int)(edges[e].to & 3));
+                }
+            }
+            CHECK(graph->links[s] == links, "seed %u, k %d, %d threads: slot %d links %02x, expected %02x",
+                  seed, k, threads, s, graph->links[s], links);
+    
+            if (num_slots < graph->num_kmers) {
+                slots[num_slots].from = key;
+                slots[num_slots++].to = (uint64_t)s;
+            }
+        }
+        qsort(slots, num_slots, sizeof(Pair), compare_pairs);
+    
+        // Unitigs: every k-mer once, at its recorded offset and strand, and each unitig a
+        // maximal run of continuing k-mers (or a whole cycle)
+        int* seen = (int*)calloc(graph->capacity, sizeof(int));
+        for (int u = 0; u < graph->num_unitigs; u++) {
+            const Unitig* unitig = &graph->unitigs[u];
+            const char* bases = graph->bases + unitig->start;
+            int length = unitig->length - k + 1;
+            CHECK(length >= 1, "seed %u, k %d, %d threads: unitig %d has %d bases",
+                  seed, k, threads, u, unitig->length);
+    
+            long long occurrences = 0;
+            uint64_t first = 0, x = 0, next = 0, slot = 0;
+            for (int o = 0; o < length; o++) {
+                int valid = encode(bases + o, k, &x);
+                CHECK(valid && pairs_from(slots, num_slots, canonical(x, k), &slot) == 1,
+                      "seed %u, k %d, %d threads: unitig %d spells an unknown k-mer at %d", seed, k, threads, u, o);
+                if (!valid) break;
+                seen[slot]++;
+                occurrences += graph->counts[slot];
+                CHECK(graph->kmer_unitig[slot] == u && graph->kmer_offset[slot] == 2 * o + (x != canonical(x, k)),
+                      "seed %u, k %d, %d threads: k-mer %d of unitig %d recorded as (%d, %d)",
+                      seed, k, threads, o, u, graph->kmer_unitig[slot], graph->kmer_offset[slot]);
+                if (o == 0) {
+                    first = x;
+                } else {
+                    CHECK(next == x, "seed %u, k %d, %d threads: unitig %d breaks before k-mer %d",
+                          seed, k, threads, u, o);
+                }
+                int more = continues(edges, num_edges, x, &next, k);
+                CHECK(more || o == length - 1, "seed %u, k %d, %d threads: unitig %d ends inside at %d",
+                      seed, k, threads, u, o);
+            }
+            if (continues(edges, num_edges, x, &next, k)) {
+                CHECK(canonical(next, k) == canonical(first, k), "seed %u, k %d, %d threads: unitig %d ends early",
+                      seed, k, threads, u);
+            }
+            if (continues(edges, num_edges, reverse_code(first, k), &next, k)) {
+                CHECK(canonical(next, k) == canonical(x, k), "seed %u, k %d, %d threads: unitig %d starts late",
+                      seed, k, threads, u);
+            }
+            double multiplicity = (double)occurrences / length;
+            CHECK(unitig->multiplicity > multiplicity - 1e-9 && unitig->multiplicity < multiplicity + 1e-9,
+                  "seed %u, k %d, %d threads: unitig %d multiplicity %.3f, expected %.3f",
+                  seed, k, threads, u, unitig->multiplicity, multiplicity);
+        }
+        for (int s = 0; s < graph->capacity; s++) {
+            if (graph->keys[s] != 0) {
+                CHECK(seen[s] == 1, "seed %u, k %d, %d threads: slot %d is in %d unitigs",
+                      seed, k, threads, s, seen[s]);
+            }
+        }
+    
+        // Family matches in the reference
+        int num_expected = 0, num_found = 0;
+        FamilyMatch* expected = brute_force_matches(graph, reference, ref_len, &num_expected);
+        FamilyMatch* found = match_repeat_families(graph, reference, ref_len, &num_found);
+        CHECK(num_found == num_expected, "seed %u, k %d, %d threads: %d family matches, expected %d",
+              seed, k, threads, num_found, num_expected);
+        for (int i = 0; i < num_found && i < num_expected; i++) {
+            CHECK(compare_matches(&found[i], &expected[i]) == 0 && found[i].last == expected[i].last,
+                  "seed %u, k %d, %d threads: match %d is (%d, %d, %d-%d, %d), expected (%d, %d, %d-%d, %d)",
+                  seed, k, threads, i, found[i].unitig, found[i].is_reverse, found[i].first, found[i].last,
+                  found[i].kmers, expected[i].unitig, expected[i].is_reverse, expected[i].first, expected[i].last,
+                  expected[i].kmers);
+        }
+    
+        free(expected);
+        free(found);
+        free(seen);
+        free(slots);
+        free_debruijn_graph(graph);
+    }
+    
+    free(kmers);
+    free(edges);
+    free(reference);
+    free(query);
+}
+
+int main(void) {
+    // Short k-mers branch everywhere, long ones only at the planted copies
+    int ks[] = {3, 5, 11, 21, FAMILY_KMER_DEFAULT};
+    for (unsigned int seed = 1; seed <= 10; seed++) {
+        check_families(seed, 2000 + seed * 300, ks[seed % 5]);
+    }
+    
+    if (failures) {
+        printf("test_family: %d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("test_family: all checks passed\n");
+    return 0;
+}
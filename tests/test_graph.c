@@ -0,0 +1,294 @@
+// Brute-force checks for the seed graph engine.
+// Build from the repository root:
+//   gcc -O2 -fopenmp -mavx2 -Isrc tests/test_graph.c src/core/dna_graph.c src/core/dna_index.c src/core/dna_topk.c src/core/dna_bitmatch.c src/core/dna_common.c -o test_graph -lm
+#include "../include/core/dna_graph.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        failures++; \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+typedef struct {
+    int position;
+    int length;
+    int is_reverse;
+    int query_position;
+} Match;
+
+static int compare_matches(const void* a, const void* b) {
+    const Match* x = (const Match*)a;
+    const Match* y = (const Match*)b;
+    if (x->position != y->position) return x->position < y->position ? -1 : 1;
+    if (x->length != y->length) return x->length < y->length ? -1 : 1;
+    if (x->is_reverse != y->is_reverse) return x->is_reverse - y->is_reverse;
+    return (x->query_position > y->query_position) - (x->query_position < y->query_position);
+}
+
+// Every maximal exact match of 50-100 bases between the reference and either strand of the query
+static Match* brute_force_matches(const char* reference, int ref_len, const char* query, int query_len, 
+                                  int* num_matches) {
+    char* query_rc = get_reverse_complement(query, query_len);
+    int capacity = 64, count = 0;
+    Match* matches = (Match*)malloc(capacity * sizeof(Match));
+    
+    for (int is_reverse = 0; is_reverse <= 1; is_reverse++) {
+        const char* target = is_reverse ? query_rc : query;
+        for (int r = 0; r < ref_len; r++) {
+            for (int p = 0; p < query_len; p++) {
+                if (reference[r] != target[p]) continue;
+                if (r > 0 && p > 0 && reference[r - 1] == target[p - 1]) continue;
+                int length = 0;
+                while (r + length < ref_len && p + length < query_len && 
+                       reference[r + length] == target[p + length]) {
+                    length++;
+                }
+                if (length < 50 || length > 100) continue;
+                if (count == capacity) {
+                    capacity *= 2;
+                    matches = (Match*)realloc(matches, capacity * sizeof(Match));
+                }
+                matches[count].position = r;
+                matches[count].length = length;
+                matches[count].is_reverse = is_reverse;
+                matches[count].query_position = is_reverse ? query_len - p - length : p;
+                count++;
+            }
+        }
+    }
+    
+    free(query_rc);
+    qsort(matches, count, sizeof(Match), compare_matches);
+    *num_matches = count;
+    return matches;
+}
+
+static void random_bases(char* sequence, int length) {
+    const char* bases = "ACGT";
+    for (int i = 0; i < length; i++) sequence[i] = bases[rand() % 4];
+    sequence[length] = '\0';
+}
+
+// Copy reference[from, from + length) into the query at to, reverse complemented if asked
+static void plant(const char* reference, int from, int length, char* query, int to, int is_reverse) {
+    if (is_reverse) {
+        char* rc = get_reverse_complement(reference + from, length);
+        memcpy(query + to, rc, length);
+        free(rc);
+    } else {
+        memcpy(query + to, reference + from, length);
+    }
+}
+
+static void check_graph(unsigned int seed, int ref_len, int query_len, int num_plants, int copies_of_one) {
+    srand(seed);
+    char* reference = (char*)malloc(ref_len + 1);
+    char* query = (char*)malloc(query_len + 1);
+    random_bases(reference, ref_len);
+    random_bases(query, query_len);
+    
+    // Planted copies, some cut by a substitution or overlapping each other
+    for (int n = 0; n < num_plants; n++) {
+        int length = 30 + rand() % 110;
+        plant(reference, rand() % (ref_len - length), length, query, rand() % (query_len - length), rand() % 2);
+        if (rand() % 3 == 0) {
+            int at = rand() % query_len;
+            query[at] = query[at] == 'A' ? 'C' : 'A';
+        }
+    }
+    // Many copies of one segment: one reference position, many query positions
+    int from = rand() % (ref_len - 70);
+    for (int n = 0; n < copies_of_one; n++) {
+        plant(reference, from, 70, query, (n * 80) % (query_len - 70), n % 2);
+    }
+    
+    int expected_count = 0;
+    Match* expected = brute_force_matches(reference, ref_len, query, query_len, &expected_count);
+    int want = expected_count < GRAPH_MAX_REPEATS ? expected_count : GRAPH_MAX_REPEATS;
+    
+    for (int threads = 1; threads <= 4; threads *= 2) {
+        omp_set_num_threads(threads);
+        DNAGraph* graph = build_dna_graph(reference, ref_len, query, query_len);
+        int num_repeats = 0;
+        RepeatPattern* repeats = find_repeats_in_graph(graph, reference, ref_len, query, query_len, &num_repeats);
+    
+        CHECK(num_repeats == want, "seed %u, %d threads: %d repeats, expected %d (of %d matches)", 
+              seed, threads, num_repeats, want, expected_count);
+        for (int i = 0; i < num_repeats && i < want; i++) {
+            Match found = {repeats[i].position, repeats[i].length, repeats[i].is_reverse, repeats[i].query_position};
+            CHECK(compare_matches(&found, &expected[i]) == 0, 
+                  "seed %u, %d threads: repeat %d is (%d, %d, %d, %d), expected (%d, %d, %d, %d)", 
+                  seed, threads, i, found.position, found.length, found.is_reverse, found.query_position,
+                  expected[i].position, expected[i].length, expected[i].is_reverse, expected[i].query_position);
+        }
+    
+        free_repeat_patterns(repeats, num_repeats);
+        free_dna_graph(graph);
+    }
+    
+    free(expected);
+    free(reference);
+    free(query);
+}
+
+typedef struct {
+    int source;
+    int is_reverse;
+    int target;
+    int length;
+} Edge;
+
+static int compare_edges(const void* a, const void* b) {
+    const Edge* x = (const Edge*)a;
+    const Edge* y = (const Edge*)b;
+    if (x->source != y->source) return x->source < y->source ? -1 : 1;
+    if (x->is_reverse != y->is_reverse) return x->is_reverse - y->is_reverse;
+    if (x->target != y->target) return x->target < y->target ? -1 : 1;
+    return (x->length > y->length) - (x->length < y->length);
+}
+
+static void push_edge(Edge** edges, int* count, int* capacity, int source, int is_reverse, int target, int length) {
+    if (*count == *capacity) {
+        *capacity *= 2;
+        *edges = (Edge*)realloc(*edges, *capacity * sizeof(Edge));
+    }
+    Edge* edge = &(*edges)[(*count)++];
+    edge->source = source;
+    edge->is_reverse = is_reverse;
+    edge->target = target;
+    edge->length = length;
+}
+
+// The compacted CSR graph built from scratch: one seed edge for every reference position
+// (but the last min_length) and query position whose min_length bases are equal, then
+// seeds on the same strand and diagonal merged while each starts within the span of the
+// ones before it. Reverse diagonals are taken against the reverse complemented query.
+static Edge* brute_force_edges(const char* reference, int ref_len, const char* query, int query_len,
+                               int self, int* num_edges) {
+    int min_length = 5 > ref_len / 1000 ? 5 : ref_len / 1000;
+    char* query_rc = get_reverse_complement(query, query_len);
+    int capacity = 64, count = 0;
+    Edge* edges = (Edge*)malloc(capacity * sizeof(Edge));
+    
+    for (int is_reverse = 0; is_reverse <= 1; is_reverse++) {
+        const char* target = is_reverse ? query_rc : query;
+        for (int diagonal = -query_len; diagonal < ref_len; diagonal++) {
+            int merged_start = -1, merged_end = -1;
+            for (int i = diagonal > 0 ? diagonal : 0; i < ref_len - min_length; i++) {
+                int p = i - diagonal;
+                int seeded = p + min_length <= query_len &&
+                             !(self && !is_reverse && p <= i) &&
+                             memcmp(reference + i, target + p, min_length) == 0;
+                if (!seeded) continue;
+                if (merged_start >= 0 && i <= merged_end) {
+                    merged_end = i + min_length;
+                    continue;
+                }
+                if (merged_start >= 0) {
+                    push_edge(&edges, &count, &capacity, merged_start, is_reverse, merged_start - diagonal,
+                              merged_end - merged_start);
+                }
+                merged_start = i;
+                merged_end = i + min_length;
+            }
+            if (merged_start >= 0) {
+                push_edge(&edges, &count, &capacity, merged_start, is_reverse, merged_start - diagonal,
+                          merged_end - merged_start);
+            }
+        }
+    }
+    
+    // Reverse edges point at the forward query interval
+    for (int e = 0; e < count; e++) {
+        if (edges[e].is_reverse) edges[e].target = query_len - edges[e].target - edges[e].length;
+    }
+    
+    free(query_rc);
+    qsort(edges, count, sizeof(Edge), compare_edges);
+    *num_edges = count;
+    return edges;
+}
+
+static void check_csr(unsigned int seed, int ref_len, int query_len, int num_plants, int self) {
+    srand(seed);
+    char* reference = (char*)malloc(ref_len + 1);
+    char* query = self ? reference : (char*)malloc(query_len + 1);
+    random_bases(reference, ref_len);
+    if (!self) random_bases(query, query_len);
+    
+    // Long planted copies make long super-edges, some overlapping on one diagonal
+    for (int n = 0; n < num_plants; n++) {
+        int length = 20 + rand() % 200;
+        char* segment = strndup(reference + rand() % (ref_len - length), length);
+        plant(segment, 0, length, query, rand() % (query_len - length), rand() % 2);
+        free(segment);
+    }
+    
+    int expected_count = 0;
+    Edge* expected = brute_force_edges(reference, ref_len, query, query_len, self, &expected_count);
+    
+    finder_options.self_mode = self;
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        omp_set_num_threads(threads);
+        DNAGraph* graph = build_dna_graph(reference, ref_len, query, query_len);
+    
+        CHECK(graph->num_nodes == ref_len && graph->offsets[0] == 0 && graph->offsets[ref_len] == graph->num_edges,
+              "seed %u, %d threads: %d nodes and offsets %d..%d for %d edges",
+              seed, threads, graph->num_nodes, graph->offsets[0], graph->offsets[ref_len], graph->num_edges);
+        CHECK(graph->num_edges == expected_count, "seed %u, %d threads: %d edges, expected %d",
+              seed, threads, graph->num_edges, expected_count);
+    
+        // Node order, then the order within a node: forward before reverse, by query position
+        int e = 0;
+        for (int i = 0; i < graph->num_nodes && e < graph->num_edges; i++) {
+            CHECK(graph->offsets[i] <= graph->offsets[i + 1], "seed %u, %d threads: offsets of node %d decrease",
+                  seed, threads, i);
+            for (int f = graph->offsets[i]; f < graph->offsets[i + 1] && e < expected_count; f++, e++) {
+                Edge found = {i, graph_edge_is_reverse(graph, f), graph->targets[f], graph->lengths[f]};
+                CHECK(compare_edges(&found, &expected[e]) == 0,
+                      "seed %u, %d threads: edge %d is (%d, %d, %d, %d), expected (%d, %d, %d, %d)",
+                      seed, threads, f, found.source, found.is_reverse, found.target, found.length,
+                      expected[e].source, expected[e].is_reverse, expected[e].target, expected[e].length);
+            }
+        }
+    
+        free_dna_graph(graph);
+    }
+    finder_options.self_mode = 0;
+    
+    free(expected);
+    if (!self) free(query);
+    free(reference);
+}
+
+int main(void) {
+    // Every seed and every match, as --exact runs it
+    finder_options.exact_mode = 1;
+    
+    for (unsigned int seed = 1; seed <= 12; seed++) {
+        check_graph(seed, 600 + seed * 50, 900 + seed * 70, 10, 0);
+    }
+    // More copies than the result cap
+    for (unsigned int seed = 13; seed <= 16; seed++) {
+        check_graph(seed, 800, 12000, 5, 130);
+    }
+    // The CSR arrays themselves, after compaction, with and without self mode
+    for (unsigned int seed = 17; seed <= 24; seed++) {
+        check_csr(seed, 700 + seed * 40, 1000 + seed * 30, 8, 0);
+    }
+    for (unsigned int seed = 25; seed <= 28; seed++) {
+        check_csr(seed, 1200, 1200, 8, 1);
+    }
+    
+    if (failures) {
+        printf("test_graph: %d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("test_graph: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,248 @@
+// Brute-force checks for incremental re-analysis: after every edit the saved runs and the
+// delta have to agree with a full diagonal scan of the edited query.
+// Build from the repository root:
+//   gcc -O2 -fopenmp -mavx2 -Isrc tests/test_incremental.c src/core/dna_incremental.c src/core/dna_diagonal.c src/core/dna_topk.c src/core/dna_index.c src/core/dna_common.c -o test_incremental -lm
+#include <unistd.h>
+#include "../include/core/dna_incremental.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        failures++; \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+// Same order as the saved runs: diagonal, reference start, length
+static int compare_runs(const void* a, const void* b) {
+    const DiagonalSegment* x = (const DiagonalSegment*)a;
+    const DiagonalSegment* y = (const DiagonalSegment*)b;
+    if (x->diagonal != y->diagonal) return x->diagonal < y->diagonal ? -1 : 1;
+    if (x->ref_start != y->ref_start) return x->ref_start < y->ref_start ? -1 : 1;
+    return (x->length > y->length) - (x->length < y->length);
+}
+
+static void random_bases(char* sequence, int length) {
+    const char* bases = "ACGT";
+    for (int i = 0; i < length; i++) sequence[i] = bases[rand() % 4];
+    sequence[length] = '\0';
+}
+
+static void compare_run_lists(const char* label, unsigned int seed, int step, const DiagonalSegment* found,
+                              int num_found, const DiagonalSegment* expected, int num_expected) {
+    CHECK(num_found == num_expected, "seed %u, edit %d: %s has %d runs, expected %d",
+          seed, step, label, num_found, num_expected);
+    for (int i = 0; i < num_found && i < num_expected; i++) {
+        CHECK(compare_runs(&found[i], &expected[i]) == 0,
+              "seed %u, edit %d: %s run %d is (%d, %d, %d), expected (%d, %d, %d)", seed, step, label, i,
+              found[i].diagonal, found[i].ref_start, found[i].length,
+              expected[i].diagonal, expected[i].ref_start, expected[i].length);
+    }
+}
+
+// A random edit of the query: a SNP, an insertion, a deletion, or a replacement with a
+// stretch of the reference (which creates new runs), sometimes at either end
+static QueryEdit random_edit(const char* reference, int ref_len, const char* query, int query_len) {
+    QueryEdit edit;
+    int kind = rand() % 4;
+    edit.position = rand() % 8 == 0 ? (rand() % 2 ? 0 : query_len) : rand() % (query_len + 1);
+    int room = query_len - edit.position;
+    edit.deleted = kind == 1 || room == 0 ? 0 : 1 + rand() % (kind == 2 ? 80 : 4);
+    if (edit.deleted > room) edit.deleted = room;
+    edit.inserted_len = kind == 2 ? 0 : kind == 0 ? 1 : 1 + rand() % (kind == 3 ? 120 : 10);
+    edit.inserted = (char*)malloc(edit.inserted_len + 1);
+    if (kind == 3 && edit.inserted_len < ref_len) {
+        memcpy(edit.inserted, reference + rand() % (ref_len - edit.inserted_len), edit.inserted_len);
+        edit.inserted[edit.inserted_len] = '\0';
+    } else {
+        random_bases(edit.inserted, edit.inserted_len);
+    }
+    if (kind == 0 && edit.deleted > 0) {
+        // A SNP changes the base, it never writes it back
+        edit.deleted = 1;
+        while (edit.inserted[0] == query[edit.position]) random_bases(edit.inserted, 1);
+    }
+    return edit;
+}
+
+// Apply the delta of one edit to the runs before it: drop the '-' runs, move the runs right
+// of the edit to their new diagonal and add the '+' runs
+static DiagonalSegment* replay_delta(const DiagonalSegment* before, int num_before, const QueryEdit* edit,
+                                     FILE* delta, int* num_after) {
+    int shift = edit->inserted_len - edit->deleted;
+    int old_end = edit->position + edit->deleted;
+    int capacity = num_before + 64, count = 0;
+    DiagonalSegment* after = (DiagonalSegment*)malloc(capacity * sizeof(DiagonalSegment));
+    int* removed = (int*)calloc(num_before > 0 ? num_before : 1, sizeof(int));
+    
+    rewind(delta);
+    int edit_id, query_start, ref_start, length;
+    char change;
+    while (fscanf(delta, "%d\t%c\t%d\t%d\t%d\n", &edit_id, &change, &query_start, &ref_start, &length) == 5) {
+        DiagonalSegment run = {ref_start - query_start, ref_start, length};
+        if (change == '-') {
+            for (int i = 0; i < num_before; i++) {
+                if (!removed[i] && compare_runs(&before[i], &run) == 0) {
+                    removed[i] = 1;
+                    break;
+                }
+            }
+        } else {
+            if (count == capacity) {
+                capacity *= 2;
+                after = (DiagonalSegment*)realloc(after, capacity * sizeof(DiagonalSegment));
+            }
+            after[count++] = run;
+        }
+    }
+    
+    for (int i = 0; i < num_before; i++) {
+        if (removed[i]) continue;
+        DiagonalSegment run = before[i];
+        if (run.ref_start - run.diagonal >= old_end) run.diagonal -= shift;
+        if (count == capacity) {
+            capacity *= 2;
+            after = (DiagonalSegment*)realloc(after, capacity * sizeof(DiagonalSegment));
+        }
+        after[count++] = run;
+    }
+    free(removed);
+    
+    qsort(after, count, sizeof(DiagonalSegment), compare_runs);
+    *num_after = count;
+    return after;
+}
+
+// Save the state, load it back and check that nothing was lost
+static IncrementalState* round_trip(IncrementalState* state, unsigned int seed, int step) {
+    char path[] = "/tmp/test_incremental_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        CHECK(0, "seed %u: could not create a temporary state file", seed);
+        return state;
+    }
+    close(fd);
+    
+    CHECK(save_incremental_state(state, path), "seed %u, edit %d: state not saved", seed, step);
+    IncrementalState* loaded = load_incremental_state(path);
+    unlink(path);
+    CHECK(loaded != NULL, "seed %u, edit %d: saved state does not load", seed, step);
+    if (!loaded) return state;
+    
+    CHECK(loaded->ref_len == state->ref_len && loaded->ref_hash == state->ref_hash,
+          "seed %u, edit %d: reference length or hash changed", seed, step);
+    CHECK(loaded->query_len == state->query_len && memcmp(loaded->query, state->query, state->query_len) == 0,
+          "seed %u, edit %d: query changed", seed, step);
+    const KmerIndex* a = loaded->ref_index;
+    const KmerIndex* b = state->ref_index;
+    size_t num_buckets = (size_t)1 << (2 * b->k);
+    CHECK(a->k == b->k && a->seq_len == b->seq_len &&
+          memcmp(a->offsets, b->offsets, (num_buckets + 1) * sizeof(unsigned int)) == 0 &&
+          memcmp(a->positions, b->positions, b->offsets[num_buckets] * sizeof(int)) == 0,
+          "seed %u, edit %d: reference index changed", seed, step);
+    compare_run_lists("loaded state", seed, step, loaded->runs, loaded->num_runs, state->runs, state->num_runs);
+    
+    free_incremental_state(state);
+    return loaded;
+}
+
+static void check_edits(unsigned int seed, int ref_len, int query_len, int num_edits) {
+    srand(seed);
+    char* reference = (char*)malloc(ref_len + 1);
+    char* query = (char*)malloc(query_len + 1);
+    random_bases(reference, ref_len);
+    random_bases(query, query_len);
+    
+    // Copies of reference stretches, some cut by an N, and N runs in the reference
+    for (int n = 0; n < 12; n++) {
+        int length = DIAGONAL_MIN_RUN / 2 + rand() % (3 * DIAGONAL_MIN_RUN);
+        memcpy(query + rand() % (query_len - length), reference + rand() % (ref_len - length), length);
+    }
+    for (int n = 0; n < 3; n++) {
+        query[rand() % query_len] = 'N';
+        memset(reference + rand() % (ref_len - 8), 'N', 1 + rand() % 8);
+    }
+    
+    IncrementalState* state = build_incremental_state(reference, ref_len, query, query_len);
+    FILE* delta = tmpfile();
+    
+    for (int step = 0; step < num_edits; step++) {
+        QueryEdit edit;
+        QueryEdit* diffed = NULL;
+        if (step % 5 == 4) {
+            // Two edits at once, described by diff_query as one replacement
+            QueryEdit first = random_edit(reference, ref_len, state->query, state->query_len);
+            int edited_len = state->query_len + first.inserted_len - first.deleted;
+            char* edited = (char*)malloc(edited_len + 1);
+            memcpy(edited, state->query, first.position);
+            memcpy(edited + first.position, first.inserted, first.inserted_len);
+            memcpy(edited + first.position + first.inserted_len, state->query + first.position + first.deleted,
+                   state->query_len - first.position - first.deleted);
+            edited[edited_len] = '\0';
+            int at = rand() % edited_len;
+            edited[at] = edited[at] == 'A' ? 'C' : 'A';
+    
+            int num_diffed = 0;
+            diffed = diff_query(state->query, state->query_len, edited, edited_len, &num_diffed);
+            CHECK(num_diffed == 1, "seed %u, edit %d: diff_query found %d edits", seed, step, num_diffed);
+            free(first.inserted);
+            free(edited);
+            if (num_diffed != 1) continue;
+            edit = *diffed;
+        } else {
+            edit = random_edit(reference, ref_len, state->query, state->query_len);
+        }
+    
+        int num_before = state->num_runs;
+        DiagonalSegment* before = (DiagonalSegment*)malloc((num_before > 0 ? num_before : 1) * sizeof(DiagonalSegment));
+        memcpy(before, state->runs, num_before * sizeof(DiagonalSegment));
+    
+        delta = freopen(NULL, "w+", delta);
+        int records = apply_query_edit(state, reference, &edit, step, delta);
+        fflush(delta);
+        CHECK(records >= 0, "seed %u, edit %d: edit at %d rejected", seed, step, edit.position);
+    
+        int num_expected = 0;
+        DiagonalSegment* expected = find_diagonal_runs(reference, ref_len, state->query, state->query_len,
+                                                       DIAGONAL_MIN_RUN, &num_expected);
+        qsort(expected, num_expected, sizeof(DiagonalSegment), compare_runs);
+        compare_run_lists("state", seed, step, state->runs, state->num_runs, expected, num_expected);
+    
+        int num_replayed = 0;
+        DiagonalSegment* replayed = replay_delta(before, num_before, &edit, delta, &num_replayed);
+        compare_run_lists("replayed delta", seed, step, replayed, num_replayed, expected, num_expected);
+    
+        free(replayed);
+        free(expected);
+        free(before);
+        if (diffed) {
+            free_query_edits(diffed, 1);
+        } else {
+            free(edit.inserted);
+        }
+    
+        if (step % 10 == 9) state = round_trip(state, seed, step);
+    }
+    
+    fclose(delta);
+    free_incremental_state(state);
+    free(reference);
+    free(query);
+}
+
+int main(void) {
+    for (unsigned int seed = 1; seed <= 12; seed++) {
+        omp_set_num_threads(1 + seed % 4);
+        check_edits(seed, 800 + seed * 100, 1200 + seed * 150, 60);
+    }
+    
+    if (failures) {
+        printf("test_incremental: %d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("test_incremental: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,209 @@
+// Brute-force checks for the similarity matrices: every cell of the bit-packed matrix, of
+// the int matrix from build_similarity_matrix and of the tiled matrix and its iterators
+// against a direct base comparison.
+// Build from the repository root:
+//   gcc -O2 -fopenmp -mavx2 -Isrc tests/test_matrix.c src/core/dna_matrix.c src/core/dna_traditional.c src/core/dna_index.c src/core/dna_bitmatch.c src/core/dna_topk.c src/core/dna_common.c -o test_matrix -lm
+#include "../include/core/dna_matrix.h"
+#include "../include/core/dna_traditional.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        failures++; \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+// Random bases, with an occasional N so non-ACGT bytes are compared too
+static char* random_sequence(int length) {
+    char* sequence = (char*)malloc(length + 1);
+    for (int i = 0; i < length; i++) {
+        sequence[i] = rand() % 50 == 0 ? 'N' : "ACGT"[rand() % 4];
+    }
+    sequence[length] = '\0';
+    return sequence;
+}
+
+// Cells, padding bits and row counts of the bit matrix
+static void check_bit_matrix(const char* reference, int ref_len, const char* query, int query_len) {
+    BitMatrix* matrix = build_bit_matrix(reference, ref_len, query, query_len);
+    CHECK(matrix->rows == ref_len && matrix->cols == query_len, "%d x %d: matrix is %d x %d", 
+          ref_len, query_len, matrix->rows, matrix->cols);
+    CHECK(matrix->words_per_row * 64 >= query_len, "%d x %d: %d words per row", ref_len, query_len, 
+          matrix->words_per_row);
+    
+    int wrong = 0;
+    for (int i = 0; i < ref_len; i++) {
+        int matches = 0;
+        for (int j = 0; j < query_len; j++) {
+            int expected = reference[i] == query[j];
+            matches += expected;
+            if (bit_matrix_get(matrix, i, j) != expected || bit_matrix_score(matrix, i, j) != (expected ? 1 : -1)) {
+                wrong++;
+            }
+        }
+        const uint64_t* row = bit_matrix_row(matrix, i);
+        for (int j = query_len; j < matrix->words_per_row * 64; j++) {
+            if ((row[j >> 6] >> (j & 63)) & 1) wrong++;
+        }
+        if (bit_matrix_row_matches(matrix, i) != matches) wrong++;
+    }
+    CHECK(wrong == 0, "%d x %d: %d wrong bit matrix cells or row counts", ref_len, query_len, wrong);
+    free_bit_matrix(matrix);
+}
+
+// Cells of the int matrix: 1 for a match, -1 otherwise, across every SIMD tail length
+static void check_int_matrix(const char* reference, int ref_len, const char* query, int query_len) {
+    IntMatrix* matrix = build_similarity_matrix(reference, ref_len, query, query_len);
+    CHECK(matrix->stride >= query_len, "%d x %d: stride %d", ref_len, query_len, matrix->stride);
+    
+    int wrong = 0;
+    for (int i = 0; i < ref_len; i++) {
+        const int* row = int_matrix_row(matrix, i);
+        for (int j = 0; j < query_len; j++) {
+            if (row[j] != (reference[i] == query[j] ? 1 : -1)) wrong++;
+        }
+    }
+    CHECK(wrong == 0, "%d x %d: %d wrong similarity matrix cells", ref_len, query_len, wrong);
+    free_matrix(matrix);
+}
+
+// Random cells, rows, diagonals and tile rectangles of a tiled matrix whose cache is
+// smaller than the pair, so tiles are evicted and recomputed between reads
+static void check_tiled_matrix(const char* reference, int ref_len, const char* query, int query_len,
+                               int tile_size, int max_tiles) {
+    TiledMatrix* matrix = create_tiled_matrix(reference, ref_len, query, query_len, tile_size, max_tiles);
+    int size = matrix->tile_size;
+    CHECK(size % 64 == 0 && size >= tile_size, "tile size %d became %d", tile_size, size);
+    
+    int wrong = 0;
+    for (int n = 0; n < 20000; n++) {
+        int i = rand() % ref_len, j = rand() % query_len;
+        if (tiled_matrix_get(matrix, i, j) != (reference[i] == query[j])) wrong++;
+    }
+    CHECK(wrong == 0, "%d x %d, tiles %d x %d: %d wrong cells", ref_len, query_len, size, max_tiles, wrong);
+    
+    // Row iterator: exactly the matching columns of [first, end), in order
+    wrong = 0;
+    for (int n = 0; n < 200; n++) {
+        int row = rand() % ref_len;
+        int first = rand() % query_len - 10, end = first + rand() % (query_len + 20);
+        MatrixRowIterator it;
+        matrix_row_iterator_init(&it, matrix, row, first, end);
+        int col, expected = first > 0 ? first : 0;
+        int last = end < query_len ? end : query_len;
+        while (matrix_row_iterator_next(&it, &col)) {
+            while (expected < last && reference[row] != query[expected]) expected++;
+            if (col != expected) wrong++;
+            expected = col + 1;
+        }
+        while (expected < last && reference[row] != query[expected]) expected++;
+        if (expected < last) wrong++;
+    }
+    CHECK(wrong == 0, "%d x %d, tiles %d x %d: %d wrong row walks", ref_len, query_len, size, max_tiles, wrong);
+    
+    // Diagonal iterator: every cell of the diagonal inside both sequences and [first, end)
+    wrong = 0;
+    for (int n = 0; n < 200; n++) {
+        int diagonal = rand() % (ref_len + query_len) - query_len;
+        int first = rand() % ref_len - 5, end = first + rand() % (ref_len + 10);
+        int lo = first > diagonal ? first : diagonal;
+        if (lo < 0) lo = 0;
+        int hi = end < ref_len ? end : ref_len;
+        if (hi > query_len + diagonal) hi = query_len + diagonal;
+        
+        MatrixDiagonalIterator it;
+        matrix_diagonal_iterator_init(&it, matrix, diagonal, first, end);
+        int i, match, expected = lo;
+        while (matrix_diagonal_iterator_next(&it, &i, &match)) {
+            if (i != expected || match != (reference[i] == query[i - diagonal])) wrong++;
+            expected++;
+            // Interleaved reads push the iterator's tile out of a small cache
+            tiled_matrix_get(matrix, rand() % ref_len, rand() % query_len);
+        }
+        if (expected < hi) wrong++;
+    }
+    CHECK(wrong == 0, "%d x %d, tiles %d x %d: %d wrong diagonal walks", ref_len, query_len, size, max_tiles, wrong);
+    
+    // Tile iterator: the tiles covering the rectangle, row-major, each with the right cells
+    wrong = 0;
+    for (int n = 0; n < 50; n++) {
+        int first_row = rand() % ref_len, end_row = first_row + 1 + rand() % ref_len;
+        int first_col = rand() % query_len, end_col = first_col + 1 + rand() % query_len;
+        if (end_row > ref_len) end_row = ref_len;
+        if (end_col > query_len) end_col = query_len;
+        
+        MatrixTileIterator it;
+        matrix_tile_iterator_init(&it, matrix, first_row, first_col, end_row, end_col);
+        int expected_row = first_row / size, expected_col = first_col / size, tiles = 0;
+        int tile_row, tile_col;
+        const uint64_t* tile;
+        while ((tile = matrix_tile_iterator_next(&it, &tile_row, &tile_col))) {
+            if (tile_row != expected_row || tile_col != expected_col) wrong++;
+            for (int probe = 0; probe < 16; probe++) {
+                int r = rand() % size, c = rand() % size;
+                int i = tile_row * size + r, j = tile_col * size + c;
+                int expected = i < ref_len && j < query_len && reference[i] == query[j];
+                if ((int)((tile[(size_t)r * matrix->tile_words + (c >> 6)] >> (c & 63)) & 1) != expected) wrong++;
+            }
+            tiles++;
+            if (++expected_col > (end_col - 1) / size) {
+                expected_col = first_col / size;
+                expected_row++;
+            }
+        }
+        int want = ((end_row - 1) / size - first_row / size + 1) * ((end_col - 1) / size - first_col / size + 1);
+        if (tiles != want) wrong++;
+    }
+    CHECK(wrong == 0, "%d x %d, tiles %d x %d: %d wrong tile walks", ref_len, query_len, size, max_tiles, wrong);
+    
+    CHECK(matrix->num_used <= matrix->max_tiles, "%d tiles cached, budget %d", matrix->num_used, matrix->max_tiles);
+    free_tiled_matrix(matrix);
+}
+
+int main(void) {
+    srand(7);
+    
+    // Lengths around the 32- and 64-cell vector widths, then sizes past the huge-page threshold
+    int sizes[][2] = {{1, 1}, {3, 31}, {5, 32}, {7, 33}, {9, 63}, {11, 64}, {13, 65}, {17, 127}, 
+                      {40, 200}, {200, 40}, {300, 333}, {1200, 1500}};
+    int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+    for (int s = 0; s < num_sizes; s++) {
+        int ref_len = sizes[s][0], query_len = sizes[s][1];
+        char* reference = random_sequence(ref_len);
+        char* query = random_sequence(query_len);
+        check_bit_matrix(reference, ref_len, query, query_len);
+        check_int_matrix(reference, ref_len, query, query_len);
+        free(reference);
+        free(query);
+    }
+    
+    // A low-complexity pair, where most cells match
+    char reference[500], query[700];
+    for (int i = 0; i < 500; i++) reference[i] = i % 7 ? 'A' : 'C';
+    for (int j = 0; j < 700; j++) query[j] = j % 5 ? 'A' : 'G';
+    check_bit_matrix(reference, 500, query, 700);
+    check_int_matrix(reference, 500, query, 700);
+    
+    // Tiled matrix with default, rounded and large tiles, from a one-tile cache up
+    int tiled[][4] = {{700, 900, 0, 1}, {700, 900, 0, 4}, {700, 900, 100, 3}, {1000, 333, 256, 2}, 
+                      {65, 1000, 64, 200}, {1, 1, 64, 1}};
+    int num_tiled = sizeof(tiled) / sizeof(tiled[0]);
+    for (int t = 0; t < num_tiled; t++) {
+        char* ref = random_sequence(tiled[t][0]);
+        char* que = random_sequence(tiled[t][1]);
+        check_tiled_matrix(ref, tiled[t][0], que, tiled[t][1], tiled[t][2], tiled[t][3]);
+        free(ref);
+        free(que);
+    }
+    
+    if (failures) {
+        printf("test_matrix: %d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("test_matrix: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,218 @@
+// Brute-force checks for the MEM engine.
+// Build from the repository root:
+//   gcc -O2 -fopenmp -mavx2 -Isrc tests/test_mem.c src/core/dna_mem.c src/core/dna_index.c src/core/dna_topk.c src/core/dna_bitmatch.c src/core/dna_common.c -o test_mem -lm
+#include "../include/core/dna_mem.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        failures++; \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+// Same order as find_mems: strand, query start, longest first, reference start
+static int compare_records(const void* a, const void* b) {
+    const MemRecord* x = (const MemRecord*)a;
+    const MemRecord* y = (const MemRecord*)b;
+    if (x->strand != y->strand) return x->strand - y->strand;
+    if (x->query_pos != y->query_pos) return x->query_pos < y->query_pos ? -1 : 1;
+    if (x->length != y->length) return x->length > y->length ? -1 : 1;
+    return (x->ref_pos > y->ref_pos) - (x->ref_pos < y->ref_pos);
+}
+
+static int bases_match(char a, char b) {
+    return a == b && a != 'N';
+}
+
+// Every maximal exact match of at least min_length bases between the reference and either
+// strand of the query, N matching nothing. In self mode a pair of copies is kept once:
+// forward matches right of the query copy, reverse ones not right of it.
+static MemRecord* brute_force_mems(const char* reference, int ref_len, const char* query, int query_len,
+                                   int min_length, int self, int* num_mems) {
+    char* query_rc = get_reverse_complement(query, query_len);
+    int capacity = 64, count = 0;
+    MemRecord* mems = (MemRecord*)malloc(capacity * sizeof(MemRecord));
+    
+    for (int strand = 0; strand <= 1; strand++) {
+        const char* target = strand ? query_rc : query;
+        for (int r = 0; r < ref_len; r++) {
+            for (int p = 0; p < query_len; p++) {
+                if (!bases_match(reference[r], target[p])) continue;
+                if (r > 0 && p > 0 && bases_match(reference[r - 1], target[p - 1])) continue;
+                int length = 0;
+                while (r + length < ref_len && p + length < query_len &&
+                       bases_match(reference[r + length], target[p + length])) {
+                    length++;
+                }
+                if (length < min_length) continue;
+                int query_start = strand ? query_len - p - length : p;
+                if (self && (strand ? r > query_start : r <= p)) continue;
+                if (count == capacity) {
+                    capacity *= 2;
+                    mems = (MemRecord*)realloc(mems, capacity * sizeof(MemRecord));
+                }
+                mems[count].query_pos = query_start;
+                mems[count].ref_pos = r;
+                mems[count].length = length;
+                mems[count].strand = strand;
+                count++;
+            }
+        }
+    }
+    
+    free(query_rc);
+    qsort(mems, count, sizeof(MemRecord), compare_records);
+    *num_mems = count;
+    return mems;
+}
+
+// Drop every MEM whose query interval lies inside a different interval on the same strand
+static int brute_force_supermaximal(MemRecord* mems, int count) {
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        int start = mems[i].query_pos, end = start + mems[i].length;
+        int contained = 0;
+        for (int j = 0; j < count && !contained; j++) {
+            int other_start = mems[j].query_pos, other_end = other_start + mems[j].length;
+            contained = mems[j].strand == mems[i].strand && other_start <= start && other_end >= end &&
+                        (other_start != start || other_end != end);
+        }
+        if (!contained) mems[kept++] = mems[i];
+    }
+    return kept;
+}
+
+static void random_bases(char* sequence, int length) {
+    const char* bases = "ACGT";
+    for (int i = 0; i < length; i++) sequence[i] = bases[rand() % 4];
+    sequence[length] = '\0';
+}
+
+// Copy reference[from, from + length) into the query at to, reverse complemented if asked
+static void plant(const char* reference, int from, int length, char* query, int to, int is_reverse) {
+    if (is_reverse) {
+        char* rc = get_reverse_complement(reference + from, length);
+        memcpy(query + to, rc, length);
+        free(rc);
+    } else {
+        memcpy(query + to, reference + from, length);
+    }
+}
+
+// A few runs of N, so planted copies can carry N at the same offset in both sequences
+static void sprinkle_ns(char* sequence, int length) {
+    for (int n = rand() % 4; n > 0; n--) {
+        int run = 1 + rand() % 12;
+        int at = rand() % (length - run);
+        memset(sequence + at, 'N', run);
+    }
+}
+
+static void compare_mems(const char* label, unsigned int seed, int threads, const MemRecord* found, int num_found,
+                         const MemRecord* expected, int num_expected) {
+    CHECK(num_found == num_expected, "%s, seed %u, %d threads: %d MEMs, expected %d",
+          label, seed, threads, num_found, num_expected);
+    for (int i = 0; i < num_found && i < num_expected; i++) {
+        CHECK(compare_records(&found[i], &expected[i]) == 0,
+              "%s, seed %u, %d threads: MEM %d is (%d, %d, %d, %d), expected (%d, %d, %d, %d)",
+              label, seed, threads, i, found[i].query_pos, found[i].ref_pos, found[i].length, found[i].strand,
+              expected[i].query_pos, expected[i].ref_pos, expected[i].length, expected[i].strand);
+    }
+}
+
+static void check_mems(unsigned int seed, int ref_len, int query_len, int num_plants, int min_length) {
+    srand(seed);
+    char* reference = (char*)malloc(ref_len + 1);
+    char* query = (char*)malloc(query_len + 1);
+    random_bases(reference, ref_len);
+    sprinkle_ns(reference, ref_len);
+    random_bases(query, query_len);
+    
+    // Planted copies, some cut by a substitution or an N, some overlapping each other
+    for (int n = 0; n < num_plants; n++) {
+        int length = min_length / 2 + rand() % (4 * min_length);
+        if (length > ref_len / 2) length = ref_len / 2;
+        plant(reference, rand() % (ref_len - length), length, query, rand() % (query_len - length), rand() % 2);
+        if (rand() % 3 == 0) {
+            int at = rand() % query_len;
+            query[at] = rand() % 2 ? 'N' : query[at] == 'A' ? 'C' : 'A';
+        }
+    }
+    
+    int num_expected = 0;
+    MemRecord* expected = brute_force_mems(reference, ref_len, query, query_len, min_length, 0, &num_expected);
+    int num_smems = num_expected;
+    MemRecord* smems = (MemRecord*)malloc((num_expected > 0 ? num_expected : 1) * sizeof(MemRecord));
+    memcpy(smems, expected, num_expected * sizeof(MemRecord));
+    num_smems = brute_force_supermaximal(smems, num_smems);
+    
+    SuffixIndex* index = build_suffix_index(reference, ref_len);
+    for (int threads = 1; threads <= 4; threads *= 4) {
+        omp_set_num_threads(threads);
+        int num_found = 0;
+        MemRecord* found = find_mems(index, query, query_len, min_length, 0, NULL, &num_found);
+        compare_mems("MEMs", seed, threads, found, num_found, expected, num_expected);
+        free(found);
+    
+        found = find_mems(index, query, query_len, min_length, 1, NULL, &num_found);
+        compare_mems("SMEMs", seed, threads, found, num_found, smems, num_smems);
+        free(found);
+    }
+    free_suffix_index(index);
+    
+    free(expected);
+    free(smems);
+    free(reference);
+    free(query);
+}
+
+// One sequence against itself, with copies of its own segments on both strands
+static void check_self(unsigned int seed, int length, int min_length) {
+    srand(seed);
+    char* sequence = (char*)malloc(length + 1);
+    random_bases(sequence, length);
+    for (int n = 0; n < 6; n++) {
+        int copy = min_length + rand() % (2 * min_length);
+        int from = rand() % (length - copy);
+        int to = rand() % (length - copy);
+        char* segment = strndup(sequence + from, copy);
+        plant(segment, 0, copy, sequence, to, rand() % 2);
+        free(segment);
+    }
+    sprinkle_ns(sequence, length);
+    
+    int num_expected = 0;
+    MemRecord* expected = brute_force_mems(sequence, length, sequence, length, min_length, 1, &num_expected);
+    
+    finder_options.self_mode = 1;
+    SuffixIndex* index = build_suffix_index(sequence, length);
+    int num_found = 0;
+    MemRecord* found = find_mems(index, sequence, length, min_length, 0, NULL, &num_found);
+    compare_mems("self MEMs", seed, omp_get_max_threads(), found, num_found, expected, num_expected);
+    free(found);
+    free_suffix_index(index);
+    finder_options.self_mode = 0;
+    
+    free(expected);
+    free(sequence);
+}
+
+int main(void) {
+    for (unsigned int seed = 1; seed <= 12; seed++) {
+        check_mems(seed, 500 + seed * 60, 700 + seed * 50, 12, seed % 2 ? MEM_BUCKET_K : 20);
+    }
+    for (unsigned int seed = 13; seed <= 16; seed++) {
+        check_self(seed, 1500, 16);
+    }
+    
+    if (failures) {
+        printf("test_mem: %d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("test_mem: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,163 @@
+// Brute-force checks for the prefix hash engine of dna_repeat_finder_new.c.
+// Build from the repository root:
+//   gcc -O2 tests/test_prefix_hash.c -o test_prefix_hash
+#define main finder_main
+#include "../dna_repeat_finder_new.c"
+#undef main
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        failures++; \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+static int compare_repeats(const void* a, const void* b) {
+    const RepeatPattern* x = (const RepeatPattern*)a;
+    const RepeatPattern* y = (const RepeatPattern*)b;
+    if (x->position != y->position) return x->position - y->position;
+    if (x->is_reverse != y->is_reverse) return x->is_reverse - y->is_reverse;
+    if (x->length != y->length) return x->length - y->length;
+    if (x->repeat_count != y->repeat_count) return x->repeat_count - y->repeat_count;
+    return x->query_position - y->query_position;
+}
+
+// What find_repeats keeps after filtering nested repeats, with exact matching: for every
+// reference position and strand, the longest length in [MIN_LENGTH, MAX_LENGTH] at which
+// query windows equal to the segment form a run of at least two back-to-back copies,
+// and the last such run at that length
+static RepeatPattern* brute_force_repeats(const char* query, const char* reference, int* count) {
+    int query_len = strlen(query), ref_len = strlen(reference);
+    RepeatPattern* repeats = (RepeatPattern*)malloc(sizeof(RepeatPattern) * (2 * ref_len + 1));
+    int* common = (int*)malloc(sizeof(int) * (query_len + 1));
+    int* hits = (int*)malloc(sizeof(int) * (query_len + 1));
+    char* rc = (char*)malloc(MAX_LENGTH + 1);
+    *count = 0;
+    
+    for (int i = 0; i + MIN_LENGTH <= ref_len; i++) {
+        int longest = ref_len - i < MAX_LENGTH ? ref_len - i : MAX_LENGTH;
+        if (longest > query_len) longest = query_len;
+        get_reverse_complement(reference + i, rc, longest);
+    
+        for (int strand = 0; strand < 2; strand++) {
+            // Forward: the window at q holds the segment of length L when query[q..] and
+            // reference[i..] share L bases. Reverse: the reverse complement of the length L
+            // segment is the last L bases of rc, so the window ending at e holds it when
+            // query[..e] and rc share an L base suffix; common[] is indexed by window start.
+            int most_shared = 0;
+            for (int q = 0; q < query_len; q++) {
+                int shared = 0;
+                if (strand == 0) {
+                    while (shared < longest && q + shared < query_len && query[q + shared] == reference[i + shared]) {
+                        shared++;
+                    }
+                    common[q] = shared;
+                } else {
+                    while (shared < longest && q - shared >= 0 && query[q - shared] == rc[longest - 1 - shared]) {
+                        shared++;
+                    }
+                    common[q] = shared;   // Ending at q, not starting
+                }
+                if (shared > most_shared) most_shared = shared;
+            }
+            if (most_shared < MIN_LENGTH) continue;
+    
+            RepeatPattern best = {0};
+            for (int length = MIN_LENGTH; length <= longest; length++) {
+                int num_hits = 0;
+                for (int q = 0; q + length <= query_len; q++) {
+                    int shared = strand == 0 ? common[q] : common[q + length - 1];
+                    if (shared >= length) hits[num_hits++] = q;
+                }
+                int start = 0;
+                for (int j = 1; j <= num_hits; j++) {
+                    if (j < num_hits && hits[j] == hits[j - 1] + length) continue;
+                    if (j - start >= 2) {
+                        best.position = i;
+                        best.length = length;
+                        best.repeat_count = j - start;
+                        best.is_reverse = strand == 1;
+                        best.query_position = hits[start];
+                    }
+                    start = j;
+                }
+            }
+            if (best.length > 0) repeats[(*count)++] = best;
+        }
+    }
+    
+    free(common);
+    free(hits);
+    free(rc);
+    return repeats;
+}
+
+static void random_bases(char* sequence, int length) {
+    const char* bases = "ACGT";
+    for (int i = 0; i < length; i++) sequence[i] = bases[rand() % 4];
+    sequence[length] = '\0';
+}
+
+static void check_prefix_hash(unsigned int seed) {
+    srand(seed);
+    int ref_len = 600 + rand() % 600, query_len = 1500 + rand() % 1500;
+    char* reference = (char*)malloc(ref_len + 1);
+    char* query = (char*)malloc(query_len + 1);
+    char* copy = (char*)malloc(MAX_LENGTH + 16);
+    random_bases(reference, ref_len);
+    random_bases(query, query_len);
+    
+    // Tandem runs of a reference segment or its reverse complement, plus loose copies
+    for (int n = 0; n < 8; n++) {
+        int length = MIN_LENGTH - 5 + rand() % (MAX_LENGTH - MIN_LENGTH + 15);
+        int from = rand() % (ref_len - length);
+        int copies = n % 4 == 3 ? 1 : 2 + rand() % 4;
+        int to = rand() % (query_len - copies * length);
+        if (n % 2) {
+            get_reverse_complement(reference + from, copy, length);
+        } else {
+            memcpy(copy, reference + from, length);
+        }
+        for (int c = 0; c < copies; c++) memcpy(query + to + c * length, copy, length);
+    }
+    
+    int expected_count = 0;
+    RepeatPattern* expected = brute_force_repeats(query, reference, &expected_count);
+    int found_count = 0;
+    RepeatPattern* found = find_repeats_prefix_hash(query, reference, &found_count);
+    
+    qsort(expected, expected_count, sizeof(RepeatPattern), compare_repeats);
+    qsort(found, found_count, sizeof(RepeatPattern), compare_repeats);
+    CHECK(found_count == expected_count, "seed %u: %d repeats, expected %d", seed, found_count, expected_count);
+    for (int r = 0; r < found_count && r < expected_count; r++) {
+        CHECK(compare_repeats(&found[r], &expected[r]) == 0, 
+              "seed %u: repeat %d is (%d, %d, %d, %d, %d), expected (%d, %d, %d, %d, %d)", seed, r,
+              found[r].position, found[r].length, found[r].repeat_count, found[r].is_reverse, found[r].query_position,
+              expected[r].position, expected[r].length, expected[r].repeat_count, expected[r].is_reverse, 
+              expected[r].query_position);
+    }
+    
+    for (int r = 0; r < found_count; r++) free(found[r].original_sequence);
+    free(found);
+    free(expected);
+    free(reference);
+    free(query);
+    free(copy);
+}
+
+int main(void) {
+    for (unsigned int seed = 1; seed <= 40; seed++) {
+        check_prefix_hash(seed);
+    }
+    
+    if (failures) {
+        printf("test_prefix_hash: %d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("test_prefix_hash: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,421 @@
+// Brute-force checks for the bounded top-K heap, repeat resolution and every engine's --top.
+// Build from the repository root:
+//   gcc -O2 -fopenmp -mavx2 -Isrc tests/test_topk.c src/core/dna_topk.c src/core/dna_graph.c src/core/dna_diagonal.c src/core/dna_mem.c src/core/dna_traditional.c src/core/dna_matrix.c src/core/dna_index.c src/core/dna_bitmatch.c src/core/dna_common.c -o test_topk -lm
+#include "../include/core/dna_topk.h"
+#include "../include/core/dna_graph.h"
+#include "../include/core/dna_diagonal.h"
+#include "../include/core/dna_mem.h"
+#include "../include/core/dna_traditional.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        failures++; \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+// Same order as the heap: best score first, then reference position, longest, strand, query position
+static int compare_rank(const void* a, const void* b) {
+    const RepeatPattern* x = (const RepeatPattern*)a;
+    const RepeatPattern* y = (const RepeatPattern*)b;
+    long long sx = repeat_score(x), sy = repeat_score(y);
+    if (sx != sy) return sx > sy ? -1 : 1;
+    if (x->position != y->position) return x->position < y->position ? -1 : 1;
+    if (x->length != y->length) return x->length > y->length ? -1 : 1;
+    if (x->is_reverse != y->is_reverse) return x->is_reverse - y->is_reverse;
+    return (x->query_position > y->query_position) - (x->query_position < y->query_position);
+}
+
+// Offer random repeats, each several times, to one heap per "thread", merge them and compare
+// with the K best distinct repeats. Length and count are a function of the repeat's identity,
+// so many repeats tie on score and are ranked by their positions.
+static void check_heap(unsigned int seed, int k, int num_offers, int num_positions, int num_heaps) {
+    srand(seed);
+    RepeatPattern* offered = (RepeatPattern*)malloc(num_offers * sizeof(RepeatPattern));
+    TopKHeap* heaps[8];
+    for (int h = 0; h < num_heaps; h++) heaps[h] = create_topk_heap(k);
+    
+    int num_distinct = 0;
+    for (int i = 0; i < num_offers; i++) {
+        RepeatPattern candidate = {0};
+        if (num_distinct > 0 && rand() % 3 == 0) {
+            candidate = offered[rand() % num_distinct];
+        } else {
+            candidate.position = rand() % num_positions;
+            candidate.is_reverse = rand() % 2;
+            candidate.query_position = rand() % 8;
+            unsigned int identity = (unsigned int)(candidate.position * 16 + candidate.query_position * 2 + 
+                                                   candidate.is_reverse);
+            candidate.length = 1 + identity * 2654435761u % 12;
+            candidate.count = 1 + identity * 40503u % 4;
+            int seen = 0;
+            for (int j = 0; j < num_distinct && !seen; j++) {
+                seen = compare_rank(&offered[j], &candidate) == 0;
+            }
+            if (!seen) offered[num_distinct++] = candidate;
+        }
+        topk_offer(heaps[rand() % num_heaps], &candidate);
+    }
+    for (int h = 1; h < num_heaps; h++) topk_merge(heaps[0], heaps[h]);
+    
+    int kept = 0;
+    RepeatPattern* repeats = topk_release(heaps[0], &kept);
+    
+    qsort(offered, num_distinct, sizeof(RepeatPattern), compare_rank);
+    int want = num_distinct < k ? num_distinct : k;
+    CHECK(kept == want, "seed %u: kept %d repeats, expected %d", seed, kept, want);
+    for (int i = 0; i < kept && i < want; i++) {
+        CHECK(compare_rank(&repeats[i], &offered[i]) == 0, 
+              "seed %u: rank %d is (%d, %d, %d, %d), expected (%d, %d, %d, %d)", seed, i, 
+              repeats[i].position, repeats[i].query_position, repeats[i].length, repeats[i].count,
+              offered[i].position, offered[i].query_position, offered[i].length, offered[i].count);
+    }
+    
+    free_repeat_patterns(repeats, kept);
+    free(offered);
+}
+
+// Count overlapping occurrences of pattern in text
+static int brute_count(const char* text, int text_len, const char* pattern, int pattern_len) {
+    int count = 0;
+    for (int i = 0; i + pattern_len <= text_len; i++) {
+        if (memcmp(text + i, pattern, pattern_len) == 0) count++;
+    }
+    return count;
+}
+
+static int bases_equal(char a, char b, int bases_only) {
+    return a == b && (!bases_only || dna_base_code(a) >= 0);
+}
+
+// resolve_repeat by brute force: try every target offset
+static int brute_resolve(const RepeatScope* scope, const char* reference, int ref_len, int position, 
+                         RepeatPattern* repeat) {
+    const char* target = scope->target;
+    int best_length = 0, best_target = -1;
+    for (int q = 0; q < scope->target_len; q++) {
+        if (position > 0 && q > 0 && bases_equal(reference[position - 1], target[q - 1], scope->bases_only)) {
+            continue;
+        }
+        int length = 0;
+        while (position + length < ref_len && q + length < scope->target_len &&
+               bases_equal(reference[position + length], target[q + length], scope->bases_only)) {
+            length++;
+        }
+        if (length <= best_length || length < scope->min_length) continue;
+        if (scope->max_length > 0 && length > scope->max_length) continue;
+        int clean = 1;
+        for (int i = 0; i < length; i++) clean &= dna_base_code(reference[position + i]) >= 0;
+        if (!clean) continue;
+        if (scope->self_rule == SELF_TARGET_AFTER && q <= position) continue;
+        if (scope->self_rule == SELF_TARGET_BEFORE && q >= position) continue;
+        if (scope->self_rule == SELF_MIRROR && position > scope->target_len - q - length) continue;
+        int seeded = 0;
+        for (int i = position; i <= position + length - scope->seed_length && i < ref_len - scope->seed_length; i++) {
+            seeded |= i % scope->seed_step == 0;
+        }
+        if (!seeded) continue;
+        best_length = length;
+        best_target = q;
+    }
+    if (best_target < 0) return 0;
+    
+    repeat->position = position;
+    repeat->length = best_length;
+    repeat->count = brute_count(target, scope->target_len, reference + position, best_length);
+    repeat->is_reverse = scope->is_reverse;
+    repeat->query_position = scope->is_reverse ? scope->target_len - best_target - best_length : best_target;
+    return 1;
+}
+
+static void random_bases(char* sequence, int length, int alphabet) {
+    const char* bases = "ACGT";
+    for (int i = 0; i < length; i++) sequence[i] = bases[rand() % alphabet];
+    sequence[length] = '\0';
+}
+
+// Copy reference[from, from + length) into the query at to, reverse complemented if asked
+static void plant(const char* reference, int from, int length, char* query, int to, int is_reverse) {
+    if (is_reverse) {
+        char* rc = get_reverse_complement(reference + from, length);
+        memcpy(query + to, rc, length);
+        free(rc);
+    } else {
+        memcpy(query + to, reference + from, length);
+    }
+}
+
+// Compare resolve_repeat with the brute force at every reference position, on both strands,
+// under every self rule, with and without N matching N and with sampled seeds
+static void check_resolve(unsigned int seed) {
+    srand(seed);
+    int ref_len = 300, query_len = 900;
+    char* reference = (char*)malloc(ref_len + 1);
+    char* query = (char*)malloc(query_len + 1);
+    random_bases(reference, ref_len, 4);
+    random_bases(query, query_len, 4);
+    for (int n = 0; n < 30; n++) {
+        int length = 20 + rand() % 60;
+        plant(reference, rand() % (ref_len - length), length, query, rand() % (query_len - length), rand() % 2);
+    }
+    for (int n = 0; n < 4; n++) {
+        int at = rand() % (query_len - 20);
+        memset(query + at, 'N', 1 + rand() % 4);
+        at = rand() % (ref_len - 20);
+        memset(reference + at, 'N', 1 + rand() % 4);
+    }
+    
+    char* query_rc = get_reverse_complement(query, query_len);
+    for (int is_reverse = 0; is_reverse <= 1; is_reverse++) {
+        const char* target = is_reverse ? query_rc : query;
+        KmerIndex* index = build_kmer_index(target, query_len, 5);
+        for (int variant = 0; variant < 8; variant++) {
+            RepeatScope scope = {target, query_len, index, is_reverse, 12 + variant, variant % 2 ? 0 : 40, 
+                                 variant % 3 == 0, (SelfRule)(variant % 4), 1 + variant % 3, 5 + variant};
+            for (int position = 0; position < ref_len; position++) {
+                RepeatPattern found = {0}, expected = {0};
+                int got = resolve_repeat(&scope, reference, ref_len, position, &found);
+                int want = brute_resolve(&scope, reference, ref_len, position, &expected);
+                CHECK(got == want && (!got || compare_rank(&found, &expected) == 0 && found.count == expected.count),
+                      "seed %u, strand %d, variant %d, position %d: resolved %d (%d, %d, %d), expected %d (%d, %d, %d)",
+                      seed, is_reverse, variant, position, got, found.length, found.count, found.query_position,
+                      want, expected.length, expected.count, expected.query_position);
+            }
+        }
+        free_kmer_index(index);
+    }
+    
+    free(query_rc);
+    free(reference);
+    free(query);
+}
+
+// Run an engine the way main does and keep the K best of what it reports (all with k = 0).
+// A full run is ranked by every query instance of each repeat, counted by brute force.
+static RepeatPattern* run_engine(EngineKind engine, const char* reference, int ref_len, const char* query, 
+                                 int query_len, int k, int* num_repeats) {
+    finder_options.top_k = k;
+    int found = 0;
+    RepeatPattern* repeats = NULL;
+    if (engine == ENGINE_GRAPH) {
+        DNAGraph* graph = build_dna_graph(reference, ref_len, query, query_len);
+        repeats = find_repeats_in_graph(graph, reference, ref_len, query, query_len, &found);
+        free_dna_graph(graph);
+    } else if (engine == ENGINE_DIAGONAL) {
+        repeats = find_repeats_diagonal(reference, ref_len, query, query_len, &found);
+    } else if (engine == ENGINE_MEM) {
+        repeats = find_repeats_mem(reference, ref_len, query, query_len, NULL, &found);
+    } else {
+        repeats = find_repeats(reference, ref_len, query, query_len, &found);
+    }
+    finder_options.top_k = 0;
+    
+    if (repeats && engine != ENGINE_MEM) {
+        if (k == 0 && engine != ENGINE_TRADITIONAL) {
+            for (int r = 0; r < found; r++) {
+                const char* segment = reference + repeats[r].position;
+                char* pattern = repeats[r].is_reverse ? get_reverse_complement(segment, repeats[r].length) 
+                                                      : strndup(segment, repeats[r].length);
+                int count = brute_count(query, query_len, pattern, repeats[r].length);
+                repeats[r].count = count > 0 ? count : 1;
+                free(pattern);
+            }
+        }
+        int seq_count = 0;
+        RepeatPattern* with_seq = get_repeat_sequences(repeats, found, reference, query, ref_len, query_len, 
+                                                       &seq_count);
+        RepeatPattern* filtered = filter_nested_repeats(with_seq, seq_count, 1, &found);
+        if (filtered != with_seq) free(with_seq);
+        repeats = filtered;
+    }
+    return select_top_repeats(repeats, found, k, num_repeats);
+}
+
+static const char* engine_label(EngineKind engine) {
+    switch (engine) {
+        case ENGINE_GRAPH:    return "graph";
+        case ENGINE_DIAGONAL: return "diagonal";
+        case ENGINE_MEM:      return "mem";
+        default:              return "traditional";
+    }
+}
+
+// --top K on an engine has to report the first K of its full run ranked by length x count
+static void check_engine_top(const char* label, EngineKind engine, const char* reference, int ref_len, 
+                             const char* query, int query_len, int k) {
+    int num_full = 0, num_top = 0;
+    RepeatPattern* full = run_engine(engine, reference, ref_len, query, query_len, 0, &num_full);
+    int want = num_full < k ? num_full : k;
+    full = select_top_repeats(full, num_full, k, &num_full);
+    RepeatPattern* top = run_engine(engine, reference, ref_len, query, query_len, k, &num_top);
+    
+    CHECK(num_top == want, "%s, %s, top %d: %d repeats, expected %d", label, engine_label(engine), k, 
+          num_top, want);
+    for (int i = 0; i < num_top && i < want; i++) {
+        CHECK(top[i].position == full[i].position && top[i].length == full[i].length && 
+              top[i].count == full[i].count && top[i].is_reverse == full[i].is_reverse,
+              "%s, %s, top %d: rank %d is (%d, %d, %d, %d), expected (%d, %d, %d, %d)", label, 
+              engine_label(engine), k, i, top[i].position, top[i].length, top[i].count, top[i].is_reverse,
+              full[i].position, full[i].length, full[i].count, full[i].is_reverse);
+    }
+    free_repeat_patterns(full, num_full);
+    free_repeat_patterns(top, num_top);
+}
+
+// A random base other than avoid
+static char other_base(char avoid) {
+    const char* bases = "ACGT";
+    char base;
+    do {
+        base = bases[rand() % 4];
+    } while (base == avoid);
+    return base;
+}
+
+static char complement_base(char base) {
+    switch (base) {
+        case 'A': return 'T';
+        case 'C': return 'G';
+        case 'G': return 'C';
+        case 'T': return 'A';
+        default:  return 'N';
+    }
+}
+
+// Query holding copies of reference segments, each with flanks that do not extend it.
+// Copies are forward or reverse complemented and some come back to back.
+static char* plant_copies(const char* reference, int ref_len, int* query_len, const int (*copies)[3], 
+                          int num_copies) {
+    char* query = (char*)malloc(64 * 1024);
+    const char* bases = "ACGT";
+    int length = 0;
+    for (int c = 0; c < num_copies; c++) {
+        int from = copies[c][0], size = copies[c][1], is_reverse = copies[c][2] & 1;
+        int run = copies[c][2] & 2 ? 1 + rand() % 3 : 1;
+        char left = from > 0 ? reference[from - 1] : 'N';
+        char right = from + size < ref_len ? reference[from + size] : 'N';
+        if (is_reverse) {
+            char swap = complement_base(left);
+            left = complement_base(right);
+            right = swap;
+        }
+    
+        int gap = 10 + rand() % 50;
+        for (int i = 0; i < gap; i++) query[length++] = bases[rand() % 4];
+        query[length - 1] = other_base(left);
+        for (int r = 0; r < run; r++) {
+            plant(reference, from, size, query, length, is_reverse);
+            length += size;
+        }
+        query[length++] = other_base(right);
+    }
+    for (int i = 0; i < 40; i++) query[length++] = bases[rand() % 4];
+    query[length] = '\0';
+    *query_len = length;
+    return query;
+}
+
+// Random copies planted in a random query, and the case that ranked by length alone goes wrong:
+// reference[900, 955) nine times, [2400, 2480) five times and [500, 590) three times
+static void check_engines(unsigned int seed) {
+    srand(seed);
+    int ref_len = 3000;
+    char* reference = (char*)malloc(ref_len + 1);
+    random_bases(reference, ref_len, 4);
+    
+    int copies[40][3];
+    int num_copies = 0;
+    if (seed == 1) {
+        const int planted[3][3] = {{900, 55, 9}, {2400, 80, 5}, {500, 90, 3}};
+        for (int p = 0; p < 3; p++) {
+            for (int n = 0; n < planted[p][2]; n++) {
+                copies[num_copies][0] = planted[p][0];
+                copies[num_copies][1] = planted[p][1];
+                copies[num_copies][2] = 0;
+                num_copies++;
+            }
+        }
+        for (int c = num_copies - 1; c > 0; c--) {
+            int other = rand() % (c + 1);
+            for (int f = 0; f < 3; f++) {
+                int swap = copies[c][f];
+                copies[c][f] = copies[other][f];
+                copies[other][f] = swap;
+            }
+        }
+    } else {
+        int num_segments = 3 + rand() % 6;
+        for (int s = 0; s < num_segments; s++) {
+            int size = 30 + rand() % 90;
+            int from = rand() % (ref_len - size);
+            int strand = rand() % 2;
+            for (int n = 1 + rand() % 5; n > 0 && num_copies < 40; n--) {
+                copies[num_copies][0] = from + rand() % 3;
+                copies[num_copies][1] = size - rand() % 3;
+                copies[num_copies][2] = strand | (rand() % 4 == 0 ? 2 : 0);
+                num_copies++;
+            }
+        }
+    }
+    int query_len = 0;
+    char* query = plant_copies(reference, ref_len, &query_len, (const int (*)[3])copies, num_copies);
+    
+    char label[32];
+    snprintf(label, sizeof(label), "seed %u", seed);
+    finder_options.exact_mode = 1;
+    EngineKind engines[4] = {ENGINE_GRAPH, ENGINE_DIAGONAL, ENGINE_MEM, ENGINE_TRADITIONAL};
+    for (int e = 0; e < 4; e++) {
+        for (int threads = 1; threads <= 4; threads *= 4) {
+            omp_set_num_threads(threads);
+            for (int k = 1; k <= 9; k += 4) {
+                check_engine_top(label, engines[e], reference, ref_len, query, query_len, k);
+            }
+        }
+    }
+    
+    if (seed == 1) {
+        int num_top = 0;
+        for (int e = 0; e < 2; e++) {
+            RepeatPattern* top = run_engine(engines[e], reference, ref_len, query, query_len, 1, &num_top);
+            CHECK(num_top == 1 && top[0].position == 900 && top[0].length == 55 && top[0].count == 9,
+                  "%s: top 1 is position %d length %d count %d, expected 900, 55, 9", engine_label(engines[e]),
+                  num_top ? top[0].position : -1, num_top ? top[0].length : -1, num_top ? top[0].count : -1);
+            free_repeat_patterns(top, num_top);
+        }
+    }
+    
+    // One sequence against itself
+    finder_options.self_mode = 1;
+    for (int e = 0; e < 2; e++) {
+        check_engine_top("self", engines[e], query, query_len, query, query_len, 5);
+    }
+    finder_options.self_mode = 0;
+    finder_options.exact_mode = 0;
+    
+    free(reference);
+    free(query);
+}
+
+int main(void) {
+    for (unsigned int seed = 1; seed <= 200; seed++) {
+        int k = 1 + seed % 40;
+        check_heap(seed, k, 50 + (int)(seed * 37 % 2000), 5 + (int)(seed * 13 % 300), 1 + seed % 8);
+    }
+    for (unsigned int seed = 1; seed <= 20; seed++) {
+        check_resolve(seed);
+    }
+    for (unsigned int seed = 1; seed <= 8; seed++) {
+        check_engines(seed);
+    }
+    
+    if (failures) {
+        printf("test_topk: %d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("test_topk: all checks passed\n");
+    return 0;
+}